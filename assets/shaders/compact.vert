@@ -0,0 +1,49 @@
+#version 450
+
+// vertex shader for Model::VertexFormat::Compact and Model::VertexFormat::Quantized. the fixed function
+// vertex input already turns the half floats and normalized integers into floats, only the normal needs
+// decoding. quantized positions are in [0, 1] and are mapped back to model space by the model matrix
+
+layout(location = 0) in vec3 a_position;
+layout(location = 1) in vec3 a_color;
+layout(location = 2) in vec2 a_normal;
+layout(location = 3) in vec2 a_texcoord;
+
+layout(location = 0) out vec3 frag_color;
+layout(location = 1) out vec3 frag_pos_world;
+layout(location = 2) out vec3 frag_normal_world;
+
+layout(set = 0, binding = 0) uniform UBO
+{
+    mat4 projection;
+    mat4 view;
+    vec4 ambient_color;
+    vec4 light_position;
+    vec4 light_color;
+} ubo;
+
+layout(push_constant) uniform Push
+{
+    mat4 model_matrix;
+    mat4 normal_matrix;
+} push;
+
+// unfold an octahedral encoded unit vector
+vec3 DecodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main() {
+    vec4 world_position = push.model_matrix * vec4(a_position, 1.0);
+    gl_Position = ubo.projection * ubo.view * world_position;
+
+    // convert normals in model space to normals in world space
+    frag_normal_world = normalize(mat3(push.normal_matrix) * DecodeOctahedral(a_normal));
+    frag_pos_world = world_position.xyz;
+    frag_color = a_color;
+}
\ No newline at end of file
@@ -1,7 +1,9 @@
 #include "core/application.h"
+#include "core/fixed_timestep.h"
+#include "core/job_system.h"
 #include "core/logger.h"
+#include "core/render_thread.h"
 #include "core/timer.h"
-#include "renderer/buffer.h"
 #include "renderer/camera.h"
 #include "renderer/data.h"
 #include "renderer/camera_controller.h"
@@ -23,8 +25,8 @@ namespace DORY
         m_window.SetEventCallback([this](Event& event) { this->OnEvent(event); });
 
         m_descriptor_pool = DescriptorPool::Builder(m_device)
-                            .SetMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
-                            .AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
+                            .SetMaxSets(1)
+                            .AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1)
                             .Build();
         LoadObjects();
     }
@@ -35,71 +37,119 @@ namespace DORY
     
     void Application::Run()
     {
-        std::vector<std::unique_ptr<Buffer>> ubo_buffers(SwapChain::MAX_FRAMES_IN_FLIGHT);
-        for (size_t i = 0; i < ubo_buffers.size(); i++)
-        {
-            ubo_buffers[i] = std::make_unique<Buffer>(  m_device, 
-                                                        sizeof(UniformBufferObject), 
-                                                        1,
-                                                        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-            ubo_buffers[i]->Map();
-        }
-
+        // the uniforms of every frame live in the frame allocator, so a single set with a dynamic offset
+        // serves all frames in flight
         auto descriptor_set_layout = DescriptorSetLayout::Builder(m_device)
-                                        .AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+                                        .AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
                                         .Build();
-        std::vector<VkDescriptorSet> descriptor_sets(SwapChain::MAX_FRAMES_IN_FLIGHT);
-        for (size_t i = 0; i < descriptor_sets.size(); i++)
-        {
-            auto buffer_info = ubo_buffers[i]->DescriptorInfo();
-            DescriptorWriter(*descriptor_set_layout, *m_descriptor_pool)
-                            .WriteBuffer(0, &buffer_info)
-                            .Build(descriptor_sets[i]);
-        }
+        VkDescriptorSet descriptor_set;
+        auto buffer_info = m_renderer.GetFrameAllocator().DescriptorInfo(sizeof(UniformBufferObject));
+        DescriptorWriter(*descriptor_set_layout, *m_descriptor_pool)
+                        .WriteBuffer(0, &buffer_info)
+                        .Build(descriptor_set);
 
         RendererSystem renderer_system{m_device, m_renderer.GetSwapChainRenderPass(), descriptor_set_layout->GetDescriptorSetLayout()};
         PointLightSystem point_light_system{m_device, m_renderer.GetSwapChainRenderPass(), descriptor_set_layout->GetDescriptorSetLayout()};
-        Camera camera{};
         auto viewer = Object::CreateObject(); // this holds the camera
         CameraController camera_controller{};
         Timer timer{};
+        FixedTimestep timestep{1.0f / 60.0f}; // the simulation runs at 60 Hz whatever the display rate
 
-        // run the application
-        while (!m_window.ShouldClose())
-        {
-            glfwPollEvents();
+        // every object starts at rest, with nothing to interpolate from
+        for (auto& kv : m_objects) { kv.second.previous_transform = kv.second.transform; }
+        viewer.previous_transform = viewer.transform;
 
-            float frame_time = timer.GetElapsedTime();
-            camera_controller.Move(m_window.GetWindow(), frame_time, viewer);
-            camera.SetViewZYX(viewer.transform.translation, viewer.transform.rotation);
-
-            float aspect = m_renderer.GetSwapChainAspectRatio();
+        // everything that touches the device runs on the render thread, the main thread only polls events
+        // and updates the scene
+        uint32_t resource_generation = m_renderer.GetResourceGeneration();
+        RenderThread render_thread{[&](const FrameSnapshot& snapshot)
+        {
+            m_assets.Update();
+            m_assets.GetResidency().Update(m_renderer.GetFrameNumber());
 
-            // update the camera in case window was resized
-            camera.SetPerspectiveProjection(glm::radians(45.0f), aspect, 0.1f, 100.0f);
-            
             // BeginFrame() returns nullptr if the swap chain is not ready (i.e. the window is being resized, etc.)
             if (auto command_buffer = m_renderer.BeginFrame())
             {
+                // a change of the renderer settings replaced the frame allocator, the device is idle so the
+                // descriptor set can be pointed at the new one
+                FrameAllocator& frame_allocator = m_renderer.GetFrameAllocator();
+                if (m_renderer.GetResourceGeneration() != resource_generation)
+                {
+                    auto frame_buffer_info = frame_allocator.DescriptorInfo(sizeof(UniformBufferObject));
+                    DescriptorWriter(*descriptor_set_layout, *m_descriptor_pool)
+                                    .WriteBuffer(0, &frame_buffer_info)
+                                    .Overwrite(descriptor_set);
+                    resource_generation = m_renderer.GetResourceGeneration();
+                }
+
+                // compact the geometry of the models before the render pass begins
+                m_assets.GetDefragmenter().Update(command_buffer, m_renderer.GetFrameNumber());
+
                 int frame_index = m_renderer.GetCurrentFrameIndex();
-                FrameInfo frame_info{frame_index, frame_time, command_buffer, camera, descriptor_sets[frame_index], m_objects};
-                // update the uniform buffer object
+                // update the uniform buffer object, the renderer flushes it when the frame ends
                 UniformBufferObject ubo{};
-                ubo.projection = camera.GetProjection();
-                ubo.view = camera.GetView();
-                ubo_buffers[frame_index]->WriteToBuffer(&ubo);
-                ubo_buffers[frame_index]->Flush();
+                ubo.projection = snapshot.camera.GetProjection();
+                ubo.view = snapshot.camera.GetView();
+                uint32_t ubo_offset = frame_allocator.Push(ubo);
+                FrameInfo frame_info{frame_index, snapshot.frame_time, command_buffer, snapshot.camera, descriptor_set, snapshot.objects, ubo_offset, frame_allocator, m_renderer.GetFrameNumber(), m_renderer.GetSecondaryCommandPools()};
 
-                // render the objects
-                m_renderer.BeginSwapChainRenderPass(command_buffer);
+                // render the objects, the systems record them into secondary command buffers on several threads
+                m_renderer.BeginSwapChainRenderPass(command_buffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
                 renderer_system.RenderObjects(frame_info);
                 point_light_system.Render(frame_info);
                 m_renderer.EndSwapChainRenderPass(command_buffer);
                 m_renderer.EndFrame();
             }
+        }};
+
+        // run the application
+        while (!m_window.ShouldClose())
+        {
+            glfwPollEvents();
+            // jobs that touch the window, queued by other threads since the last frame
+            JobSystem::Get().RunMainThreadJobs();
+
+            // nothing to draw while the window is minimized
+            VkExtent2D extent = m_window.GetExtent();
+            if (extent.width == 0 || extent.height == 0)
+            {
+                glfwWaitEvents();
+                continue;
+            }
+
+            // run the simulation steps that have come due since the last frame
+            const float frame_time = timer.GetElapsedTime();
+            const uint32_t step_count = timestep.Advance(frame_time);
+            for (uint32_t i = 0; i < step_count; i++)
+            {
+                for (auto& kv : m_objects) { kv.second.previous_transform = kv.second.transform; }
+                viewer.previous_transform = viewer.transform;
+                camera_controller.Move(m_window.GetWindow(), timestep.GetStep(), viewer);
+            }
+
+            // fill the snapshot of the next frame while the render thread draws the previous one. it shows
+            // the scene between the last two steps, by the time left over since the last one
+            const float alpha = timestep.GetAlpha();
+            FrameSnapshot& snapshot = render_thread.GetSnapshot();
+            snapshot.frame_time = frame_time;
+            const TransformObject view = TransformObject::Interpolate(viewer.previous_transform, viewer.transform, alpha);
+            snapshot.camera.SetViewZYX(view.translation, view.rotation);
+
+            // update the camera in case window was resized
+            float aspect = static_cast<float>(extent.width) / static_cast<float>(extent.height);
+            snapshot.camera.SetPerspectiveProjection(glm::radians(45.0f), aspect, 0.1f, 100.0f);
+
+            snapshot.objects.clear();
+            for (const auto& kv : m_objects) { snapshot.objects.push_back(kv.second.Clone(alpha)); }
+
+            // the render thread is idle until the snapshot is submitted, the models that finished loading
+            // are handed to their objects meanwhile and drawn from the next snapshot on
+            render_thread.Wait();
+            UpdatePendingModels();
+            render_thread.Submit();
         }
 
+        render_thread.Wait();
         vkDeviceWaitIdle(m_device.GetDevice());
     }
 
@@ -110,27 +160,58 @@ namespace DORY
 
     void Application::LoadObjects()
     {   
-        std::shared_ptr<Model> model = Model::LoadModelFromFile(m_device, "assets/models/stanford_bunny.obj");
+        Model::LoadOptions options{};
+        options.optimize = true;
+        options.vertex_format = Model::VertexFormat::Quantized;
+        options.lod_count = 4;
+        options.meshlets = true;
+        options.evictable = true;
+
+        // the models are loaded in the background, the objects are drawn once their model is ready
         auto bunny_object_1 = Object::CreateObject();
-        bunny_object_1.m_model = model;
         bunny_object_1.transform.translation = glm::vec3{-0.5f, 0.5f, 2.5f};
         bunny_object_1.transform.scale = glm::vec3{0.5f, 0.5f, 0.5f};
         bunny_object_1.transform.rotation = glm::vec3{0.0f, glm::pi<float>(), 0.0f};
+        m_pending_models.emplace_back(bunny_object_1.GetObjectId(), m_assets.LoadModelAsync("assets/models/stanford_bunny.obj", options));
         m_objects.emplace(bunny_object_1.GetObjectId(), std::move(bunny_object_1));
 
-        model = Model::LoadModelFromFile(m_device, "assets/models/stanford_bunny.obj");
         auto bunny_object_2 = Object::CreateObject();
-        bunny_object_2.m_model = model;
         bunny_object_2.transform.translation = glm::vec3{0.5f, 0.5f, 2.5f};
         bunny_object_2.transform.scale = glm::vec3{0.5f, 0.5f, 0.5f};
         bunny_object_2.transform.rotation = glm::vec3{0.0f, glm::pi<float>(), 0.0f};
+        m_pending_models.emplace_back(bunny_object_2.GetObjectId(), m_assets.LoadModelAsync("assets/models/stanford_bunny.obj", options));
         m_objects.emplace(bunny_object_2.GetObjectId(), std::move(bunny_object_2));
 
-        model = Model::LoadModelFromFile(m_device, "assets/models/floor.obj");
         auto floor_object = Object::CreateObject();
-        floor_object.m_model = model;
         floor_object.transform.translation = glm::vec3{0.0f, 0.5f, 2.5f};
         floor_object.transform.scale = glm::vec3{1.0f, 1.0f, 1.0f};
+        m_pending_models.emplace_back(floor_object.GetObjectId(), m_assets.LoadModelAsync("assets/models/floor.obj"));
         m_objects.emplace(floor_object.GetObjectId(), std::move(floor_object));
     }
+
+    void Application::UpdatePendingModels()
+    {
+        if (m_pending_models.empty()) { return; }
+
+        for (size_t i = 0; i < m_pending_models.size();)
+        {
+            auto& [object_id, handle] = m_pending_models[i];
+            if (handle.IsReady() || handle.HasFailed())
+            {
+                m_objects.at(object_id).m_model = handle.Get();
+                m_pending_models[i] = std::move(m_pending_models.back());
+                m_pending_models.pop_back();
+            }
+            else
+            {
+                i++;
+            }
+        }
+
+        if (m_pending_models.empty())
+        {
+            AssetRegistry::Stats stats = m_assets.GetStats();
+            DINFO("Asset registry: %zu models, %llu hits, %llu misses", stats.model_count, (unsigned long long)stats.hits, (unsigned long long)stats.misses);
+        }
+    }
 } // namespace DORY
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "core/core.h"
 #include "events/event.h"
 #include "events/window_event.h"
+#include "loaders/asset_registry.h"
 #include "platform/window.h"
 #include "renderer/descriptor.h"
 #include "renderer/device.h"
@@ -17,6 +18,8 @@
 #include <glm/gtc/constants.hpp>
 
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace DORY
 {
@@ -71,11 +74,24 @@ namespace DORY
              */
             GLFWwindow* GetApplicationWindow() const { return m_window.GetWindow(); }
 
+            /**
+             * @brief change the number of frames in flight and of swap chain images while the application
+             * runs. takes effect from the next frame, see Renderer::SetConfig()
+             * @param config the new settings
+             */
+            void SetRendererConfig(const RendererConfig& config) { m_renderer.SetConfig(config); }
+
         private: // methods
             /**
              * @brief load vertex data from a file and create a vertex buffer object
              */
             void LoadObjects();
+
+            /**
+             * @brief give objects their model once its background load has finished. never blocks. called
+             * while the render thread is idle, since the asset registry is updated on the render thread
+             */
+            void UpdatePendingModels();
             
         private: // members
             static Application* s_instance; // static instance of application
@@ -83,7 +99,9 @@ namespace DORY
             Device m_device{m_window}; // device running the application
             Renderer m_renderer{m_window, m_device}; // renderer for the application
             std::unique_ptr<DescriptorPool> m_descriptor_pool{}; // descriptor pool for the application
+            AssetRegistry m_assets{m_device}; // shared models used by the application's objects
             std::unordered_map<uint32_t, Object> m_objects; // the application's objects
+            std::vector<std::pair<uint32_t, ModelHandle>> m_pending_models{}; // objects waiting for their model to load
     }; // class Application
 
     /**
@@ -2,11 +2,16 @@
 #define DORY_ENTRY_INCL
 
 #include "core/core.h"
+#include "core/job_system.h"
 
 extern DORY::Application* DORY::Init();
 
 int main()
 {
+    // the thread creating the job system becomes its main thread, which jobs with main thread affinity
+    // (e.g. GLFW calls) run on, so it is created here before anything else can
+    DORY::JobSystem::Get();
+
     auto app = DORY::Init();
     app->Run();
     delete app;
@@ -0,0 +1,67 @@
+#ifndef DORY_FIXED_TIMESTEP_INCL
+#define DORY_FIXED_TIMESTEP_INCL
+
+#include <algorithm>
+#include <cstdint>
+
+namespace DORY
+{
+    /**
+     * @brief schedules simulation updates of a fixed length. the elapsed time of every frame goes into an
+     * accumulator and is paid out in whole steps, so the simulation gives the same results at any frame
+     * rate and can run slower than the display. the time left over is the fraction of a step that the
+     * rendered state is interpolated by.
+     */
+    class FixedTimestep
+    {
+        public:
+            /**
+             * @brief create a scheduler
+             * @param step length of a simulation step in seconds
+             * @param max_steps (optional) most steps run in a frame. when the simulation cannot keep up, the
+             * time beyond it is dropped rather than making the next frame even longer
+             */
+            explicit FixedTimestep(float step, uint32_t max_steps = 5)
+                : m_step{step}, m_max_steps{std::max(max_steps, 1u)}
+            {
+            }
+
+            /**
+             * @brief add the time elapsed since the last call
+             * @param elapsed time in seconds
+             * @return uint32_t number of steps to run now
+             */
+            uint32_t Advance(float elapsed)
+            {
+                m_accumulator += std::max(elapsed, 0.0f);
+                uint32_t steps = static_cast<uint32_t>(m_accumulator / m_step);
+                if (steps > m_max_steps)
+                {
+                    steps = m_max_steps;
+                    m_accumulator = m_step * static_cast<float>(m_max_steps);
+                }
+                m_accumulator -= m_step * static_cast<float>(steps);
+                m_accumulator = std::max(m_accumulator, 0.0f);
+                return steps;
+            }
+
+            /**
+             * @brief get the length of a step
+             * @return float seconds
+             */
+            float GetStep() const { return m_step; }
+
+            /**
+             * @brief get how far the time is between the last step and the next one
+             * @return float in [0, 1), 0 at the last step
+             */
+            float GetAlpha() const { return std::min(m_accumulator / m_step, 1.0f); }
+
+        private:
+            float m_step; // length of a step in seconds
+            uint32_t m_max_steps; // see FixedTimestep()
+            float m_accumulator = 0.0f; // elapsed time not yet simulated, in seconds
+    }; // class FixedTimestep
+} // namespace DORY
+
+#endif // DORY_FIXED_TIMESTEP_INCL
\ No newline at end of file
@@ -0,0 +1,261 @@
+#include "core/job_system.h"
+#include "utils/parallel.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace DORY
+{
+    namespace
+    {
+        thread_local JobSystem* t_system = nullptr; // system the calling thread belongs to, if any
+        thread_local uint32_t t_index = 0; // index of the calling thread's deque in t_system
+        thread_local uint32_t t_random = 0; // state of the calling thread's victim picker
+
+        /**
+         * @brief xorshift, to spread the thieves over the deques
+         */
+        uint32_t NextRandom()
+        {
+            if (t_random == 0) { t_random = static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1; }
+            t_random ^= t_random << 13;
+            t_random ^= t_random >> 17;
+            t_random ^= t_random << 5;
+            return t_random;
+        }
+
+        /**
+         * @brief number of times an idle worker looks for jobs before it goes to sleep
+         */
+        constexpr uint32_t SPIN_COUNT = 64;
+    } // namespace
+
+    JobSystem::JobSystem(uint32_t thread_count)
+        : m_main_thread(std::this_thread::get_id()), m_previous_system(t_system), m_previous_index(t_index)
+    {
+        thread_count = Utils::GetThreadCount(thread_count);
+        for (uint32_t i = 0; i < thread_count; i++) { m_deques.push_back(std::make_unique<WorkStealingDeque<Job*>>()); }
+
+        t_system = this;
+        t_index = 0;
+        m_workers.reserve(thread_count - 1);
+        for (uint32_t i = 1; i < thread_count; i++) { m_workers.emplace_back(&JobSystem::WorkerLoop, this, i); }
+    }
+
+    JobSystem::~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_sleep_mutex};
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+
+        // the workers leave once nothing is queued, but the main thread's deque is only emptied here
+        while (TryRunJob()) {}
+        for (auto& worker : m_workers) { worker.join(); }
+        while (RunMainThreadJobs() > 0) {}
+        if (t_system == this)
+        {
+            t_system = m_previous_system;
+            t_index = m_previous_index;
+        }
+    }
+
+    JobSystem& JobSystem::Get()
+    {
+        static JobSystem system{};
+        return system;
+    }
+
+    void JobSystem::Run(std::function<void()> job, JobCounter* counter, Affinity affinity)
+    {
+        Job* queued = new Job{std::move(job), counter};
+        if (counter != nullptr) { counter->m_count.fetch_add(1, std::memory_order_relaxed); }
+
+        if (affinity == Affinity::MainThread)
+        {
+            std::lock_guard<std::mutex> lock{m_shared_mutex};
+            m_main_jobs.push_back(queued);
+            m_main_count.fetch_add(1, std::memory_order_release);
+            return;
+        }
+
+        if (t_system == this)
+        {
+            m_deques[t_index]->Push(queued);
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock{m_shared_mutex};
+            m_shared_jobs.push_back(queued);
+            m_shared_count.fetch_add(1, std::memory_order_release);
+        }
+        m_queued.fetch_add(1, std::memory_order_seq_cst);
+        WakeWorker();
+    }
+
+    void JobSystem::Wait(const JobCounter& counter)
+    {
+        // a thread outside of the system only helps with the jobs of its own counter, which it queued into
+        // the shared queue itself. otherwise e.g. the render thread could pick up a long parse queued by a
+        // loader thread and hold up the frame it is recording
+        const bool member = t_system == this;
+        while (!counter.IsDone())
+        {
+            const bool ran = member ? TryRunJob() : TryRunSharedJob(counter);
+            if (!ran) { std::this_thread::yield(); }
+        }
+    }
+
+    void JobSystem::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body)
+    {
+        if (count == 0) { return; }
+        grain = std::max<size_t>(grain, 1);
+
+        JobCounter counter;
+        for (size_t begin = grain; begin < count; begin += grain)
+        {
+            const size_t end = std::min(begin + grain, count);
+            Run([&body, begin, end]() { body(begin, end); }, &counter);
+        }
+        body(0, std::min(grain, count));
+        Wait(counter);
+    }
+
+    void JobSystem::RunParallel(size_t count, const std::function<void(size_t)>& task)
+    {
+        ParallelFor(count, 1, [&task](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++) { task(i); }
+        });
+    }
+
+    uint32_t JobSystem::RunMainThreadJobs()
+    {
+        assert(IsMainThread() && "Main thread jobs must be run from the main thread");
+        uint32_t count = 0;
+        while (m_main_count.load(std::memory_order_acquire) > 0)
+        {
+            Job* job = nullptr;
+            {
+                std::lock_guard<std::mutex> lock{m_shared_mutex};
+                if (m_main_jobs.empty()) { break; }
+                job = m_main_jobs.front();
+                m_main_jobs.pop_front();
+                m_main_count.fetch_sub(1, std::memory_order_relaxed);
+            }
+            Execute(job);
+            count++;
+        }
+        return count;
+    }
+
+    void JobSystem::WorkerLoop(uint32_t index)
+    {
+        t_system = this;
+        t_index = index;
+        while (true)
+        {
+            if (TryRunJob()) { continue; }
+
+            // a job is often queued right after the last one was taken, so look again a few times before
+            // paying for a sleep and a wake
+            uint32_t spin = 0;
+            while (spin < SPIN_COUNT && m_queued.load(std::memory_order_relaxed) <= 0)
+            {
+                std::this_thread::yield();
+                spin++;
+            }
+            if (spin < SPIN_COUNT) { continue; }
+
+            // Run() bumps m_queued before it checks m_sleeping, and this thread bumps m_sleeping before it
+            // checks m_queued, so at least one of the two sees the other and no wake is lost
+            std::unique_lock<std::mutex> lock{m_sleep_mutex};
+            m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+            m_wake.wait(lock, [this]() { return m_queued.load(std::memory_order_seq_cst) > 0 || m_stopping; });
+            m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+            if (m_stopping && m_queued.load(std::memory_order_seq_cst) <= 0) { return; }
+        }
+    }
+
+    bool JobSystem::TryRunJob()
+    {
+        if (t_system == this && t_index == 0 && RunMainThreadJobs() > 0) { return true; }
+
+        Job* job = TakeJob();
+        if (job == nullptr) { return false; }
+        Execute(job);
+        return true;
+    }
+
+    bool JobSystem::TryRunSharedJob(const JobCounter& counter)
+    {
+        if (m_shared_count.load(std::memory_order_acquire) == 0) { return false; }
+
+        Job* job = nullptr;
+        {
+            std::lock_guard<std::mutex> lock{m_shared_mutex};
+            auto it = std::find_if(m_shared_jobs.begin(), m_shared_jobs.end(), [&counter](const Job* queued) { return queued->counter == &counter; });
+            if (it == m_shared_jobs.end()) { return false; }
+            job = *it;
+            m_shared_jobs.erase(it);
+            m_shared_count.fetch_sub(1, std::memory_order_relaxed);
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+        }
+        Execute(job);
+        return true;
+    }
+
+    JobSystem::Job* JobSystem::TakeJob()
+    {
+        Job* job = nullptr;
+        const bool member = t_system == this;
+        if (member && m_deques[t_index]->Pop(job))
+        {
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+
+        if (m_shared_count.load(std::memory_order_acquire) > 0)
+        {
+            std::lock_guard<std::mutex> lock{m_shared_mutex};
+            if (!m_shared_jobs.empty())
+            {
+                job = m_shared_jobs.front();
+                m_shared_jobs.pop_front();
+                m_shared_count.fetch_sub(1, std::memory_order_relaxed);
+                m_queued.fetch_sub(1, std::memory_order_relaxed);
+                return job;
+            }
+        }
+
+        // start at a random victim so that the thieves do not all fight over the same deque
+        const uint32_t deque_count = GetThreadCount();
+        const uint32_t first = NextRandom() % deque_count;
+        for (uint32_t i = 0; i < deque_count; i++)
+        {
+            const uint32_t victim = (first + i) % deque_count;
+            if (member && victim == t_index) { continue; }
+            if (m_deques[victim]->Steal(job))
+            {
+                m_queued.fetch_sub(1, std::memory_order_relaxed);
+                return job;
+            }
+        }
+        return nullptr;
+    }
+
+    void JobSystem::Execute(Job* job)
+    {
+        job->function();
+        if (job->counter != nullptr) { job->counter->m_count.fetch_sub(1, std::memory_order_release); }
+        delete job;
+    }
+
+    void JobSystem::WakeWorker()
+    {
+        if (m_sleeping.load(std::memory_order_seq_cst) == 0) { return; }
+        std::lock_guard<std::mutex> lock{m_sleep_mutex};
+        m_wake.notify_one();
+    }
+} // namespace DORY
\ No newline at end of file
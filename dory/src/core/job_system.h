@@ -0,0 +1,200 @@
+#ifndef DORY_JOB_SYSTEM_INCL
+#define DORY_JOB_SYSTEM_INCL
+
+#include "utils/nocopy.h"
+#include "utils/work_stealing_deque.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace DORY
+{
+    /**
+     * @brief counts the jobs of a group that have not finished yet. pass it to JobSystem::Run() and wait
+     * for the group with JobSystem::Wait(). it must outlive the jobs it counts
+     */
+    class JobCounter : public NoCopy
+    {
+        public:
+            /**
+             * @brief check whether every job counted so far has finished
+             * @return true
+             * @return false
+             */
+            bool IsDone() const { return m_count.load(std::memory_order_acquire) == 0; }
+
+        private: // members
+            friend class JobSystem;
+            std::atomic<uint32_t> m_count{0}; // number of jobs that have not finished
+    }; // class JobCounter
+
+    /**
+     * @brief runs short jobs on a fixed set of worker threads and the main thread. every thread of the
+     * system has a WorkStealingDeque; jobs are pushed onto the deque of the thread that runs them, which
+     * works on its newest jobs first, and idle threads steal the oldest jobs of the others. jobs run from
+     * threads outside of the system go into a shared queue. a thread waiting for a JobCounter runs other
+     * jobs until the counter is done, so jobs may run and wait for jobs of their own; a thread outside of
+     * the system only runs the jobs of the counter it waits for. jobs with main thread
+     * affinity, e.g. GLFW calls, only run on the thread that created the system, from RunMainThreadJobs()
+     * or while it waits. workers with nothing to do sleep until a job is queued. jobs must not throw.
+     *
+     * the small worker pool of the asset registry is for long running work such as reading files, which
+     * would hold up the jobs queued behind it here. the parsing it starts runs here.
+     */
+    class JobSystem : public NoCopy
+    {
+        public:
+            /**
+             * @brief threads a job may run on
+             */
+            enum class Affinity
+            {
+                Any, // any thread of the system
+                MainThread // only the thread that created the system
+            };
+
+            /**
+             * @brief start the worker threads. the calling thread becomes the main thread of the system
+             * @param thread_count (optional) number of threads including the main thread. 0 uses one per
+             * hardware thread
+             */
+            explicit JobSystem(uint32_t thread_count = 0);
+
+            /**
+             * @brief finish the queued jobs and stop the worker threads. call from the main thread, which goes
+             * back to the system it belonged to before this one was created, if any
+             */
+            ~JobSystem();
+
+            /**
+             * @brief get the system shared by the engine, created by the first call. the thread making the
+             * first call becomes the main thread of the system, so the entry point makes it before the
+             * application is created
+             * @return JobSystem&
+             */
+            static JobSystem& Get();
+
+            /**
+             * @brief queue a job
+             * @param job the function to run
+             * @param counter (optional) counter to add the job to, decremented once it has finished
+             * @param affinity (optional) threads the job may run on
+             */
+            void Run(std::function<void()> job, JobCounter* counter = nullptr, Affinity affinity = Affinity::Any);
+
+            /**
+             * @brief run other jobs until every job of a counter has finished. a thread outside of the system
+             * only runs jobs of the counter, and yields while others run them
+             * @param counter the counter
+             */
+            void Wait(const JobCounter& counter);
+
+            /**
+             * @brief split [0, count) into ranges of grain items, run body(begin, end) on each and wait for
+             * all of them. the calling thread runs the first range itself
+             * @param count number of items
+             * @param grain number of items per job, enough for a job to be worth more than its overhead
+             * @param body function taking the range of items to process
+             */
+            void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+            /**
+             * @brief run task(0) ... task(count - 1) as separate jobs and wait for all of them
+             * @param count number of tasks
+             * @param task function taking the index of the task
+             */
+            void RunParallel(size_t count, const std::function<void(size_t)>& task);
+
+            /**
+             * @brief run the queued jobs with main thread affinity. must be called from the main thread
+             * @return uint32_t number of jobs run
+             */
+            uint32_t RunMainThreadJobs();
+
+            /**
+             * @brief check whether the calling thread is the main thread of the system
+             * @return true
+             * @return false
+             */
+            bool IsMainThread() const { return std::this_thread::get_id() == m_main_thread; }
+
+            /**
+             * @brief get the number of threads, including the main thread
+             * @return uint32_t
+             */
+            uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_deques.size()); }
+
+        private: // types
+            /**
+             * @brief a queued job
+             */
+            struct Job
+            {
+                std::function<void()> function{}; // the function to run
+                JobCounter* counter = nullptr; // counter to decrement once function has returned, if any
+            };
+
+        private: // methods
+            /**
+             * @brief loop run by each worker thread
+             * @param index index of the worker's deque
+             */
+            void WorkerLoop(uint32_t index);
+
+            /**
+             * @brief take a job the calling thread may run and run it
+             * @return true if a job was run
+             */
+            bool TryRunJob();
+
+            /**
+             * @brief take a job of a counter from the shared queue and run it, for threads outside of the system
+             * @param counter the counter the job must belong to
+             * @return true if a job was run
+             */
+            bool TryRunSharedJob(const JobCounter& counter);
+
+            /**
+             * @brief take a job from the calling thread's deque, the shared queue or another thread's deque
+             */
+            Job* TakeJob();
+
+            /**
+             * @brief run a job, signal its counter and free it
+             */
+            void Execute(Job* job);
+
+            /**
+             * @brief wake a sleeping worker, if there is one
+             */
+            void WakeWorker();
+
+        private: // members
+            std::thread::id m_main_thread; // see IsMainThread()
+            JobSystem* m_previous_system = nullptr; // system the main thread belonged to before this one
+            uint32_t m_previous_index = 0; // index of the main thread in m_previous_system
+            std::vector<std::unique_ptr<WorkStealingDeque<Job*>>> m_deques{}; // deque of thread i, the main thread's first
+            std::vector<std::thread> m_workers{}; // the worker threads, for m_deques[1] onwards
+
+            std::mutex m_shared_mutex{}; // guards m_shared_jobs and m_main_jobs
+            std::deque<Job*> m_shared_jobs{}; // jobs run from threads outside of the system
+            std::deque<Job*> m_main_jobs{}; // jobs with main thread affinity
+            std::atomic<uint32_t> m_shared_count{0}; // size of m_shared_jobs, to skip the lock when it is empty
+            std::atomic<uint32_t> m_main_count{0}; // size of m_main_jobs, to skip the lock when it is empty
+
+            std::atomic<int64_t> m_queued{0}; // number of jobs any worker may take, what sleeping workers wait for
+            std::atomic<uint32_t> m_sleeping{0}; // number of workers waiting on m_wake
+            std::mutex m_sleep_mutex{}; // guards the sleeping of the workers and m_stopping
+            std::condition_variable m_wake{}; // signalled when a job is queued or the system stops
+            bool m_stopping = false; // set when the system is destroyed
+    }; // class JobSystem
+} // namespace DORY
+
+#endif // DORY_JOB_SYSTEM_INCL
\ No newline at end of file
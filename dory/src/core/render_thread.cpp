@@ -0,0 +1,77 @@
+#include "core/render_thread.h"
+
+#include <utility>
+
+namespace DORY
+{
+    RenderThread::RenderThread(std::function<void(const FrameSnapshot&)> render)
+        : m_render(std::move(render))
+    {
+        m_thread = std::thread(&RenderThread::RenderLoop, this);
+    }
+
+    RenderThread::~RenderThread()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+        m_thread.join();
+    }
+
+    void RenderThread::Wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this]() { return m_pending == nullptr; });
+        if (m_error != nullptr)
+        {
+            std::exception_ptr error = m_error;
+            m_error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    void RenderThread::Submit()
+    {
+        Wait();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending = &m_snapshots[m_write_index];
+        }
+        m_condition.notify_all();
+        m_write_index = 1 - m_write_index;
+    }
+
+    void RenderThread::RenderLoop()
+    {
+        while (true)
+        {
+            const FrameSnapshot* snapshot = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this]() { return m_pending != nullptr || m_stopping; });
+                // a frame handed over before the destructor was called is still rendered
+                if (m_pending == nullptr) { return; }
+                snapshot = m_pending;
+            }
+
+            std::exception_ptr error{};
+            try
+            {
+                m_render(*snapshot);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_pending = nullptr;
+                m_error = std::move(error);
+            }
+            m_condition.notify_all();
+        }
+    }
+} // namespace DORY
\ No newline at end of file
@@ -0,0 +1,75 @@
+#ifndef DORY_RENDER_THREAD_INCL
+#define DORY_RENDER_THREAD_INCL
+
+#include "renderer/frame_info.h"
+#include "utils/nocopy.h"
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace DORY
+{
+    /**
+     * @brief records and submits frames on a thread of its own, so that the main thread can poll events
+     * and simulate frame N + 1 while frame N is rendered. the two stages share a pair of FrameSnapshots:
+     * the main thread fills one with GetSnapshot() and hands it over with Submit() while the render thread
+     * draws the other. whatever the main thread does between Wait() and Submit() happens while the render
+     * thread is idle, which is where state both stages touch is updated.
+     */
+    class RenderThread : public NoCopy
+    {
+        public:
+            /**
+             * @brief start the render thread
+             * @param render function recording and submitting the frame of a snapshot. exceptions it throws
+             * are thrown again by the next Wait() or Submit() on the main thread
+             */
+            explicit RenderThread(std::function<void(const FrameSnapshot&)> render);
+
+            /**
+             * @brief finish the frame being rendered and stop the render thread
+             */
+            ~RenderThread();
+
+            /**
+             * @brief get the snapshot to fill for the next frame, which the render thread is not reading
+             * @return FrameSnapshot&
+             */
+            FrameSnapshot& GetSnapshot() { return m_snapshots[m_write_index]; }
+
+            /**
+             * @brief wait until the render thread has finished the frame it was given
+             */
+            void Wait();
+
+            /**
+             * @brief wait for the frame being rendered, then hand the snapshot from GetSnapshot() to the
+             * render thread. the next call of GetSnapshot() returns the other snapshot
+             */
+            void Submit();
+
+        private: // methods
+            /**
+             * @brief loop run by the render thread
+             */
+            void RenderLoop();
+
+        private: // members
+            std::function<void(const FrameSnapshot&)> m_render; // see RenderThread()
+            std::array<FrameSnapshot, 2> m_snapshots{}; // the snapshot being filled and the one being drawn
+            uint32_t m_write_index = 0; // index of the snapshot being filled
+            const FrameSnapshot* m_pending = nullptr; // snapshot handed over and not yet drawn, if any
+            std::exception_ptr m_error{}; // exception thrown by the last frame, if any
+            std::mutex m_mutex{}; // guards m_pending, m_error and m_stopping
+            std::condition_variable m_condition{}; // signalled when a snapshot is handed over or drawn, or the thread stops
+            bool m_stopping = false; // set when the render thread is destroyed
+            std::thread m_thread{}; // the render thread, started last
+    }; // class RenderThread
+} // namespace DORY
+
+#endif // DORY_RENDER_THREAD_INCL
\ No newline at end of file
@@ -0,0 +1,276 @@
+#include "geometry/mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace DORY
+{
+    /**
+     * @brief FIFO vertex cache simulated with time stamps: a vertex is in the cache if fewer than
+     * cache_size vertices have been added since it was added itself
+     */
+    struct FifoCache
+    {
+        std::vector<uint32_t> time_stamps;
+        uint32_t time;
+        uint32_t size;
+
+        FifoCache(size_t vertex_count, uint32_t cache_size)
+            : time_stamps(vertex_count, 0), time(cache_size + 1), size(cache_size) {}
+
+        /**
+         * @brief use a vertex
+         * @return true if it was a miss
+         */
+        bool Access(uint32_t vertex)
+        {
+            if (time - time_stamps[vertex] <= size) { return false; }
+            time_stamps[vertex] = time++;
+            return true;
+        }
+
+        /**
+         * @brief make every vertex a miss again
+         */
+        void Flush() { time += size + 1; }
+    };
+
+    MeshOptimizer::Stats MeshOptimizer::Optimize(Model::Mesh& mesh, uint32_t cache_size)
+    {
+        Stats stats{};
+        stats.before = AnalyzeVertexCache(mesh.indices, mesh.vertices.size(), cache_size);
+
+        OptimizeVertexCache(mesh.indices, mesh.vertices.size(), cache_size);
+        OptimizeOverdraw(mesh.indices, mesh.vertices, 1.05f, cache_size);
+        OptimizeVertexFetch(mesh);
+        mesh.ComputeBounds();
+
+        stats.after = AnalyzeVertexCache(mesh.indices, mesh.vertices.size(), cache_size);
+        return stats;
+    }
+
+    MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size)
+    {
+        VertexCacheStats stats{};
+        if (indices.empty() || vertex_count == 0) { return stats; }
+
+        FifoCache cache(vertex_count, cache_size);
+        for (uint32_t index : indices)
+        {
+            if (cache.Access(index)) { stats.transformed++; }
+        }
+
+        stats.acmr = static_cast<float>(stats.transformed) / static_cast<float>(indices.size() / 3);
+        stats.atvr = static_cast<float>(stats.transformed) / static_cast<float>(vertex_count);
+        return stats;
+    }
+
+    void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size)
+    {
+        const size_t triangle_count = indices.size() / 3;
+        if (triangle_count == 0 || vertex_count == 0) { return; }
+
+        // number of triangles that use each vertex and have not been emitted yet
+        std::vector<uint32_t> live(vertex_count, 0);
+        for (uint32_t index : indices) { live[index]++; }
+
+        // triangles adjacent to each vertex, the triangles of vertex v are adjacency[offsets[v]] ... adjacency[offsets[v + 1] - 1]
+        std::vector<uint32_t> offsets(vertex_count + 1, 0);
+        for (size_t v = 0; v < vertex_count; v++) { offsets[v + 1] = offsets[v] + live[v]; }
+        std::vector<uint32_t> adjacency(indices.size());
+        {
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++) { adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3); }
+        }
+
+        std::vector<uint32_t> cache_time(vertex_count, 0);
+        std::vector<uint8_t> emitted(triangle_count, 0);
+        std::vector<uint32_t> dead_end{}; // recently used vertices, to restart from when the fan runs out
+        std::vector<uint32_t> candidates{};
+        std::vector<uint32_t> output{};
+        output.reserve(indices.size());
+        dead_end.reserve(indices.size());
+
+        uint32_t time = cache_size + 1;
+        size_t cursor = 0; // vertices before this have no live triangles left
+        int64_t fan = 0;
+        while (fan >= 0)
+        {
+            // emit all remaining triangles around the fanning vertex
+            candidates.clear();
+            for (uint32_t a = offsets[fan]; a < offsets[fan + 1]; a++)
+            {
+                const uint32_t triangle = adjacency[a];
+                if (emitted[triangle]) { continue; }
+
+                for (size_t k = 0; k < 3; k++)
+                {
+                    const uint32_t v = indices[3 * triangle + k];
+                    output.push_back(v);
+                    dead_end.push_back(v);
+                    candidates.push_back(v);
+                    live[v]--;
+                    if (time - cache_time[v] > cache_size) { cache_time[v] = time++; }
+                }
+                emitted[triangle] = 1;
+            }
+
+            // continue from the oldest candidate that will still be in the cache after its own
+            // triangles are emitted
+            fan = -1;
+            uint32_t best_priority = 0;
+            for (uint32_t v : candidates)
+            {
+                if (live[v] == 0) { continue; }
+
+                const uint32_t age = time - cache_time[v];
+                if (age + 2 * live[v] <= cache_size && age > best_priority)
+                {
+                    best_priority = age;
+                    fan = v;
+                }
+            }
+
+            // otherwise restart from a recently used vertex, and failing that from the next vertex with
+            // triangles left
+            while (fan < 0 && !dead_end.empty())
+            {
+                const uint32_t v = dead_end.back();
+                dead_end.pop_back();
+                if (live[v] > 0) { fan = v; }
+            }
+            while (fan < 0 && cursor < vertex_count)
+            {
+                if (live[cursor] > 0) { fan = static_cast<int64_t>(cursor); }
+                else { cursor++; }
+            }
+        }
+
+        indices.swap(output);
+    }
+
+    void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Model::Vertex>& vertices, float threshold, uint32_t cache_size)
+    {
+        const size_t triangle_count = indices.size() / 3;
+        if (triangle_count == 0 || vertices.empty()) { return; }
+
+        FifoCache cache(vertices.size(), cache_size);
+        auto triangle_misses = [&](size_t triangle)
+        {
+            return  static_cast<uint32_t>(cache.Access(indices[3 * triangle + 0])) +
+                    static_cast<uint32_t>(cache.Access(indices[3 * triangle + 1])) +
+                    static_cast<uint32_t>(cache.Access(indices[3 * triangle + 2]));
+        };
+
+        // hard boundaries are where the optimized order already starts over with a cold cache, so
+        // cutting there costs nothing
+        std::vector<size_t> hard_boundaries{};
+        for (size_t t = 0; t < triangle_count; t++)
+        {
+            if (triangle_misses(t) == 3) { hard_boundaries.push_back(t); }
+        }
+        hard_boundaries.push_back(triangle_count);
+
+        // soft boundaries cut a hard cluster as soon as the part before the cut has a cache miss ratio
+        // within the threshold of the whole cluster's, even though the cache is cold after the cut
+        std::vector<size_t> boundaries{};
+        for (size_t c = 0; c + 1 < hard_boundaries.size(); c++)
+        {
+            const size_t begin = hard_boundaries[c];
+            const size_t end = hard_boundaries[c + 1];
+
+            cache.Flush();
+            uint32_t cluster_misses = 0;
+            for (size_t t = begin; t < end; t++) { cluster_misses += triangle_misses(t); }
+            const float target = threshold * static_cast<float>(cluster_misses) / static_cast<float>(end - begin);
+
+            boundaries.push_back(begin);
+            cache.Flush();
+            uint32_t running_misses = 0;
+            size_t running_triangles = 0;
+            for (size_t t = begin; t < end; t++)
+            {
+                running_misses += triangle_misses(t);
+                running_triangles++;
+                if (t + 1 < end && static_cast<float>(running_misses) / static_cast<float>(running_triangles) <= target)
+                {
+                    boundaries.push_back(t + 1);
+                    cache.Flush();
+                    running_misses = 0;
+                    running_triangles = 0;
+                }
+            }
+        }
+        boundaries.push_back(triangle_count);
+
+        const size_t cluster_count = boundaries.size() - 1;
+        if (cluster_count < 2) { return; }
+
+        // area weighted centroid and normal of each cluster
+        std::vector<glm::vec3> centroids(cluster_count, glm::vec3{0.0f});
+        std::vector<glm::vec3> normals(cluster_count, glm::vec3{0.0f});
+        glm::vec3 mesh_centroid{0.0f};
+        float mesh_area = 0.0f;
+        for (size_t c = 0; c < cluster_count; c++)
+        {
+            float cluster_area = 0.0f;
+            for (size_t t = boundaries[c]; t < boundaries[c + 1]; t++)
+            {
+                const glm::vec3& p0 = vertices[indices[3 * t + 0]].a_position;
+                const glm::vec3& p1 = vertices[indices[3 * t + 1]].a_position;
+                const glm::vec3& p2 = vertices[indices[3 * t + 2]].a_position;
+                const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                const float area = glm::length(normal);
+
+                centroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+                normals[c] += normal;
+                cluster_area += area;
+            }
+
+            mesh_centroid += centroids[c];
+            mesh_area += cluster_area;
+            if (cluster_area > 0.0f) { centroids[c] /= cluster_area; }
+        }
+        if (mesh_area > 0.0f) { mesh_centroid /= mesh_area; }
+
+        // clusters that face away from the centre are likely in front of the rest of the mesh, draw them first
+        std::vector<float> sort_keys(cluster_count);
+        for (size_t c = 0; c < cluster_count; c++)
+        {
+            const float length = glm::length(normals[c]);
+            sort_keys[c] = length > 0.0f ? glm::dot(centroids[c] - mesh_centroid, normals[c] / length) : 0.0f;
+        }
+
+        std::vector<size_t> order(cluster_count);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sort_keys[a] > sort_keys[b]; });
+
+        std::vector<uint32_t> output{};
+        output.reserve(indices.size());
+        for (size_t c : order)
+        {
+            output.insert(output.end(), indices.begin() + 3 * boundaries[c], indices.begin() + 3 * boundaries[c + 1]);
+        }
+        indices.swap(output);
+    }
+
+    void MeshOptimizer::OptimizeVertexFetch(Model::Mesh& mesh)
+    {
+        std::vector<uint32_t> remap(mesh.vertices.size(), UINT32_MAX);
+        std::vector<Model::Vertex> vertices{};
+        vertices.reserve(mesh.vertices.size());
+
+        for (uint32_t& index : mesh.indices)
+        {
+            if (remap[index] == UINT32_MAX)
+            {
+                remap[index] = static_cast<uint32_t>(vertices.size());
+                vertices.push_back(mesh.vertices[index]);
+            }
+            index = remap[index];
+        }
+
+        mesh.vertices.swap(vertices);
+    }
+} // namespace DORY
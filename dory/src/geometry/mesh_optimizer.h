@@ -0,0 +1,96 @@
+#ifndef DORY_MESH_OPTIMIZER_INCL
+#define DORY_MESH_OPTIMIZER_INCL
+
+#include "renderer/model.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace DORY
+{
+    /**
+     * @brief reorders the triangles and vertices of a mesh for the GPU. none of the passes change what
+     * is drawn, only the order it is drawn in:
+     *      1. triangles are reordered so that consecutive triangles share vertices that are still in the
+     *         post-transform vertex cache (Tipsify, Sander et al. 2007)
+     *      2. the result is cut into clusters that keep that locality, and the clusters are sorted so that
+     *         the ones facing away from the centre of the mesh are drawn first, which reduces overdraw
+     *      3. vertices are renumbered in the order they are first used, so vertex fetches walk memory
+     *         forwards
+     */
+    class MeshOptimizer
+    {
+        public:
+            /**
+             * @brief size of the FIFO vertex cache that is optimized for and simulated
+             */
+            static constexpr uint32_t DEFAULT_CACHE_SIZE = 16;
+
+            /**
+             * @brief results of simulating the post-transform vertex cache
+             */
+            struct VertexCacheStats
+            {
+                uint32_t transformed = 0; // number of vertices the vertex shader runs on
+                float acmr = 0.0f; // average cache miss ratio, transformed vertices per triangle. 0.5 is the best possible, 3 the worst
+                float atvr = 0.0f; // average transformed vertex ratio, transformed vertices per vertex. 1 is the best possible
+            };
+
+            /**
+             * @brief cache statistics before and after Optimize()
+             */
+            struct Stats
+            {
+                VertexCacheStats before{};
+                VertexCacheStats after{};
+            };
+
+            /**
+             * @brief run all passes on a mesh. unreferenced vertices are removed and the bounds recomputed
+             * @param mesh the mesh to optimize
+             * @param cache_size (optional) size of the vertex cache to optimize for
+             * @return Stats
+             */
+            static Stats Optimize(Model::Mesh& mesh, uint32_t cache_size = DEFAULT_CACHE_SIZE);
+
+            /**
+             * @brief simulate a FIFO post-transform vertex cache over a triangle list
+             * @param indices three indices per triangle
+             * @param vertex_count number of vertices referenced by the indices
+             * @param cache_size (optional) number of entries in the cache
+             * @return VertexCacheStats
+             */
+            static VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size = DEFAULT_CACHE_SIZE);
+
+            /**
+             * @brief reorder triangles to improve vertex cache hits, using Tipsify
+             * @param indices three indices per triangle, reordered in place
+             * @param vertex_count number of vertices referenced by the indices
+             * @param cache_size (optional) number of entries in the cache
+             */
+            static void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size = DEFAULT_CACHE_SIZE);
+
+            /**
+             * @brief reorder clusters of triangles to reduce overdraw. the indices should already be
+             * optimized for the vertex cache; the clusters are chosen so that the cache miss ratio grows
+             * by at most the given factor
+             * @param indices three indices per triangle, reordered in place
+             * @param vertices the vertices referenced by the indices
+             * @param threshold (optional) how much the cache miss ratio may grow, e.g. 1.05 for 5%
+             * @param cache_size (optional) number of entries in the cache
+             */
+            static void OptimizeOverdraw(   std::vector<uint32_t>& indices,
+                                            const std::vector<Model::Vertex>& vertices,
+                                            float threshold = 1.05f,
+                                            uint32_t cache_size = DEFAULT_CACHE_SIZE);
+
+            /**
+             * @brief renumber vertices in the order the indices first use them, dropping vertices that
+             * are not used at all
+             * @param mesh the mesh whose vertices are reordered
+             */
+            static void OptimizeVertexFetch(Model::Mesh& mesh);
+    }; // class MeshOptimizer
+} // namespace DORY
+
+#endif // DORY_MESH_OPTIMIZER_INCL
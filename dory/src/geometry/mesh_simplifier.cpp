@@ -0,0 +1,348 @@
+#include "geometry/mesh_optimizer.h"
+#include "geometry/mesh_simplifier.h"
+#include "math/hash.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace DORY
+{
+    /**
+     * @brief sum of squared distances to a set of weighted planes, stored as the symmetric 4x4 matrix
+     * of the quadric form p^T A p + 2 b^T p + c
+     */
+    struct Quadric
+    {
+        double a00 = 0.0, a11 = 0.0, a22 = 0.0, a01 = 0.0, a02 = 0.0, a12 = 0.0;
+        double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+        double c = 0.0;
+        double weight = 0.0; // total weight of the planes
+
+        /**
+         * @brief quadric of the plane n.p + d = 0, n normalized
+         */
+        static Quadric FromPlane(const glm::dvec3& n, double d, double weight)
+        {
+            Quadric q{};
+            q.a00 = n.x * n.x * weight;
+            q.a11 = n.y * n.y * weight;
+            q.a22 = n.z * n.z * weight;
+            q.a01 = n.x * n.y * weight;
+            q.a02 = n.x * n.z * weight;
+            q.a12 = n.y * n.z * weight;
+            q.b0 = n.x * d * weight;
+            q.b1 = n.y * d * weight;
+            q.b2 = n.z * d * weight;
+            q.c = d * d * weight;
+            q.weight = weight;
+            return q;
+        }
+
+        void operator+=(const Quadric& q)
+        {
+            a00 += q.a00; a11 += q.a11; a22 += q.a22;
+            a01 += q.a01; a02 += q.a02; a12 += q.a12;
+            b0 += q.b0; b1 += q.b1; b2 += q.b2;
+            c += q.c;
+            weight += q.weight;
+        }
+
+        /**
+         * @brief weighted mean squared distance of a point to the planes
+         */
+        double Error(const glm::vec3& p) const
+        {
+            const double x = p.x, y = p.y, z = p.z;
+            const double r = a00 * x * x + a11 * y * y + a22 * z * z +
+                             2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                             2.0 * (b0 * x + b1 * y + b2 * z) + c;
+            return weight > 0.0 ? std::fabs(r) / weight : 0.0;
+        }
+    };
+
+    /**
+     * @brief what may happen to a vertex
+     */
+    enum class VertexKind : uint8_t
+    {
+        Manifold, // may collapse onto any neighbour
+        Border, // on an open edge, may only collapse along it
+        Locked // never removed
+    };
+
+    /**
+     * @brief a possible collapse of one vertex onto a neighbour
+     */
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        float error;
+    };
+
+    /**
+     * @brief key of a directed edge between two position groups
+     */
+    static inline uint64_t EdgeKey(uint32_t a, uint32_t b)
+    {
+        return (static_cast<uint64_t>(a) << 32) | b;
+    }
+
+    /**
+     * @brief check whether moving a vertex keeps every triangle around it facing the same way
+     */
+    static bool PreservesOrientation(   const std::vector<Model::Vertex>& vertices,
+                                        const std::vector<uint32_t>& indices,
+                                        const std::vector<uint32_t>& offsets,
+                                        const std::vector<uint32_t>& adjacency,
+                                        uint32_t from,
+                                        uint32_t to)
+    {
+        const glm::vec3& target = vertices[to].a_position;
+        for (uint32_t a = offsets[from]; a < offsets[from + 1]; a++)
+        {
+            const uint32_t triangle = adjacency[a];
+            uint32_t corners[3] = {indices[3 * triangle + 0], indices[3 * triangle + 1], indices[3 * triangle + 2]};
+            if (corners[0] == to || corners[1] == to || corners[2] == to) { continue; } // collapses away
+
+            const glm::vec3& p0 = vertices[corners[0]].a_position;
+            const glm::vec3& p1 = vertices[corners[1]].a_position;
+            const glm::vec3& p2 = vertices[corners[2]].a_position;
+            const glm::vec3 before = glm::cross(p1 - p0, p2 - p0);
+
+            glm::vec3 moved[3] = {p0, p1, p2};
+            for (int k = 0; k < 3; k++)
+            {
+                if (corners[k] == from) { moved[k] = target; }
+            }
+            const glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+
+            // reject flips and triangles that become much thinner
+            if (glm::dot(before, after) < 0.25f * glm::length(before) * glm::length(after)) { return false; }
+        }
+        return true;
+    }
+
+    std::vector<uint32_t> MeshSimplifier::Simplify(const std::vector<Model::Vertex>& vertices, const std::vector<uint32_t>& indices, size_t target_index_count, float target_error, float* result_error)
+    {
+        std::vector<uint32_t> result(indices);
+        const size_t vertex_count = vertices.size();
+        float max_error = 0.0f;
+        if (result_error != nullptr) { *result_error = 0.0f; }
+        if (result.size() <= target_index_count || vertex_count == 0) { return result; }
+
+        // vertices with the same position form a group. the topology and the quadrics are tracked per
+        // group, since a seam splits the surface into several vertices without opening it
+        std::vector<uint32_t> group(vertex_count);
+        std::vector<uint32_t> group_size(vertex_count, 0);
+        {
+            std::unordered_map<uint64_t, uint32_t> first_by_position;
+            first_by_position.reserve(vertex_count);
+            for (uint32_t v = 0; v < vertex_count; v++)
+            {
+                const uint64_t hash = HashBytes(&vertices[v].a_position, sizeof(glm::vec3));
+                uint32_t& first = first_by_position.try_emplace(hash, v).first->second;
+                group[v] = vertices[first].a_position == vertices[v].a_position ? first : v;
+                group_size[group[v]]++;
+            }
+        }
+
+        // an edge is on the border if no triangle uses it in the opposite direction. collapses change
+        // the edges, so this is rebuilt for every pass
+        std::unordered_set<uint64_t> edges;
+        auto build_edges = [&]()
+        {
+            edges.clear();
+            edges.reserve(result.size());
+            for (size_t i = 0; i < result.size(); i++)
+            {
+                const size_t next = i % 3 == 2 ? i - 2 : i + 1;
+                edges.insert(EdgeKey(group[result[i]], group[result[next]]));
+            }
+        };
+        auto is_border_edge = [&](uint32_t a, uint32_t b)
+        {
+            return edges.count(EdgeKey(group[b], group[a])) == 0 || edges.count(EdgeKey(group[a], group[b])) == 0;
+        };
+        build_edges();
+
+        std::vector<VertexKind> kinds(vertex_count, VertexKind::Manifold);
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            const size_t next = i % 3 == 2 ? i - 2 : i + 1;
+            if (!is_border_edge(result[i], result[next])) { continue; }
+            kinds[result[i]] = VertexKind::Border;
+            kinds[result[next]] = VertexKind::Border;
+        }
+        for (uint32_t v = 0; v < vertex_count; v++)
+        {
+            if (group_size[group[v]] > 1) { kinds[v] = VertexKind::Locked; }
+        }
+
+        // plane quadrics of the triangles, plus planes through the border edges perpendicular to the
+        // surface so that the outline of open meshes is kept
+        std::vector<Quadric> quadrics(vertex_count);
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            const glm::vec3& p0 = vertices[result[i + 0]].a_position;
+            const glm::vec3& p1 = vertices[result[i + 1]].a_position;
+            const glm::vec3& p2 = vertices[result[i + 2]].a_position;
+            const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            const float area = glm::length(normal);
+            if (area == 0.0f) { continue; }
+
+            const glm::dvec3 n(normal / area);
+            const Quadric q = Quadric::FromPlane(n, -(n.x * p0.x + n.y * p0.y + n.z * p0.z), area);
+            for (int k = 0; k < 3; k++) { quadrics[group[result[i + k]]] += q; }
+
+            for (int k = 0; k < 3; k++)
+            {
+                const uint32_t a = result[i + k];
+                const uint32_t b = result[i + (k + 1) % 3];
+                if (!is_border_edge(a, b)) { continue; }
+
+                const glm::vec3 edge = vertices[b].a_position - vertices[a].a_position;
+                const float length = glm::length(edge);
+                if (length == 0.0f) { continue; }
+                const glm::vec3 edge_normal = glm::cross(edge, normal / area) / length;
+                const glm::dvec3 en(edge_normal);
+                const glm::vec3& pa = vertices[a].a_position;
+                const Quadric border = Quadric::FromPlane(en, -(en.x * pa.x + en.y * pa.y + en.z * pa.z), 10.0 * length * length);
+                quadrics[group[a]] += border;
+                quadrics[group[b]] += border;
+            }
+        }
+
+        std::vector<uint32_t> offsets(vertex_count + 1);
+        std::vector<uint32_t> adjacency;
+        std::vector<Collapse> collapses;
+        std::vector<uint32_t> remap(vertex_count);
+        std::vector<uint8_t> locked(vertex_count);
+        const double error_limit = static_cast<double>(target_error) * static_cast<double>(target_error);
+
+        for (bool first_pass = true; result.size() > target_index_count; first_pass = false)
+        {
+            if (!first_pass) { build_edges(); }
+
+            // triangles around each vertex
+            std::fill(offsets.begin(), offsets.end(), 0);
+            for (uint32_t index : result) { offsets[index + 1]++; }
+            for (size_t v = 0; v < vertex_count; v++) { offsets[v + 1] += offsets[v]; }
+            adjacency.resize(result.size());
+            {
+                std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+                for (size_t i = 0; i < result.size(); i++) { adjacency[fill[result[i]]++] = static_cast<uint32_t>(i / 3); }
+            }
+
+            // the cheaper allowed direction of every edge
+            collapses.clear();
+            for (size_t i = 0; i < result.size(); i += 3)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    const uint32_t a = result[i + k];
+                    const uint32_t b = result[i + (k + 1) % 3];
+                    if (group[a] == group[b]) { continue; }
+
+                    auto allowed = [&](uint32_t from, uint32_t to)
+                    {
+                        if (kinds[from] == VertexKind::Manifold) { return true; }
+                        return kinds[from] == VertexKind::Border && kinds[to] != VertexKind::Manifold && is_border_edge(from, to);
+                    };
+
+                    const double error_ab = allowed(a, b) ? quadrics[group[a]].Error(vertices[b].a_position) : 1e300;
+                    const double error_ba = allowed(b, a) ? quadrics[group[b]].Error(vertices[a].a_position) : 1e300;
+                    const double error = std::min(error_ab, error_ba);
+                    if (error > error_limit) { continue; }
+
+                    if (error_ab <= error_ba) { collapses.push_back({a, b, static_cast<float>(error)}); }
+                    else { collapses.push_back({b, a, static_cast<float>(error)}); }
+                }
+            }
+            if (collapses.empty()) { break; }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+
+            // a manifold collapse removes two triangles. collapse the cheapest edges first and leave the
+            // neighbourhood of a collapsed vertex alone for the rest of the pass
+            const size_t triangle_goal = (result.size() - target_index_count) / 3;
+            size_t triangles_removed = 0;
+            for (uint32_t v = 0; v < vertex_count; v++) { remap[v] = v; }
+            std::fill(locked.begin(), locked.end(), 0);
+
+            for (const Collapse& collapse : collapses)
+            {
+                if (triangles_removed >= triangle_goal) { break; }
+                if (locked[collapse.from] || locked[collapse.to]) { continue; }
+                if (!PreservesOrientation(vertices, result, offsets, adjacency, collapse.from, collapse.to)) { continue; }
+
+                for (uint32_t a = offsets[collapse.from]; a < offsets[collapse.from + 1]; a++)
+                {
+                    const uint32_t triangle = adjacency[a];
+                    bool removed = false;
+                    for (int k = 0; k < 3; k++)
+                    {
+                        const uint32_t v = result[3 * triangle + k];
+                        locked[v] = 1;
+                        removed |= v == collapse.to;
+                    }
+                    triangles_removed += removed;
+                }
+
+                remap[collapse.from] = collapse.to;
+                quadrics[group[collapse.to]] += quadrics[group[collapse.from]];
+                max_error = std::max(max_error, collapse.error);
+            }
+
+            // apply the collapses and drop the triangles that became degenerate
+            size_t write = 0;
+            for (size_t i = 0; i < result.size(); i += 3)
+            {
+                const uint32_t a = remap[result[i + 0]];
+                const uint32_t b = remap[result[i + 1]];
+                const uint32_t c = remap[result[i + 2]];
+                if (a == b || b == c || c == a) { continue; }
+
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+            if (write == result.size()) { break; } // nothing could be collapsed
+            result.resize(write);
+        }
+
+        if (result_error != nullptr) { *result_error = std::sqrt(max_error); }
+        return result;
+    }
+
+    void MeshSimplifier::BuildLods(Model::Mesh& mesh, uint32_t lod_count, float reduction)
+    {
+        mesh.lods.clear();
+        mesh.lods.push_back({0, static_cast<uint32_t>(mesh.indices.size()), 0.0f});
+
+        std::vector<uint32_t> previous(mesh.indices);
+        float error = 0.0f;
+        for (uint32_t level = 1; level < lod_count; level++)
+        {
+            const size_t target = static_cast<size_t>(static_cast<float>(previous.size() / 3) * reduction) * 3;
+            float step_error = 0.0f;
+            std::vector<uint32_t> lod = Simplify(mesh.vertices, previous, target, 1e30f, &step_error);
+
+            // stop once a level is not meaningfully smaller than the one before it
+            if (lod.empty() || lod.size() * 10 > previous.size() * 9) { break; }
+
+            MeshOptimizer::OptimizeVertexCache(lod, mesh.vertices.size());
+            error += step_error; // each level is simplified from the previous one, so the errors add up
+
+            Model::Mesh::Lod range{};
+            range.first_index = static_cast<uint32_t>(mesh.indices.size());
+            range.index_count = static_cast<uint32_t>(lod.size());
+            range.error = error;
+            mesh.lods.push_back(range);
+            mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+            previous.swap(lod);
+        }
+    }
+} // namespace DORY
\ No newline at end of file
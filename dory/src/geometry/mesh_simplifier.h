@@ -0,0 +1,55 @@
+#ifndef DORY_MESH_SIMPLIFIER_INCL
+#define DORY_MESH_SIMPLIFIER_INCL
+
+#include "renderer/model.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace DORY
+{
+    /**
+     * @brief reduces the number of triangles of a mesh with quadric error metrics (Garland and Heckbert
+     * 1997). only edge collapses that move a vertex onto one of its neighbours are used, so a simplified
+     * mesh is a new index list into the original vertices and all levels of detail can share one vertex
+     * buffer. vertices on a seam (same position, different attributes) are never removed, and vertices
+     * on a border only move along the border, so neither tears open.
+     */
+    class MeshSimplifier
+    {
+        public:
+            /**
+             * @brief number of triangles of each level relative to the level before it
+             */
+            static constexpr float DEFAULT_LOD_REDUCTION = 0.5f;
+
+            /**
+             * @brief simplify a triangle list
+             * @param vertices the vertices referenced by the indices
+             * @param indices three indices per triangle
+             * @param target_index_count stop once the result has this many indices or fewer
+             * @param target_error (optional) stop before a collapse would move the surface further than
+             * this, in model space units
+             * @param result_error (optional) set to the largest error of the collapses that were made
+             * @return std::vector<uint32_t> the simplified triangle list
+             */
+            static std::vector<uint32_t> Simplify(  const std::vector<Model::Vertex>& vertices,
+                                                    const std::vector<uint32_t>& indices,
+                                                    size_t target_index_count,
+                                                    float target_error = 1e30f,
+                                                    float* result_error = nullptr);
+
+            /**
+             * @brief append levels of detail to a mesh. the indices of each level are appended to
+             * mesh.indices and optimized for the vertex cache, and mesh.lods lists the index range of
+             * every level, starting with the full mesh. fewer levels are built if the mesh cannot be
+             * simplified any further
+             * @param mesh the mesh to extend
+             * @param lod_count number of levels including the full mesh
+             * @param reduction (optional) number of triangles of each level relative to the one before it
+             */
+            static void BuildLods(Model::Mesh& mesh, uint32_t lod_count, float reduction = DEFAULT_LOD_REDUCTION);
+    }; // class MeshSimplifier
+} // namespace DORY
+
+#endif // DORY_MESH_SIMPLIFIER_INCL
\ No newline at end of file
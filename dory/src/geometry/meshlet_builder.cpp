@@ -0,0 +1,224 @@
+#include "geometry/meshlet_builder.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace DORY
+{
+    /**
+     * @brief how much a triangle facing away from the meshlet counts against it, in new vertices. a
+     * triangle at right angles to the meshlet costs as much as one extra vertex
+     */
+    static constexpr float CONE_WEIGHT = 1.0f;
+
+    MeshletBuilder::Stats MeshletBuilder::Build(Model::Mesh& mesh, uint32_t max_vertices, uint32_t max_triangles)
+    {
+        mesh.meshlets.clear();
+        if (mesh.lods.empty())
+        {
+            BuildRange(mesh.vertices, mesh.indices, 0, static_cast<uint32_t>(mesh.indices.size()), max_vertices, max_triangles, mesh.meshlets);
+        }
+
+        for (Model::Mesh::Lod& lod : mesh.lods)
+        {
+            lod.first_meshlet = static_cast<uint32_t>(mesh.meshlets.size());
+            BuildRange(mesh.vertices, mesh.indices, lod.first_index, lod.index_count, max_vertices, max_triangles, mesh.meshlets);
+            lod.meshlet_count = static_cast<uint32_t>(mesh.meshlets.size()) - lod.first_meshlet;
+        }
+
+        Stats stats{};
+        stats.meshlet_count = static_cast<uint32_t>(mesh.meshlets.size());
+        if (stats.meshlet_count == 0) { return stats; }
+
+        for (const Model::Mesh::Meshlet& meshlet : mesh.meshlets)
+        {
+            if (meshlet.cone_cutoff > 0.0f) { stats.cone_count++; }
+            stats.average_vertices += static_cast<float>(meshlet.vertex_count);
+            stats.average_triangles += static_cast<float>(meshlet.triangle_count);
+        }
+        stats.average_vertices /= static_cast<float>(stats.meshlet_count);
+        stats.average_triangles /= static_cast<float>(stats.meshlet_count);
+        return stats;
+    }
+
+    void MeshletBuilder::BuildRange(const std::vector<Model::Vertex>& vertices,
+                                    std::vector<uint32_t>& indices,
+                                    uint32_t first_index,
+                                    uint32_t index_count,
+                                    uint32_t max_vertices,
+                                    uint32_t max_triangles,
+                                    std::vector<Model::Mesh::Meshlet>& meshlets)
+    {
+        const uint32_t* range = indices.data() + first_index;
+        const size_t triangle_count = index_count / 3;
+        const size_t vertex_count = vertices.size();
+        if (triangle_count == 0) { return; }
+
+        // triangles adjacent to each vertex, the triangles of vertex v are adjacency[offsets[v]] ... adjacency[offsets[v + 1] - 1]
+        std::vector<uint32_t> offsets(vertex_count + 1, 0);
+        for (size_t i = 0; i < triangle_count * 3; i++) { offsets[range[i] + 1]++; }
+        for (size_t v = 0; v < vertex_count; v++) { offsets[v + 1] += offsets[v]; }
+        std::vector<uint32_t> adjacency(triangle_count * 3);
+        {
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < triangle_count * 3; i++) { adjacency[fill[range[i]]++] = static_cast<uint32_t>(i / 3); }
+        }
+
+        std::vector<glm::vec3> normals(triangle_count);
+        for (size_t t = 0; t < triangle_count; t++)
+        {
+            const glm::vec3& p0 = vertices[range[3 * t + 0]].a_position;
+            const glm::vec3& p1 = vertices[range[3 * t + 1]].a_position;
+            const glm::vec3& p2 = vertices[range[3 * t + 2]].a_position;
+            const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            const float length = glm::length(normal);
+            normals[t] = length > 0.0f ? normal / length : glm::vec3{0.0f};
+        }
+
+        std::vector<uint8_t> emitted(triangle_count, 0);
+        std::vector<uint32_t> owner(vertex_count, UINT32_MAX); // the meshlet that last used each vertex
+        std::vector<uint32_t> meshlet_vertices{};
+        std::vector<uint32_t> output{};
+        output.reserve(triangle_count * 3);
+
+        uint32_t meshlet = 0; // number of the meshlet being built, within the range
+        uint32_t meshlet_triangles = 0;
+        glm::vec3 normal_sum{0.0f};
+        size_t cursor = 0; // triangles before this have all been emitted
+
+        auto new_vertices = [&](size_t triangle)
+        {
+            return  static_cast<uint32_t>(owner[range[3 * triangle + 0]] != meshlet) +
+                    static_cast<uint32_t>(owner[range[3 * triangle + 1]] != meshlet) +
+                    static_cast<uint32_t>(owner[range[3 * triangle + 2]] != meshlet);
+        };
+
+        auto finish = [&]()
+        {
+            Model::Mesh::Meshlet result{};
+            result.first_index = first_index + static_cast<uint32_t>(output.size()) - 3 * meshlet_triangles;
+            result.triangle_count = meshlet_triangles;
+            result.vertex_count = static_cast<uint32_t>(meshlet_vertices.size());
+            meshlets.push_back(result);
+
+            meshlet++;
+            meshlet_triangles = 0;
+            meshlet_vertices.clear();
+            normal_sum = glm::vec3{0.0f};
+        };
+
+        for (size_t emitted_count = 0; emitted_count < triangle_count; emitted_count++)
+        {
+            // grow the meshlet with the cheapest triangle touching one of its vertices
+            const float axis_length = glm::length(normal_sum);
+            const glm::vec3 axis = axis_length > 0.0f ? normal_sum / axis_length : glm::vec3{0.0f};
+            int64_t best = -1;
+            float best_score = FLT_MAX;
+            for (uint32_t v : meshlet_vertices)
+            {
+                for (uint32_t a = offsets[v]; a < offsets[v + 1]; a++)
+                {
+                    const uint32_t triangle = adjacency[a];
+                    if (emitted[triangle]) { continue; }
+
+                    const uint32_t added = new_vertices(triangle);
+                    if (meshlet_vertices.size() + added > max_vertices) { continue; }
+
+                    const float score = static_cast<float>(added) + CONE_WEIGHT * (1.0f - glm::dot(normals[triangle], axis));
+                    if (score < best_score)
+                    {
+                        best_score = score;
+                        best = triangle;
+                    }
+                }
+            }
+
+            // otherwise continue with the next triangle in index order, which is usually close by when the
+            // indices have been optimized for the vertex cache, and start a new meshlet if it does not fit
+            if (best < 0)
+            {
+                while (emitted[cursor]) { cursor++; }
+                best = static_cast<int64_t>(cursor);
+                if (meshlet_triangles > 0 && meshlet_vertices.size() + new_vertices(cursor) > max_vertices) { finish(); }
+            }
+
+            for (size_t k = 0; k < 3; k++)
+            {
+                const uint32_t v = range[3 * best + k];
+                output.push_back(v);
+                if (owner[v] != meshlet)
+                {
+                    owner[v] = meshlet;
+                    meshlet_vertices.push_back(v);
+                }
+            }
+            emitted[best] = 1;
+            normal_sum += normals[best];
+            meshlet_triangles++;
+
+            if (meshlet_triangles == max_triangles) { finish(); }
+        }
+        if (meshlet_triangles > 0) { finish(); }
+
+        std::copy(output.begin(), output.end(), indices.begin() + first_index);
+        for (size_t m = meshlets.size() - meshlet; m < meshlets.size(); m++)
+        {
+            ComputeBounds(vertices, indices, meshlets[m]);
+        }
+    }
+
+    void MeshletBuilder::ComputeBounds(const std::vector<Model::Vertex>& vertices, const std::vector<uint32_t>& indices, Model::Mesh::Meshlet& meshlet)
+    {
+        const uint32_t* triangles = indices.data() + meshlet.first_index;
+        const size_t corner_count = static_cast<size_t>(meshlet.triangle_count) * 3;
+        if (corner_count == 0) { return; }
+
+        // the sphere is centred on the bounding box, which is close to minimal for such small clusters
+        glm::vec3 min = vertices[triangles[0]].a_position;
+        glm::vec3 max = min;
+        for (size_t i = 1; i < corner_count; i++)
+        {
+            min = glm::min(min, vertices[triangles[i]].a_position);
+            max = glm::max(max, vertices[triangles[i]].a_position);
+        }
+        meshlet.center = (min + max) * 0.5f;
+        meshlet.radius = 0.0f;
+        for (size_t i = 0; i < corner_count; i++)
+        {
+            meshlet.radius = glm::max(meshlet.radius, glm::length(vertices[triangles[i]].a_position - meshlet.center));
+        }
+
+        // the cone axis is the mean of the unit normals, and the cutoff the widest angle away from it.
+        // degenerate triangles cover no pixels, so they do not widen the cone
+        auto triangle_normal = [&](uint32_t t)
+        {
+            const glm::vec3& p0 = vertices[triangles[3 * t + 0]].a_position;
+            const glm::vec3& p1 = vertices[triangles[3 * t + 1]].a_position;
+            const glm::vec3& p2 = vertices[triangles[3 * t + 2]].a_position;
+            const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            const float length = glm::length(normal);
+            return length > 0.0f ? normal / length : glm::vec3{0.0f};
+        };
+
+        glm::vec3 normal_sum{0.0f};
+        for (uint32_t t = 0; t < meshlet.triangle_count; t++) { normal_sum += triangle_normal(t); }
+
+        const float axis_length = glm::length(normal_sum);
+        if (axis_length == 0.0f)
+        {
+            meshlet.cone_axis = glm::vec3{0.0f};
+            meshlet.cone_cutoff = -1.0f;
+            return;
+        }
+
+        meshlet.cone_axis = normal_sum / axis_length;
+        meshlet.cone_cutoff = 1.0f;
+        for (uint32_t t = 0; t < meshlet.triangle_count; t++)
+        {
+            const glm::vec3 normal = triangle_normal(t);
+            if (normal == glm::vec3{0.0f}) { continue; }
+            meshlet.cone_cutoff = glm::min(meshlet.cone_cutoff, glm::dot(normal, meshlet.cone_axis));
+        }
+    }
+} // namespace DORY
\ No newline at end of file
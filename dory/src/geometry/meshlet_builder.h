@@ -0,0 +1,82 @@
+#ifndef DORY_MESHLET_BUILDER_INCL
+#define DORY_MESHLET_BUILDER_INCL
+
+#include "renderer/model.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace DORY
+{
+    /**
+     * @brief splits the triangles of a mesh into meshlets, small clusters of neighbouring triangles that
+     * can be culled on their own. a meshlet grows one triangle at a time, preferring triangles that add
+     * the fewest new vertices and that face the same way as the rest of the meshlet, so that the normal
+     * cone stays narrow enough to cull the meshlet when it faces away from the camera. the triangles of
+     * each meshlet are moved next to each other in the index buffer, so a meshlet is just an index range
+     */
+    class MeshletBuilder
+    {
+        public:
+            /**
+             * @brief largest number of distinct vertices in a meshlet
+             */
+            static constexpr uint32_t DEFAULT_MAX_VERTICES = 64;
+
+            /**
+             * @brief largest number of triangles in a meshlet
+             */
+            static constexpr uint32_t DEFAULT_MAX_TRIANGLES = 124;
+
+            /**
+             * @brief summary of the meshlets that were built
+             */
+            struct Stats
+            {
+                uint32_t meshlet_count = 0; // number of meshlets over all levels of detail
+                uint32_t cone_count = 0; // number of meshlets whose triangles all face within 90 degrees of each other
+                float average_vertices = 0.0f; // distinct vertices per meshlet
+                float average_triangles = 0.0f; // triangles per meshlet
+            };
+
+            /**
+             * @brief build the meshlets of every level of detail of a mesh. the indices of each level are
+             * reordered within the level, and its meshlet range is written to its entry in mesh.lods
+             * @param mesh the mesh to split
+             * @param max_vertices (optional) largest number of distinct vertices in a meshlet
+             * @param max_triangles (optional) largest number of triangles in a meshlet
+             * @return Stats
+             */
+            static Stats Build( Model::Mesh& mesh,
+                                uint32_t max_vertices = DEFAULT_MAX_VERTICES,
+                                uint32_t max_triangles = DEFAULT_MAX_TRIANGLES);
+
+            /**
+             * @brief split a range of a triangle list into meshlets
+             * @param vertices the vertices referenced by the indices
+             * @param indices the triangle list, reordered in place within the range
+             * @param first_index first index of the range
+             * @param index_count number of indices in the range
+             * @param max_vertices largest number of distinct vertices in a meshlet
+             * @param max_triangles largest number of triangles in a meshlet
+             * @param meshlets the meshlets of the range are appended to this list
+             */
+            static void BuildRange( const std::vector<Model::Vertex>& vertices,
+                                    std::vector<uint32_t>& indices,
+                                    uint32_t first_index,
+                                    uint32_t index_count,
+                                    uint32_t max_vertices,
+                                    uint32_t max_triangles,
+                                    std::vector<Model::Mesh::Meshlet>& meshlets);
+
+            /**
+             * @brief compute the bounding sphere and normal cone of a meshlet from its triangles
+             * @param vertices the vertices referenced by the indices
+             * @param indices the triangle list holding the meshlet
+             * @param meshlet the meshlet, whose first_index and triangle_count have to be set
+             */
+            static void ComputeBounds(const std::vector<Model::Vertex>& vertices, const std::vector<uint32_t>& indices, Model::Mesh::Meshlet& meshlet);
+    }; // class MeshletBuilder
+} // namespace DORY
+
+#endif // DORY_MESHLET_BUILDER_INCL
\ No newline at end of file
@@ -0,0 +1,256 @@
+#include "core/logger.h"
+#include "loaders/asset_registry.h"
+#include "math/hash.h"
+#include "utils/mapped_file.h"
+
+#include <filesystem>
+#include <stdexcept>
+
+namespace DORY
+{
+    AssetRegistry::AssetRegistry(Device& device)
+        : m_device(device), m_upload_context(device), m_residency(device, m_upload_context), m_defragmenter(device, m_upload_context)
+    {
+    }
+
+    AssetRegistry::~AssetRegistry()
+    {
+        // the models are destroyed before the upload context, so their copies have to finish first
+        m_upload_context.WaitIdle();
+    }
+
+    std::shared_ptr<Model> AssetRegistry::LoadModel(const std::string& path)
+    {
+        return LoadModel(path, Model::LoadOptions{});
+    }
+
+    std::shared_ptr<Model> AssetRegistry::LoadModel(const std::string& path, const Model::LoadOptions& options)
+    {
+        std::string canonical_path;
+        const ModelKey key = MakeKey(path, options, canonical_path);
+
+        auto it = m_models.find(key);
+        if (it != m_models.end())
+        {
+            m_stats.hits++;
+            DTRACE("Reusing model: %s", path.c_str());
+
+            // the model may have come from a background load whose upload is still in flight
+            if (!m_upload_context.IsComplete(it->second->GetUploadBatch())) { m_needs_acquire = true; }
+            return it->second;
+        }
+
+        // the copies are only recorded here, and submitted together with those of other loads by the
+        // next Update(), which also hands them to the graphics queue ahead of the frame drawing the model
+        m_stats.misses++;
+        m_needs_acquire = true;
+        std::shared_ptr<Model> model = Model::LoadModelFromFile(m_device, canonical_path, options, &m_upload_context);
+        m_models.emplace(key, model);
+        m_defragmenter.Register(model);
+        if (options.evictable) { m_residency.Register(model); }
+        return model;
+    }
+
+    ModelHandle AssetRegistry::LoadModelAsync(const std::string& path)
+    {
+        return LoadModelAsync(path, Model::LoadOptions{});
+    }
+
+    ModelHandle AssetRegistry::LoadModelAsync(const std::string& path, const Model::LoadOptions& options)
+    {
+        // the file is not touched here, so identical requests are only recognized by their path until
+        // a worker has hashed the contents
+        const std::string request = path + (options.optimize ? "|o|" : "|-|") + std::to_string(static_cast<uint32_t>(options.vertex_format)) + "|" + std::to_string(options.lod_count) + (options.meshlets ? "|m" : "|-") + (options.evictable ? "|e" : "|-");
+        auto it = m_pending.find(request);
+        if (it != m_pending.end()) { return ModelHandle(it->second); }
+
+        auto state = std::make_shared<ModelHandle::State>();
+        state->path = path;
+        state->options = options;
+        m_pending.emplace(request, state);
+
+        m_workers.Submit([this, state]() { LoadOnWorker(state); });
+        return ModelHandle(state);
+    }
+
+    void AssetRegistry::Update()
+    {
+        std::vector<CompletedLoad> completed;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            completed.swap(m_completed);
+        }
+
+        for (auto& load : completed)
+        {
+            ModelHandle::State& state = *load.state;
+            for (auto it = m_pending.begin(); it != m_pending.end(); ++it)
+            {
+                if (it->second == load.state)
+                {
+                    m_pending.erase(it);
+                    break;
+                }
+            }
+
+            if (state.status.load(std::memory_order_acquire) == ModelHandle::Status::Failed)
+            {
+                DERROR("Failed to load model %s: %s", state.path.c_str(), state.error.c_str());
+                continue;
+            }
+
+            auto it = m_models.find(load.key);
+            if (it != m_models.end())
+            {
+                m_stats.hits++;
+                state.model = it->second;
+            }
+            else
+            {
+                // record the copies into the current upload batch, they are submitted together below
+                m_stats.misses++;
+                state.model = std::make_shared<Model>(m_device, state.mesh, state.options.vertex_format, &m_upload_context, state.options.evictable);
+                m_models.emplace(load.key, state.model);
+                m_defragmenter.Register(state.model);
+                if (state.options.evictable) { m_residency.Register(state.model); }
+            }
+            state.mesh = Model::Mesh{};
+            state.status.store(ModelHandle::Status::Uploading, std::memory_order_release);
+            m_uploading.push_back(load.state);
+        }
+
+        // models returned by LoadModel() can be drawn right away, so their batches cannot wait until the
+        // copies have finished to be handed over
+        m_upload_context.Submit();
+        if (m_needs_acquire)
+        {
+            m_upload_context.Acquire();
+            m_needs_acquire = false;
+        }
+        m_upload_context.Poll();
+
+        for (size_t i = 0; i < m_uploading.size();)
+        {
+            if (m_upload_context.IsComplete(m_uploading[i]->model->GetUploadBatch()))
+            {
+                m_uploading[i]->status.store(ModelHandle::Status::Ready, std::memory_order_release);
+                m_uploading[i] = m_uploading.back();
+                m_uploading.pop_back();
+            }
+            else
+            {
+                i++;
+            }
+        }
+    }
+
+    long AssetRegistry::GetReferenceCount(const std::shared_ptr<Model>& model) const
+    {
+        for (const auto& kv : m_models)
+        {
+            if (kv.second == model) { return kv.second.use_count() - 1; }
+        }
+        return 0;
+    }
+
+    size_t AssetRegistry::ReleaseUnused()
+    {
+        size_t released = 0;
+        for (auto it = m_models.begin(); it != m_models.end();)
+        {
+            if (it->second.use_count() == 1)
+            {
+                it = m_models.erase(it);
+                released++;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        return released;
+    }
+
+    AssetRegistry::Stats AssetRegistry::GetStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Stats stats = m_stats;
+        stats.model_count = m_models.size();
+        return stats;
+    }
+
+    AssetRegistry::ModelKey AssetRegistry::MakeKey(const std::string& path, const Model::LoadOptions& options, std::string& canonical_path)
+    {
+        std::error_code error;
+        canonical_path = std::filesystem::weakly_canonical(path, error).string();
+        if (error) { throw std::runtime_error("Failed to resolve model path: " + path); }
+
+        ModelKey key{};
+        key.content_hash = GetContentHash(canonical_path, key.size);
+        key.optimize = options.optimize;
+        key.vertex_format = options.vertex_format;
+        key.lod_count = options.lod_count;
+        key.meshlets = options.meshlets;
+        key.evictable = options.evictable;
+        return key;
+    }
+
+    uint64_t AssetRegistry::GetContentHash(const std::string& path, uint64_t& size)
+    {
+        std::error_code error;
+        size = static_cast<uint64_t>(std::filesystem::file_size(path, error));
+        if (error) { throw std::runtime_error("Failed to open model file: " + path); }
+        const int64_t time = static_cast<int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_file_stamps.find(path);
+            if (!error && it != m_file_stamps.end() && it->second.size == size && it->second.time == time)
+            {
+                return it->second.content_hash;
+            }
+        }
+
+        MappedFile file(path);
+        if (!file.IsOpen()) { throw std::runtime_error("Failed to open model file: " + path); }
+
+        FileStamp stamp{};
+        stamp.size = file.GetSize();
+        stamp.time = time;
+        stamp.content_hash = HashBytes(file.GetData(), file.GetSize());
+        size = stamp.size;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.hashed_bytes += file.GetSize();
+        m_file_stamps[path] = stamp;
+        return stamp.content_hash;
+    }
+
+    void AssetRegistry::LoadOnWorker(const std::shared_ptr<ModelHandle::State>& state)
+    {
+        CompletedLoad load{};
+        load.state = state;
+        try
+        {
+            std::string canonical_path;
+            load.key = MakeKey(state->path, state->options, canonical_path);
+            Model::LoadMeshFromFile(state->mesh, canonical_path, state->options);
+        }
+        catch (const std::exception& e)
+        {
+            state->error = e.what();
+            state->mesh = Model::Mesh{};
+            state->status.store(ModelHandle::Status::Failed, std::memory_order_release);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_completed.push_back(std::move(load));
+    }
+
+    size_t AssetRegistry::ModelKeyHash::operator()(const ModelKey& key) const
+    {
+        size_t seed = 0;
+        HashCombine(seed, key.content_hash, key.size, key.optimize, static_cast<uint32_t>(key.vertex_format), key.lod_count, key.meshlets, key.evictable);
+        return seed;
+    }
+} // namespace DORY
\ No newline at end of file
@@ -0,0 +1,308 @@
+#ifndef DORY_ASSET_REGISTRY_INCL
+#define DORY_ASSET_REGISTRY_INCL
+
+#include "renderer/defragmenter.h"
+#include "renderer/device.h"
+#include "renderer/model.h"
+#include "renderer/residency_manager.h"
+#include "renderer/upload_context.h"
+#include "utils/nocopy.h"
+#include "utils/worker_pool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace DORY
+{
+    /**
+     * @brief handle to a model that is loaded in the background by AssetRegistry::LoadModelAsync(). the
+     * handle can be polled from any thread; the model becomes available once it has been parsed and its
+     * upload to the GPU has finished.
+     */
+    class ModelHandle
+    {
+        public:
+            /**
+             * @brief progress of a background load
+             */
+            enum class Status
+            {
+                Loading, // the file is being read and parsed on a worker thread
+                Uploading, // the buffers are being copied to the GPU
+                Ready, // the model can be drawn
+                Failed // the file could not be loaded
+            };
+
+            /**
+             * @brief state shared by the handles of a load and the registry
+             */
+            struct State
+            {
+                std::atomic<Status> status{Status::Loading}; // progress of the load
+                std::string path{}; // path the model was requested with
+                Model::LoadOptions options{}; // options the model was requested with
+                Model::Mesh mesh{}; // parsed mesh, released once it has been uploaded
+                std::string error{}; // why the load failed
+                std::shared_ptr<Model> model{}; // the model, set before the status becomes Ready
+            };
+
+            /**
+             * @brief create an empty handle
+             */
+            ModelHandle() = default;
+
+            /**
+             * @brief get the progress of the load. an empty handle will never have a model and reports Failed
+             * @return Status
+             */
+            Status GetStatus() const { return m_state != nullptr ? m_state->status.load(std::memory_order_acquire) : Status::Failed; }
+
+            /**
+             * @brief check whether the model can be drawn
+             * @return true
+             * @return false
+             */
+            bool IsReady() const { return m_state != nullptr && GetStatus() == Status::Ready; }
+
+            /**
+             * @brief check whether the load failed
+             * @return true
+             * @return false
+             */
+            bool HasFailed() const { return m_state != nullptr && GetStatus() == Status::Failed; }
+
+            /**
+             * @brief get the model
+             * @return std::shared_ptr<Model> nullptr until the model is ready
+             */
+            std::shared_ptr<Model> Get() const { return IsReady() ? m_state->model : nullptr; }
+
+        private: // methods
+            friend class AssetRegistry;
+            explicit ModelHandle(std::shared_ptr<State> state) : m_state(std::move(state)) {}
+
+        private: // members
+            std::shared_ptr<State> m_state{}; // shared with the registry while the load is in progress
+    }; // class ModelHandle
+
+    /**
+     * @brief hands out shared models so that every distinct model is parsed and uploaded only once. a
+     * model is identified by the hash of its file contents together with the load options, so the same
+     * file reached through different paths, or two copies of the same file, share one model. the content
+     * hash of each canonical path is remembered along with the size and modification time of the file,
+     * so a file is only read again when it changes.
+     *
+     * models can also be loaded in the background: files are parsed on worker threads, and Update()
+     * moves finished meshes into device buffers with one batched, non-blocking upload per call.
+     */
+    class AssetRegistry : public NoCopy
+    {
+        public:
+            /**
+             * @brief lookup statistics of the registry
+             */
+            struct Stats
+            {
+                uint64_t hits = 0; // lookups that returned an already loaded model
+                uint64_t misses = 0; // lookups that had to load the model
+                uint64_t hashed_bytes = 0; // bytes read to hash file contents
+                size_t model_count = 0; // models currently held by the registry
+            };
+
+            /**
+             * @brief number of threads reading the files of background loads. they mostly wait for the disk
+             * and for the parsing, which runs on the JobSystem, so a few are enough and more would only
+             * compete with its workers for the cores
+             */
+            static constexpr uint32_t LOAD_THREAD_COUNT = 2;
+
+            /**
+             * @brief create an empty registry
+             * @param device device to create the models on
+             */
+            AssetRegistry(Device& device);
+
+            /**
+             * @brief destroy the registry. models still referenced elsewhere stay alive until their last
+             * handle is released
+             */
+            ~AssetRegistry();
+
+            /**
+             * @brief get a model, loading it only if no model with the same contents and options is held.
+             * the upload of a new model is submitted by the next Update(), which has to run before the
+             * frame that first draws it
+             * @param path path to the model file
+             * @param options how to process the mesh after loading it
+             * @return std::shared_ptr<Model> 
+             */
+            std::shared_ptr<Model> LoadModel(const std::string& path, const Model::LoadOptions& options);
+
+            /**
+             * @brief get a model loaded with the default options
+             * @param path path to the model file
+             * @return std::shared_ptr<Model> 
+             */
+            std::shared_ptr<Model> LoadModel(const std::string& path);
+
+            /**
+             * @brief start loading a model in the background. requests for the same path and options
+             * that are still in progress share one load
+             * @param path path to the model file
+             * @param options how to process the mesh after loading it
+             * @return ModelHandle 
+             */
+            ModelHandle LoadModelAsync(const std::string& path, const Model::LoadOptions& options);
+
+            /**
+             * @brief start loading a model with the default options in the background
+             * @param path path to the model file
+             * @return ModelHandle 
+             */
+            ModelHandle LoadModelAsync(const std::string& path);
+
+            /**
+             * @brief create the models of finished background loads, submit their uploads and those of
+             * LoadModel() as one batch, and mark the loads whose uploads have finished as ready. never
+             * waits; call once per frame from the thread that submits to the graphics queue
+             */
+            void Update();
+
+            /**
+             * @brief get the number of background loads that are not ready or failed yet
+             * @return size_t
+             */
+            size_t GetPendingCount() const { return m_pending.size() + m_uploading.size(); }
+
+            /**
+             * @brief get the number of handles to a model outside of the registry
+             * @param model a handle returned by LoadModel()
+             * @return long 0 if the model is not held by the registry
+             */
+            long GetReferenceCount(const std::shared_ptr<Model>& model) const;
+
+            /**
+             * @brief destroy the models that are no longer referenced outside of the registry
+             * @return size_t number of models destroyed
+             */
+            size_t ReleaseUnused();
+
+            /**
+             * @brief get the lookup statistics
+             * @return Stats
+             */
+            Stats GetStats() const;
+
+            /**
+             * @brief get the residency manager that the models loaded with Model::LoadOptions::evictable
+             * are registered with
+             * @return ResidencyManager&
+             */
+            ResidencyManager& GetResidency() { return m_residency; }
+
+            /**
+             * @brief get the defragmenter that every model of the registry is registered with
+             * @return Defragmenter&
+             */
+            Defragmenter& GetDefragmenter() { return m_defragmenter; }
+
+        private: // types
+            /**
+             * @brief identifies a loaded model
+             */
+            struct ModelKey
+            {
+                uint64_t content_hash = 0; // hash of the file contents
+                uint64_t size = 0; // size of the file, guards against hash collisions
+                bool optimize = false; // Model::LoadOptions::optimize
+                Model::VertexFormat vertex_format = Model::VertexFormat::Standard; // Model::LoadOptions::vertex_format
+                uint32_t lod_count = 1; // Model::LoadOptions::lod_count
+                bool meshlets = false; // Model::LoadOptions::meshlets
+                bool evictable = false; // Model::LoadOptions::evictable
+
+                bool operator==(const ModelKey& other) const
+                {
+                    return content_hash == other.content_hash &&
+                           size == other.size &&
+                           optimize == other.optimize &&
+                           vertex_format == other.vertex_format &&
+                           lod_count == other.lod_count &&
+                           meshlets == other.meshlets &&
+                           evictable == other.evictable;
+                }
+            };
+
+            struct ModelKeyHash
+            {
+                size_t operator()(const ModelKey& key) const;
+            };
+
+            /**
+             * @brief content hash of a file as of its last size and modification time
+             */
+            struct FileStamp
+            {
+                uint64_t size = 0;
+                int64_t time = 0;
+                uint64_t content_hash = 0;
+            };
+
+            /**
+             * @brief a background load whose file has been parsed
+             */
+            struct CompletedLoad
+            {
+                std::shared_ptr<ModelHandle::State> state{}; // the load
+                ModelKey key{}; // identifies the parsed model
+            };
+
+        private: // methods
+            /**
+             * @brief resolve the path of a model and identify its contents. safe to call from any thread
+             * @param path path to the model file
+             * @param options how the mesh is processed after loading it
+             * @param canonical_path set to the canonical path of the file
+             * @return ModelKey
+             */
+            ModelKey MakeKey(const std::string& path, const Model::LoadOptions& options, std::string& canonical_path);
+
+            /**
+             * @brief get the hash of the contents of a file, reading the file only if it changed since
+             * it was last hashed. safe to call from any thread
+             * @param path canonical path to the file
+             * @param size set to the size of the file
+             * @return uint64_t
+             */
+            uint64_t GetContentHash(const std::string& path, uint64_t& size);
+
+            /**
+             * @brief read and parse the file of a background load. runs on a worker thread
+             * @param state the load
+             */
+            void LoadOnWorker(const std::shared_ptr<ModelHandle::State>& state);
+
+        private: // members
+            Device& m_device; // device to create the models on
+            UploadContext m_upload_context; // batches the uploads of background loads
+            ResidencyManager m_residency; // evicts and restores the evictable models
+            Defragmenter m_defragmenter; // moves the models to compact the geometry arena
+            bool m_needs_acquire = false; // whether LoadModel() returned a model whose upload has not been handed to the graphics queue
+            std::unordered_map<ModelKey, std::shared_ptr<Model>, ModelKeyHash> m_models{}; // the loaded models
+            std::unordered_map<std::string, FileStamp> m_file_stamps{}; // content hashes by canonical path
+            Stats m_stats{}; // lookup statistics
+
+            std::unordered_map<std::string, std::shared_ptr<ModelHandle::State>> m_pending{}; // background loads being parsed, by path and options
+            std::vector<std::shared_ptr<ModelHandle::State>> m_uploading{}; // background loads waiting for their upload
+            std::vector<CompletedLoad> m_completed{}; // background loads parsed by the workers, waiting for Update()
+            mutable std::mutex m_mutex{}; // guards m_file_stamps, m_stats.hashed_bytes and m_completed
+
+            WorkerPool m_workers{LOAD_THREAD_COUNT}; // parses the files of background loads. declared last so it stops before the rest is destroyed
+    }; // class AssetRegistry
+} // namespace DORY
+
+#endif // DORY_ASSET_REGISTRY_INCL
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include "core/logger.h"
+#include "loaders/mesh_cache.h"
+#include "utils/mapped_file.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+namespace DORY
+{
+    static constexpr char MAGIC[4] = {'D', 'M', 'S', 'H'};
+
+    // the vertex and index arrays are written straight from memory, so the on-disk layout relies on these
+    static_assert(sizeof(MeshCache::Header) == 80, "Unexpected padding in MeshCache::Header");
+    static_assert(sizeof(Model::Vertex) == 11 * sizeof(float), "Unexpected padding in Model::Vertex");
+
+    /**
+     * @brief get the size and modification time of the source file, which together identify the
+     * version of the source a cache was built from
+     */
+    static bool GetSourceStamp(const std::string& source_path, uint64_t& size, int64_t& time)
+    {
+        std::error_code error;
+        size = static_cast<uint64_t>(std::filesystem::file_size(source_path, error));
+        if (error) { return false; }
+
+        time = static_cast<int64_t>(std::filesystem::last_write_time(source_path, error).time_since_epoch().count());
+        return !error;
+    }
+
+    std::string MeshCache::GetCachePath(const std::string& source_path)
+    {
+        return std::filesystem::path(source_path).replace_extension(".dmesh").string();
+    }
+
+    bool MeshCache::Read(Model::Mesh& dmesh, const std::string& cache_path, const std::string& source_path)
+    {
+        uint64_t source_size = 0;
+        int64_t source_time = 0;
+        if (!GetSourceStamp(source_path, source_size, source_time)) { return false; }
+
+        MappedFile file(cache_path);
+        if (!file.IsOpen() || file.GetSize() < sizeof(Header)) { return false; }
+
+        Header header;
+        memcpy(&header, file.GetData(), sizeof(Header));
+
+        if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            header.version != VERSION ||
+            header.vertex_size != sizeof(Model::Vertex) ||
+            header.source_size != source_size ||
+            header.source_time != source_time)
+        {
+            return false;
+        }
+
+        const uint64_t vertex_bytes = static_cast<uint64_t>(header.vertex_count) * sizeof(Model::Vertex);
+        const uint64_t index_bytes = static_cast<uint64_t>(header.index_count) * sizeof(uint32_t);
+        // written so that a huge offset in a corrupt header cannot wrap the sum around
+        const uint64_t size = file.GetSize();
+        if (header.vertex_offset > size || vertex_bytes > size - header.vertex_offset ||
+            header.index_offset > size || index_bytes > size - header.index_offset)
+        {
+            DWARN("Mesh cache %s is truncated, rebuilding it", cache_path.c_str());
+            return false;
+        }
+
+        // the arrays are stored exactly as they are laid out in memory, so they are copied out of the
+        // mapping in one go without any per-vertex work
+        dmesh.vertices.resize(header.vertex_count);
+        dmesh.indices.resize(header.index_count);
+        memcpy(dmesh.vertices.data(), file.GetData() + header.vertex_offset, vertex_bytes);
+        memcpy(dmesh.indices.data(), file.GetData() + header.index_offset, index_bytes);
+
+        // the indices go to the device as they are, so a corrupt cache must not point past the vertices
+        for (uint32_t index : dmesh.indices)
+        {
+            if (index >= header.vertex_count)
+            {
+                DWARN("Mesh cache %s has an index out of range, rebuilding it", cache_path.c_str());
+                dmesh.vertices.clear();
+                dmesh.indices.clear();
+                return false;
+            }
+        }
+
+        dmesh.bounds.min = glm::vec3{header.bounds_min[0], header.bounds_min[1], header.bounds_min[2]};
+        dmesh.bounds.max = glm::vec3{header.bounds_max[0], header.bounds_max[1], header.bounds_max[2]};
+
+        return true;
+    }
+
+    bool MeshCache::Write(const Model::Mesh& dmesh, const std::string& cache_path, const std::string& source_path)
+    {
+        Header header{};
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.vertex_size = sizeof(Model::Vertex);
+        header.vertex_count = static_cast<uint32_t>(dmesh.vertices.size());
+        header.index_count = static_cast<uint32_t>(dmesh.indices.size());
+        if (!GetSourceStamp(source_path, header.source_size, header.source_time)) { return false; }
+        for (int i = 0; i < 3; i++)
+        {
+            header.bounds_min[i] = dmesh.bounds.min[i];
+            header.bounds_max[i] = dmesh.bounds.max[i];
+        }
+        header.vertex_offset = sizeof(Header);
+        header.index_offset = header.vertex_offset + dmesh.vertices.size() * sizeof(Model::Vertex);
+
+        // the same source may be loaded with different options on several threads at once, so every writer
+        // gets a temporary file of its own and only complete caches are renamed into place
+        static std::atomic<uint64_t> s_write_count{0};
+        const size_t thread_hash = std::hash<std::thread::id>{}(std::this_thread::get_id());
+        const std::string temp_path = cache_path + "." + std::to_string(thread_hash) + "." + std::to_string(s_write_count.fetch_add(1)) + ".tmp";
+        {
+            std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+            if (!file.is_open())
+            {
+                DWARN("Failed to open %s for writing, mesh will not be cached", temp_path.c_str());
+                return false;
+            }
+
+            file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+            file.write(reinterpret_cast<const char*>(dmesh.vertices.data()), dmesh.vertices.size() * sizeof(Model::Vertex));
+            file.write(reinterpret_cast<const char*>(dmesh.indices.data()), dmesh.indices.size() * sizeof(uint32_t));
+
+            // closing flushes the last of the data, which may fail as well
+            file.close();
+            if (file.fail())
+            {
+                DWARN("Failed to write mesh cache %s", temp_path.c_str());
+                std::remove(temp_path.c_str());
+                return false;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temp_path, cache_path, error);
+        if (error)
+        {
+            DWARN("Failed to move mesh cache into place at %s", cache_path.c_str());
+            std::remove(temp_path.c_str());
+            return false;
+        }
+
+        return true;
+    }
+} // namespace DORY
\ No newline at end of file
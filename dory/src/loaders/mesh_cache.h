@@ -0,0 +1,79 @@
+#ifndef DORY_MESH_CACHE_INCL
+#define DORY_MESH_CACHE_INCL
+
+#include "renderer/model.h"
+
+#include <cstdint>
+#include <string>
+
+namespace DORY
+{
+    /**
+     * @brief reads and writes the binary .dmesh format. a .dmesh file holds an already deduplicated
+     * Model::Mesh so that it can be loaded by memory mapping the file and copying the vertex and index
+     * arrays out in bulk, instead of re-parsing the source text file. the layout is:
+     *      Header | Model::Vertex[vertex_count] | uint32_t[index_count]
+     * the header records the size and modification time of the source file so that a stale cache is
+     * detected and rebuilt.
+     */
+    class MeshCache
+    {
+        public:
+            /**
+             * @brief bump this whenever the layout of the file or the output of the loader changes
+             */
+            static constexpr uint32_t VERSION = 2;
+
+            /**
+             * @brief header found at the start of every .dmesh file
+             */
+            struct Header
+            {
+                char magic[4];              // always "DMSH"
+                uint32_t version;           // MeshCache::VERSION at the time the file was written
+                uint32_t vertex_size;       // sizeof(Model::Vertex) at the time the file was written
+                uint32_t vertex_count;      // number of vertices following the header
+                uint32_t index_count;       // number of indices following the vertices
+                uint32_t reserved;          // padding, always zero
+                uint64_t source_size;       // size in bytes of the file the mesh was built from
+                int64_t source_time;        // modification time of the file the mesh was built from
+                float bounds_min[3];        // minimum corner of the mesh bounds
+                float bounds_max[3];        // maximum corner of the mesh bounds
+                uint64_t vertex_offset;     // byte offset of the vertex data from the start of the file
+                uint64_t index_offset;      // byte offset of the index data from the start of the file
+            }; // struct Header
+
+            /**
+             * @brief get the path of the cache file that belongs to a source model file. the cache
+             * sits next to the source with its extension replaced by .dmesh
+             * @param source_path path to the source model file
+             * @return std::string
+             */
+            static std::string GetCachePath(const std::string& source_path);
+
+            /**
+             * @brief load a mesh from a cache file. fails if the file does not exist, was written by a
+             * different version, or is older than the source file it was built from
+             * @param dmesh the mesh to fill
+             * @param cache_path path to the .dmesh file
+             * @param source_path path to the source model file the cache was built from
+             * @return true if the mesh was loaded from the cache
+             * @return false if the cache is missing or stale
+             */
+            static bool Read(Model::Mesh& dmesh, const std::string& cache_path, const std::string& source_path);
+
+            /**
+             * @brief write a mesh to a cache file. the file is written under a temporary name and then
+             * renamed, so a reader never sees a partially written cache. failing to write the cache
+             * (e.g. read-only asset directory) only logs a warning
+             * @param dmesh the mesh to store
+             * @param cache_path path to the .dmesh file
+             * @param source_path path to the source model file the mesh was built from
+             * @return true if the cache was written
+             * @return false
+             */
+            static bool Write(const Model::Mesh& dmesh, const std::string& cache_path, const std::string& source_path);
+    }; // class MeshCache
+} // namespace DORY
+
+#endif // DORY_MESH_CACHE_INCL
\ No newline at end of file
@@ -0,0 +1,678 @@
+#include "loaders/obj_parser.h"
+#include "core/job_system.h"
+#include "utils/mapped_file.h"
+#include "utils/nocopy.h"
+#include "utils/parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace DORY
+{
+    // files are only split when every thread gets at least this many bytes, smaller files are parsed on
+    // the calling thread
+    static constexpr size_t MIN_CHUNK_SIZE = 1 << 20;
+
+    /**
+     * @brief the records of one chunk of the file
+     */
+    struct ObjChunk
+    {
+        const char* begin = nullptr; // first byte of the chunk, always the start of a line
+        const char* end = nullptr; // one past the last byte of the chunk
+
+        std::vector<float> positions{};
+        std::vector<float> colors{};
+        std::vector<float> normals{};
+        std::vector<float> texcoords{};
+
+        std::vector<tinyobj::index_t> corners{}; // corners of every face, in file order
+        std::vector<uint8_t> face_sizes{}; // number of corners of each face, either 3 or 4
+        std::vector<size_t> relative_indices{}; // 3 * corner + component of indices counted from the start of the chunk
+        std::vector<tinyobj::index_t> triangles{}; // the faces of the chunk split into triangles
+
+        const char* error = nullptr; // position of the first invalid face, if any
+        bool has_polygons = false; // whether a face with more than four vertices was found
+    };
+
+    static inline bool IsSpace(char c) { return c == ' ' || c == '\t'; }
+    static inline bool IsDigit(char c) { return static_cast<unsigned int>(c - '0') < 10u; }
+
+    static inline const char* SkipSpaces(const char* cursor, const char* line_end)
+    {
+        while (cursor != line_end && IsSpace(*cursor)) { cursor++; }
+        return cursor;
+    }
+
+    /**
+     * @brief parse a floating point number in [s, s_end). this performs exactly the same arithmetic as
+     * tinyobj's tryParseDouble() so that both parsers give bit-identical results, but it reads straight
+     * from the mapped file instead of a copy of the line
+     */
+    static bool ParseDouble(const char* s, const char* s_end, double* result)
+    {
+        if (s >= s_end) { return false; }
+
+        static const double pow_lut[] = { 1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001 };
+        const int lut_entries = sizeof(pow_lut) / sizeof(pow_lut[0]);
+
+        double mantissa = 0.0;
+        int exponent = 0; // base 10 exponent, converted with ldexp() on assembly
+        char sign = '+';
+        const char* curr = s;
+        int read = 0;
+        bool leading_decimal_dot = false;
+
+        if (*curr == '+' || *curr == '-')
+        {
+            sign = *curr;
+            curr++;
+            leading_decimal_dot = curr != s_end && *curr == '.';
+        }
+        else if (*curr == '.') { leading_decimal_dot = true; }
+        else if (!IsDigit(*curr)) { return false; }
+
+        // integer part
+        if (!leading_decimal_dot)
+        {
+            while (curr != s_end && IsDigit(*curr))
+            {
+                mantissa *= 10;
+                mantissa += static_cast<int>(*curr - '0');
+                curr++;
+                read++;
+            }
+            if (read == 0) { return false; }
+        }
+
+        // decimal part
+        if (curr != s_end && *curr == '.')
+        {
+            curr++;
+            read = 1;
+            while (curr != s_end && IsDigit(*curr))
+            {
+                mantissa += static_cast<int>(*curr - '0') * (read < lut_entries ? pow_lut[read] : std::pow(10.0, -read));
+                read++;
+                curr++;
+            }
+        }
+
+        // exponent part
+        if (curr != s_end && (*curr == 'e' || *curr == 'E'))
+        {
+            curr++;
+            char exp_sign = '+';
+            if (curr != s_end && (*curr == '+' || *curr == '-'))
+            {
+                exp_sign = *curr;
+                curr++;
+            }
+            else if (curr == s_end || !IsDigit(*curr)) { return false; }
+
+            read = 0;
+            while (curr != s_end && IsDigit(*curr))
+            {
+                if (exponent > 2147483647 / 10) { return false; } // overflow
+                exponent *= 10;
+                exponent += static_cast<int>(*curr - '0');
+                curr++;
+                read++;
+            }
+            exponent *= (exp_sign == '+' ? 1 : -1);
+            if (read == 0) { return false; }
+        }
+
+        *result = (sign == '+' ? 1 : -1) * (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent) : mantissa);
+        return true;
+    }
+
+    /**
+     * @brief parse the next whitespace separated real on the line and move the cursor past it
+     * @return true if the field held a number, in which case value is set
+     */
+    static inline bool ParseReal(const char*& cursor, const char* line_end, float& value)
+    {
+        cursor = SkipSpaces(cursor, line_end);
+        const char* field_end = cursor;
+        while (field_end != line_end && !IsSpace(*field_end)) { field_end++; }
+
+        double result;
+        const bool parsed = ParseDouble(cursor, field_end, &result);
+        if (parsed) { value = static_cast<float>(result); }
+        cursor = field_end;
+        return parsed;
+    }
+
+    /**
+     * @brief parse an integer the way atoi() does, stopping at the end of the line
+     */
+    static inline int ParseInt(const char* cursor, const char* line_end)
+    {
+        while (cursor != line_end && (*cursor == ' ' || (*cursor >= '\t' && *cursor <= '\r'))) { cursor++; }
+
+        bool negative = false;
+        if (cursor != line_end && (*cursor == '+' || *cursor == '-'))
+        {
+            negative = *cursor == '-';
+            cursor++;
+        }
+
+        int value = 0;
+        while (cursor != line_end && IsDigit(*cursor))
+        {
+            value = value * 10 + (*cursor - '0');
+            cursor++;
+        }
+        return negative ? -value : value;
+    }
+
+    static inline const char* SkipIndex(const char* cursor, const char* line_end)
+    {
+        while (cursor != line_end && *cursor != '/' && !IsSpace(*cursor)) { cursor++; }
+        return cursor;
+    }
+
+    /**
+     * @brief parse one component of a face corner and make it zero based. negative indices count back
+     * from the attributes read so far; since only the attributes of this chunk are known at this point
+     * the index is stored relative to the start of the chunk and fixed up once all chunks are parsed
+     * @return false if the index is zero, which the spec does not allow
+     */
+    static inline bool ParseIndex(const char* cursor, const char* line_end, size_t count, size_t component, ObjChunk& chunk, int& index)
+    {
+        const int value = ParseInt(cursor, line_end);
+        if (value > 0)
+        {
+            index = value - 1;
+            return true;
+        }
+        if (value == 0) { return false; }
+
+        index = static_cast<int>(count) + value;
+        chunk.relative_indices.push_back(3 * chunk.corners.size() + component);
+        return true;
+    }
+
+    /**
+     * @brief parse a face corner of the form i, i/j, i//k or i/j/k
+     */
+    static bool ParseCorner(const char*& cursor, const char* line_end, ObjChunk& chunk)
+    {
+        tinyobj::index_t corner;
+        corner.vertex_index = -1;
+        corner.normal_index = -1;
+        corner.texcoord_index = -1;
+
+        const size_t position_count = chunk.positions.size() / 3;
+        const size_t normal_count = chunk.normals.size() / 3;
+        const size_t texcoord_count = chunk.texcoords.size() / 2;
+
+        if (!ParseIndex(cursor, line_end, position_count, 0, chunk, corner.vertex_index)) { return false; }
+        cursor = SkipIndex(cursor, line_end);
+
+        if (cursor != line_end && *cursor == '/')
+        {
+            cursor++;
+            if (cursor != line_end && *cursor == '/')
+            {
+                // i//k
+                cursor++;
+                if (!ParseIndex(cursor, line_end, normal_count, 2, chunk, corner.normal_index)) { return false; }
+                cursor = SkipIndex(cursor, line_end);
+            }
+            else
+            {
+                // i/j or i/j/k
+                if (!ParseIndex(cursor, line_end, texcoord_count, 1, chunk, corner.texcoord_index)) { return false; }
+                cursor = SkipIndex(cursor, line_end);
+                if (cursor != line_end && *cursor == '/')
+                {
+                    cursor++;
+                    if (!ParseIndex(cursor, line_end, normal_count, 2, chunk, corner.normal_index)) { return false; }
+                    cursor = SkipIndex(cursor, line_end);
+                }
+            }
+        }
+
+        chunk.corners.push_back(corner);
+        return true;
+    }
+
+    /**
+     * @brief parse a single line in [cursor, line_end)
+     * @return false if parsing of the chunk has to stop
+     */
+    static bool ParseLine(const char* cursor, const char* line_end, ObjChunk& chunk)
+    {
+        cursor = SkipSpaces(cursor, line_end);
+        const size_t length = static_cast<size_t>(line_end - cursor);
+        if (length < 2 || cursor[0] == '#') { return true; }
+
+        if (cursor[0] == 'v' && IsSpace(cursor[1]))
+        {
+            cursor += 2;
+            float x = 0.0f, y = 0.0f, z = 0.0f;
+            ParseReal(cursor, line_end, x);
+            ParseReal(cursor, line_end, y);
+            ParseReal(cursor, line_end, z);
+            chunk.positions.insert(chunk.positions.end(), { x, y, z });
+
+            // vertices without a color get white, like tinyobj's default_vcols_fallback
+            float r, g, b;
+            if (!(ParseReal(cursor, line_end, r) && ParseReal(cursor, line_end, g) && ParseReal(cursor, line_end, b)))
+            {
+                r = g = b = 1.0f;
+            }
+            chunk.colors.insert(chunk.colors.end(), { r, g, b });
+        }
+        else if (cursor[0] == 'v' && cursor[1] == 'n' && length > 2 && IsSpace(cursor[2]))
+        {
+            cursor += 3;
+            float x = 0.0f, y = 0.0f, z = 0.0f;
+            ParseReal(cursor, line_end, x);
+            ParseReal(cursor, line_end, y);
+            ParseReal(cursor, line_end, z);
+            chunk.normals.insert(chunk.normals.end(), { x, y, z });
+        }
+        else if (cursor[0] == 'v' && cursor[1] == 't' && length > 2 && IsSpace(cursor[2]))
+        {
+            cursor += 3;
+            float u = 0.0f, v = 0.0f;
+            ParseReal(cursor, line_end, u);
+            ParseReal(cursor, line_end, v);
+            chunk.texcoords.insert(chunk.texcoords.end(), { u, v });
+        }
+        else if (cursor[0] == 'f' && IsSpace(cursor[1]))
+        {
+            const char* face_begin = cursor;
+            const size_t first_corner = chunk.corners.size();
+            const size_t first_relative = chunk.relative_indices.size();
+
+            cursor = SkipSpaces(cursor + 2, line_end);
+            while (cursor != line_end)
+            {
+                if (!ParseCorner(cursor, line_end, chunk))
+                {
+                    chunk.error = face_begin;
+                    return false;
+                }
+                cursor = SkipSpaces(cursor, line_end);
+            }
+
+            const size_t corner_count = chunk.corners.size() - first_corner;
+            if (corner_count > 4)
+            {
+                chunk.has_polygons = true;
+                return false;
+            }
+            if (corner_count < 3)
+            {
+                // degenerate faces are dropped, like tinyobj does
+                chunk.corners.resize(first_corner);
+                chunk.relative_indices.resize(first_relative);
+                return true;
+            }
+            chunk.face_sizes.push_back(static_cast<uint8_t>(corner_count));
+        }
+
+        // everything else (groups, materials, lines, points, ...) does not contribute to the mesh
+        return true;
+    }
+
+    static void ParseChunk(ObjChunk& chunk)
+    {
+        const char* cursor = chunk.begin;
+        while (cursor != chunk.end)
+        {
+            // a line ends at \n or \r, so \r\n simply adds an empty line
+            const char* line_end = cursor;
+            while (line_end != chunk.end && *line_end != '\n' && *line_end != '\r') { line_end++; }
+
+            if (!ParseLine(cursor, line_end, chunk)) { return; }
+
+            cursor = line_end == chunk.end ? line_end : line_end + 1;
+        }
+    }
+
+    /**
+     * @brief split the faces of a chunk into triangles. quads are split along their shorter diagonal,
+     * and quads referencing missing vertices are dropped, both exactly like tinyobj does
+     */
+    static void TriangulateChunk(ObjChunk& chunk, const std::vector<float>& v)
+    {
+        chunk.triangles.clear();
+        chunk.triangles.reserve(chunk.corners.size() + chunk.corners.size() / 2);
+
+        const tinyobj::index_t* face = chunk.corners.data();
+        for (uint8_t face_size : chunk.face_sizes)
+        {
+            const tinyobj::index_t* corners = face;
+            face += face_size;
+
+            if (face_size == 3)
+            {
+                chunk.triangles.insert(chunk.triangles.end(), corners, corners + 3);
+                continue;
+            }
+
+            size_t vi0 = size_t(corners[0].vertex_index);
+            size_t vi1 = size_t(corners[1].vertex_index);
+            size_t vi2 = size_t(corners[2].vertex_index);
+            size_t vi3 = size_t(corners[3].vertex_index);
+            if (((3 * vi0 + 2) >= v.size()) || ((3 * vi1 + 2) >= v.size()) ||
+                ((3 * vi2 + 2) >= v.size()) || ((3 * vi3 + 2) >= v.size()))
+            {
+                continue;
+            }
+
+            float e02x = v[vi2 * 3 + 0] - v[vi0 * 3 + 0];
+            float e02y = v[vi2 * 3 + 1] - v[vi0 * 3 + 1];
+            float e02z = v[vi2 * 3 + 2] - v[vi0 * 3 + 2];
+            float e13x = v[vi3 * 3 + 0] - v[vi1 * 3 + 0];
+            float e13y = v[vi3 * 3 + 1] - v[vi1 * 3 + 1];
+            float e13z = v[vi3 * 3 + 2] - v[vi1 * 3 + 2];
+
+            float sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+            float sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+
+            if (sqr02 < sqr13)
+            {
+                // [0, 1, 2], [0, 2, 3]
+                chunk.triangles.insert(chunk.triangles.end(), { corners[0], corners[1], corners[2], corners[0], corners[2], corners[3] });
+            }
+            else
+            {
+                // [0, 1, 3], [1, 2, 3]
+                chunk.triangles.insert(chunk.triangles.end(), { corners[0], corners[1], corners[3], corners[1], corners[2], corners[3] });
+            }
+        }
+    }
+
+    /**
+     * @brief split [data, data_end) into roughly equal chunks, one per thread but none smaller than
+     * MIN_CHUNK_SIZE, moving each split forward to the next line start
+     */
+    static std::vector<ObjChunk> SplitChunks(const char* data, const char* data_end, uint32_t thread_count)
+    {
+        const size_t size = static_cast<size_t>(data_end - data);
+        const size_t chunk_count = std::max<size_t>(1, std::min<size_t>(Utils::GetThreadCount(thread_count), size / MIN_CHUNK_SIZE));
+
+        std::vector<ObjChunk> chunks(chunk_count);
+        const char* chunk_begin = data;
+        for (size_t i = 0; i < chunk_count; i++)
+        {
+            const char* chunk_end = data_end;
+            if (i + 1 < chunk_count)
+            {
+                chunk_end = std::max(chunk_begin, data + size * (i + 1) / chunk_count);
+                while (chunk_end != data_end && *chunk_end != '\n' && *chunk_end != '\r') { chunk_end++; }
+                if (chunk_end != data_end) { chunk_end++; }
+            }
+            chunks[i].begin = chunk_begin;
+            chunks[i].end = chunk_end;
+            chunk_begin = chunk_end;
+        }
+        return chunks;
+    }
+
+    /**
+     * @brief reads a file through a buffer of fixed size. every window it hands out ends at a line break
+     * (or the end of the file); the partial line after the last break is moved to the front of the
+     * buffer and completed by the next read
+     */
+    class WindowReader : public NoCopy
+    {
+        public:
+            WindowReader(const std::string& path, size_t window_size)
+                : m_file(fopen(path.c_str(), "rb")), m_buffer(std::max<size_t>(window_size, 1)) {}
+
+            ~WindowReader()
+            {
+                if (m_file != nullptr) { fclose(m_file); }
+            }
+
+            bool IsOpen() const { return m_file != nullptr; }
+
+            /**
+             * @brief read the next window
+             * @return false once the whole file has been read
+             */
+            bool Next(const char*& begin, const char*& end)
+            {
+                std::memmove(m_buffer.data(), m_buffer.data() + m_consumed, m_filled - m_consumed);
+                m_filled -= m_consumed;
+                m_consumed = 0;
+
+                while (true)
+                {
+                    // a single line longer than the window makes the window grow
+                    if (m_filled == m_buffer.size()) { m_buffer.resize(m_buffer.size() * 2); }
+                    if (!m_eof)
+                    {
+                        const size_t requested = m_buffer.size() - m_filled;
+                        const size_t read = fread(m_buffer.data() + m_filled, 1, requested, m_file);
+                        m_filled += read;
+                        m_eof = read < requested;
+                    }
+
+                    size_t split = m_filled;
+                    if (!m_eof)
+                    {
+                        while (split > 0 && m_buffer[split - 1] != '\n' && m_buffer[split - 1] != '\r') { split--; }
+                        if (split == 0) { continue; }
+                    }
+                    if (split == 0) { return false; }
+
+                    begin = m_buffer.data();
+                    end = begin + split;
+                    m_consumed = split;
+                    return true;
+                }
+            }
+
+        private: // members
+            FILE* m_file = nullptr; // the file being read
+            std::vector<char> m_buffer{}; // the current window followed by the start of the next one
+            size_t m_filled = 0; // number of bytes of the buffer that hold data
+            size_t m_consumed = 0; // number of bytes handed out by the last call to Next()
+            bool m_eof = false; // whether the end of the file has been reached
+    }; // class WindowReader
+
+    bool ObjParser::Parse(const std::string& path, tinyobj::attrib_t& attrib, std::vector<tinyobj::index_t>& indices, uint32_t thread_count)
+    {
+        MappedFile file(path);
+        if (!file.IsOpen()) { return false; }
+
+        const char* data = file.GetData();
+        std::vector<ObjChunk> chunks = SplitChunks(data, data + file.GetSize(), thread_count);
+        const size_t chunk_count = chunks.size();
+
+        JobSystem::Get().RunParallel(chunk_count, [&](size_t i) { ParseChunk(chunks[i]); });
+
+        for (const auto& chunk : chunks)
+        {
+            if (chunk.error != nullptr)
+            {
+                const size_t line = static_cast<size_t>(std::count(data, chunk.error, '\n')) + 1;
+                throw std::runtime_error("Failed to parse face (e.g. zero value for face index) in " + path + " at line " + std::to_string(line));
+            }
+        }
+        for (const auto& chunk : chunks)
+        {
+            if (chunk.has_polygons) { return false; }
+        }
+
+        // each chunk starts where the attributes of the previous chunks end
+        std::vector<size_t> position_base(chunk_count), normal_base(chunk_count), texcoord_base(chunk_count);
+        size_t position_count = 0, normal_count = 0, texcoord_count = 0;
+        for (size_t i = 0; i < chunk_count; i++)
+        {
+            position_base[i] = position_count;
+            normal_base[i] = normal_count;
+            texcoord_base[i] = texcoord_count;
+            position_count += chunks[i].positions.size() / 3;
+            normal_count += chunks[i].normals.size() / 3;
+            texcoord_count += chunks[i].texcoords.size() / 2;
+        }
+
+        attrib = tinyobj::attrib_t{};
+        attrib.vertices.resize(3 * position_count);
+        attrib.colors.resize(3 * position_count);
+        attrib.normals.resize(3 * normal_count);
+        attrib.texcoords.resize(2 * texcoord_count);
+
+        JobSystem::Get().RunParallel(chunk_count, [&](size_t i)
+        {
+            ObjChunk& chunk = chunks[i];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), attrib.vertices.begin() + 3 * position_base[i]);
+            std::copy(chunk.colors.begin(), chunk.colors.end(), attrib.colors.begin() + 3 * position_base[i]);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), attrib.normals.begin() + 3 * normal_base[i]);
+            std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), attrib.texcoords.begin() + 2 * texcoord_base[i]);
+
+            for (size_t relative : chunk.relative_indices)
+            {
+                tinyobj::index_t& corner = chunk.corners[relative / 3];
+                switch (relative % 3)
+                {
+                    case 0: corner.vertex_index += static_cast<int>(position_base[i]); break;
+                    case 1: corner.texcoord_index += static_cast<int>(texcoord_base[i]); break;
+                    case 2: corner.normal_index += static_cast<int>(normal_base[i]); break;
+                }
+            }
+        });
+
+        // tinyobj splits quads when a group ends rather than at the end of the file, so the two only differ
+        // for a quad referencing vertices that are defined after the group it belongs to
+        JobSystem::Get().RunParallel(chunk_count, [&](size_t i) { TriangulateChunk(chunks[i], attrib.vertices); });
+
+        std::vector<size_t> triangle_base(chunk_count);
+        size_t corner_count = 0;
+        for (size_t i = 0; i < chunk_count; i++)
+        {
+            triangle_base[i] = corner_count;
+            corner_count += chunks[i].triangles.size();
+        }
+
+        indices.resize(corner_count);
+        JobSystem::Get().RunParallel(chunk_count, [&](size_t i)
+        {
+            std::copy(chunks[i].triangles.begin(), chunks[i].triangles.end(), indices.begin() + triangle_base[i]);
+        });
+
+        return true;
+    }
+
+    bool ObjParser::Count(const std::string& path, Counts& counts, size_t window_size)
+    {
+        WindowReader reader(path, window_size);
+        if (!reader.IsOpen()) { return false; }
+
+        counts = Counts{};
+        const char* begin;
+        const char* end;
+        while (reader.Next(begin, end))
+        {
+            const char* cursor = begin;
+            while (cursor != end)
+            {
+                const char* line_end = cursor;
+                while (line_end != end && *line_end != '\n' && *line_end != '\r') { line_end++; }
+
+                // only the record type and the number of fields matter here
+                const char* line = SkipSpaces(cursor, line_end);
+                const size_t length = static_cast<size_t>(line_end - line);
+                size_t fields = 0;
+                if (length >= 2 && (line[0] == 'v' || line[0] == 'f'))
+                {
+                    for (const char* c = line; c != line_end; )
+                    {
+                        c = SkipSpaces(c, line_end);
+                        if (c == line_end) { break; }
+                        fields++;
+                        while (c != line_end && !IsSpace(*c)) { c++; }
+                    }
+                }
+
+                if (length >= 2 && line[0] == 'v' && IsSpace(line[1]))
+                {
+                    counts.position_count++;
+                    counts.has_colors |= fields >= 7;
+                }
+                else if (length > 2 && line[0] == 'v' && line[1] == 'n' && IsSpace(line[2])) { counts.normal_count++; }
+                else if (length > 2 && line[0] == 'v' && line[1] == 't' && IsSpace(line[2])) { counts.texcoord_count++; }
+                else if (length >= 2 && line[0] == 'f' && IsSpace(line[1]))
+                {
+                    const size_t corner_count = fields - 1;
+                    if (corner_count > 4) { counts.has_polygons = true; }
+                    else if (corner_count >= 3) { counts.triangle_count += corner_count - 2; }
+                }
+
+                cursor = line_end == end ? line_end : line_end + 1;
+            }
+        }
+        return true;
+    }
+
+    bool ObjParser::ParseStreaming( const std::string& path,
+                                    tinyobj::attrib_t& attrib,
+                                    bool keep_colors,
+                                    const TriangleCallback& emit,
+                                    size_t window_size,
+                                    uint32_t thread_count)
+    {
+        WindowReader reader(path, window_size);
+        if (!reader.IsOpen()) { return false; }
+
+        size_t line_base = 0; // number of lines before the current window, for error messages
+        const char* begin;
+        const char* end;
+        while (reader.Next(begin, end))
+        {
+            std::vector<ObjChunk> chunks = SplitChunks(begin, end, thread_count);
+            JobSystem::Get().RunParallel(chunks.size(), [&](size_t i) { ParseChunk(chunks[i]); });
+
+            for (const auto& chunk : chunks)
+            {
+                if (chunk.error != nullptr)
+                {
+                    const size_t line = line_base + static_cast<size_t>(std::count(begin, chunk.error, '\n')) + 1;
+                    throw std::runtime_error("Failed to parse face (e.g. zero value for face index) in " + path + " at line " + std::to_string(line));
+                }
+                if (chunk.has_polygons) { return false; }
+            }
+
+            // the chunks are stitched one after another, each starting where the attributes read so far end
+            for (auto& chunk : chunks)
+            {
+                const size_t position_base = attrib.vertices.size() / 3;
+                const size_t normal_base = attrib.normals.size() / 3;
+                const size_t texcoord_base = attrib.texcoords.size() / 2;
+                attrib.vertices.insert(attrib.vertices.end(), chunk.positions.begin(), chunk.positions.end());
+                if (keep_colors) { attrib.colors.insert(attrib.colors.end(), chunk.colors.begin(), chunk.colors.end()); }
+                attrib.normals.insert(attrib.normals.end(), chunk.normals.begin(), chunk.normals.end());
+                attrib.texcoords.insert(attrib.texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+
+                for (size_t relative : chunk.relative_indices)
+                {
+                    tinyobj::index_t& corner = chunk.corners[relative / 3];
+                    switch (relative % 3)
+                    {
+                        case 0: corner.vertex_index += static_cast<int>(position_base); break;
+                        case 1: corner.texcoord_index += static_cast<int>(texcoord_base); break;
+                        case 2: corner.normal_index += static_cast<int>(normal_base); break;
+                    }
+                }
+
+                TriangulateChunk(chunk, attrib.vertices);
+                emit(chunk.triangles);
+            }
+
+            line_base += static_cast<size_t>(std::count(begin, end, '\n'));
+        }
+        return true;
+    }
+} // namespace DORY
\ No newline at end of file
@@ -0,0 +1,109 @@
+#ifndef DORY_OBJ_PARSER_INCL
+#define DORY_OBJ_PARSER_INCL
+
+#include <tiny_obj_loader.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace DORY
+{
+    /**
+     * @brief multi-threaded parser for .obj files. the file is memory mapped and split into chunks at
+     * line boundaries, and the v/vn/vt/f records of each chunk are parsed on their own thread directly
+     * out of the mapping. the chunks are then stitched together in file order, with relative (negative)
+     * face indices resolved against the running attribute counts of the preceding chunks.
+     *
+     * the output is the same attribute arrays and triangulated face corners that tinyobj::LoadObj()
+     * produces for the file: numbers are parsed with the same arithmetic, quads are split along the
+     * same diagonal and faces keep their order. files that need tinyobj's ear clipping (faces with more
+     * than four vertices) are not handled, so that the caller can fall back to tinyobj.
+     *
+     * files too large to hold in memory together with their parsed records can be streamed instead: the
+     * file is read through a window of fixed size, and each window is parsed, stitched and handed on
+     * before the next one is read.
+     */
+    class ObjParser
+    {
+        public:
+            /**
+             * @brief default number of bytes read from the file at a time by the streaming functions
+             */
+            static constexpr size_t DEFAULT_WINDOW_SIZE = 16 << 20;
+
+            /**
+             * @brief number of records in an .obj file, see Count()
+             */
+            struct Counts
+            {
+                size_t position_count = 0; // number of v records
+                size_t normal_count = 0; // number of vn records
+                size_t texcoord_count = 0; // number of vt records
+                size_t triangle_count = 0; // number of triangles the faces split into, at most
+                bool has_colors = false; // whether any v record has a color
+                bool has_polygons = false; // whether any face has more than four vertices
+            };
+
+            /**
+             * @brief receives the triangles of one window of the file, see ParseStreaming()
+             */
+            using TriangleCallback = std::function<void(const std::vector<tinyobj::index_t>& triangles)>;
+
+            /**
+             * @brief parse an .obj file
+             * @param path path to the .obj file
+             * @param attrib filled with the positions, vertex colors, normals and texture coordinates
+             * @param indices filled with three corners per triangle, in file order
+             * @param thread_count number of threads to parse with. 0 uses one per hardware thread
+             * @return true if the file was parsed
+             * @return false if the file could not be mapped or contains faces with more than four
+             * vertices. the outputs are left in an unspecified state
+             * @throws std::runtime_error if the file contains an invalid face index
+             */
+            static bool Parse(  const std::string& path,
+                                tinyobj::attrib_t& attrib,
+                                std::vector<tinyobj::index_t>& indices,
+                                uint32_t thread_count = 0);
+
+            /**
+             * @brief count the records of an .obj file without storing any of them, reading the file one
+             * window at a time. this is used to size the buffers before ParseStreaming()
+             * @param path path to the .obj file
+             * @param counts filled with the number of records
+             * @param window_size (optional) number of bytes to read at a time
+             * @return true if the file was read
+             * @return false if the file could not be opened
+             */
+            static bool Count(const std::string& path, Counts& counts, size_t window_size = DEFAULT_WINDOW_SIZE);
+
+            /**
+             * @brief parse an .obj file one window at a time, so that only the attribute arrays and a single
+             * window of records are in memory at once. each window is parsed like a file in Parse(), and its
+             * triangles are handed to a callback as soon as the attributes they reference are known. the
+             * output is the same as that of Parse(), delivered in pieces
+             * @param path path to the .obj file
+             * @param attrib the attributes are appended to this as they are read. reserve it with the
+             * results of Count() to avoid reallocating
+             * @param keep_colors whether to store the vertex colors. without them every vertex is white
+             * @param emit called with the triangles of every window, in file order. their indices only
+             * reference attributes that have already been appended
+             * @param window_size (optional) number of bytes to read at a time. a window grows if a single
+             * line does not fit
+             * @param thread_count (optional) number of threads to parse each window with. 0 uses one per
+             * hardware thread
+             * @return true if the file was parsed
+             * @return false if the file could not be opened or contains faces with more than four vertices
+             * @throws std::runtime_error if the file contains an invalid face index
+             */
+            static bool ParseStreaming( const std::string& path,
+                                        tinyobj::attrib_t& attrib,
+                                        bool keep_colors,
+                                        const TriangleCallback& emit,
+                                        size_t window_size = DEFAULT_WINDOW_SIZE,
+                                        uint32_t thread_count = 0);
+    }; // class ObjParser
+} // namespace DORY
+
+#endif // DORY_OBJ_PARSER_INCL
@@ -1,96 +1,243 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "object_loader.h"
-#include "math/hash.h"
+#include "core/logger.h"
+#include "loaders/mesh_cache.h"
+#include "loaders/vertex_welder.h"
 
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
+#include <algorithm>
+#include <stdexcept>
 
-#include <unordered_map>
-
-namespace std
+namespace DORY
 {
-    template<>
-    struct hash<DORY::Model::Vertex>
+    void ObjectLoader::Load(Model::Mesh& dmesh, const std::string& path, bool use_cache, size_t memory_limit)
     {
-        size_t operator()(const DORY::Model::Vertex& vertex) const
+        auto load_obj = [&]()
         {
-            size_t seed = 0;
-            DORY::HashCombine(seed, vertex.a_position, vertex.a_color, vertex.a_normal, vertex.a_tex_coords);
-            return seed;
+            if (memory_limit != 0) { LoadObjStreaming(dmesh, path, memory_limit); }
+            else { LoadObj(dmesh, path); }
+        };
+
+        if (!use_cache)
+        {
+            load_obj();
+            return;
         }
-    };
-}
 
-namespace DORY
-{
-    void ObjectLoader::Load(Model::Mesh& dmesh, const std::string& path)
+        // the cache is built from the output of LoadObj(), so a fresh cache gives back exactly the same mesh
+        const std::string cache_path = MeshCache::GetCachePath(path);
+        if (MeshCache::Read(dmesh, cache_path, path))
+        {
+            DDEBUG("Loaded cached mesh: %s", cache_path.c_str());
+            return;
+        }
+
+        load_obj();
+        MeshCache::Write(dmesh, cache_path, path);
+    }
+
+    void ObjectLoader::LoadObj(Model::Mesh& dmesh, const std::string& path, bool parallel)
     {
         tinyobj::attrib_t attrib;
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string warn;
-        std::string err;
+        std::vector<tinyobj::index_t> indices;
 
-        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str()))
+        // the parallel parser hands files it cannot reproduce exactly (faces with more than four
+        // vertices) back to tinyobj
+        if (!parallel || !ObjParser::Parse(path, attrib, indices))
         {
-            throw std::runtime_error(warn + err);
+            std::vector<tinyobj::shape_t> shapes;
+            std::vector<tinyobj::material_t> materials;
+            std::string warn;
+            std::string err;
+
+            if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str()))
+            {
+                throw std::runtime_error(warn + err);
+            }
+
+            indices.clear();
+            for (const auto& shape : shapes)
+            {
+                indices.insert(indices.end(), shape.mesh.indices.begin(), shape.mesh.indices.end());
+            }
+        }
+
+        BuildMesh(dmesh, attrib, indices, parallel);
+    }
+
+    /**
+     * @brief build the vertex of a face corner. the indices must have been checked against the sizes of the
+     * attribute arrays
+     */
+    static Model::Vertex MakeVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& index)
+    {
+        Model::Vertex vertex{};
+        // specify the position of the vertex (and color if provided)
+        if (index.vertex_index >= 0)
+        {
+            vertex.a_position = {
+                attrib.vertices[3 * index.vertex_index + 0], // x
+                attrib.vertices[3 * index.vertex_index + 1], // y
+                attrib.vertices[3 * index.vertex_index + 2]  // z
+            };
+
+            if (!attrib.colors.empty())
+            {
+                vertex.a_color = {
+                    attrib.colors[3 * index.vertex_index + 0], // r
+                    attrib.colors[3 * index.vertex_index + 1], // g
+                    attrib.colors[3 * index.vertex_index + 2]  // b
+                };
+            }
+        }
+
+        // specify the normal of the vertex
+        if (index.normal_index >= 0)
+        {
+            vertex.a_normal = {
+                attrib.normals[3 * index.normal_index + 0],
+                attrib.normals[3 * index.normal_index + 1], 
+                attrib.normals[3 * index.normal_index + 2] 
+            };
+        }
+
+        // specify the texture coordinates of the vertex
+        if (index.texcoord_index >= 0)
+        {
+            vertex.a_tex_coords = {
+                attrib.texcoords[2 * index.texcoord_index + 0],
+                attrib.texcoords[2 * index.texcoord_index + 1]
+            };
+        }
+
+        return vertex;
+    }
+
+    void ObjectLoader::BuildMesh(Model::Mesh& dmesh, const tinyobj::attrib_t& attrib, const std::vector<tinyobj::index_t>& indices, bool parallel)
+    {
+        const int position_count = static_cast<int>(attrib.vertices.size() / 3);
+        const int normal_count = static_cast<int>(attrib.normals.size() / 3);
+        const int texcoord_count = static_cast<int>(attrib.texcoords.size() / 2);
+        for (const auto& index : indices)
+        {
+            if (index.vertex_index >= position_count || index.normal_index >= normal_count || index.texcoord_index >= texcoord_count)
+            {
+                throw std::runtime_error("Face index out of range");
+            }
         }
 
         dmesh.indices.clear();
         dmesh.vertices.clear();
 
-        // https://vulkan-tutorial.com/Loading_models
-        std::unordered_map<Model::Vertex, uint32_t> unique_vertices{};
-        for (const auto& shape : shapes)
+        if (parallel && indices.size() >= MIN_PARALLEL_WELD_CORNERS)
+        {
+            VertexWelder::WeldParallel(indices.size(), [&](size_t i) { return MakeVertex(attrib, indices[i]); }, dmesh);
+        }
+        else
+        {
+            // a closed triangle mesh has about one vertex per six corners
+            VertexWelder welder(indices.size() / 6);
+            dmesh.indices.reserve(indices.size());
+            for (const auto& index : indices)
+            {
+                dmesh.indices.push_back(welder.Weld(MakeVertex(attrib, index), dmesh.vertices));
+            }
+        }
+
+        dmesh.ComputeBounds();
+    }
+
+    void ObjectLoader::LoadObjStreaming(Model::Mesh& dmesh, const std::string& path, size_t memory_limit, size_t window_size)
+    {
+        ObjParser::Counts counts{};
+        if (!ObjParser::Count(path, counts, window_size)) { throw std::runtime_error("Failed to open model file: " + path); }
+        if (counts.has_polygons) { throw std::runtime_error("Faces with more than four vertices cannot be streamed: " + path); }
+
+        // every buffer is accounted for before it is allocated. a window of text holds at most about twice
+        // its size in parsed records
+        size_t used = 0;
+        size_t peak = 0;
+        auto allocate = [&](size_t bytes, const char* what)
+        {
+            used += bytes;
+            peak = std::max(peak, used);
+            if (memory_limit != 0 && used > memory_limit)
+            {
+                throw std::runtime_error("Loading " + path + " needs more than " + std::to_string(memory_limit) + " bytes (" + what + ")");
+            }
+        };
+        allocate(3 * window_size, "read window");
+        allocate(sizeof(float) * (3 * counts.position_count + (counts.has_colors ? 3 * counts.position_count : 0) + 3 * counts.normal_count + 2 * counts.texcoord_count), "attributes");
+        allocate(sizeof(uint32_t) * 3 * counts.triangle_count, "indices");
+
+        // most scans have about as many distinct vertices as positions
+        const size_t expected_vertices = std::max<size_t>(counts.position_count, 3);
+        allocate(sizeof(Model::Vertex) * expected_vertices, "vertices");
+        VertexWelder welder(expected_vertices);
+        allocate(welder.GetMemoryUsage(), "weld table");
+
+        tinyobj::attrib_t attrib;
+        attrib.vertices.reserve(3 * counts.position_count);
+        if (counts.has_colors) { attrib.colors.reserve(3 * counts.position_count); }
+        attrib.normals.reserve(3 * counts.normal_count);
+        attrib.texcoords.reserve(2 * counts.texcoord_count);
+
+        dmesh.indices = std::vector<uint32_t>{};
+        dmesh.vertices = std::vector<Model::Vertex>{};
+        dmesh.indices.reserve(3 * counts.triangle_count);
+        dmesh.vertices.reserve(expected_vertices);
+
+        auto weld_window = [&](const std::vector<tinyobj::index_t>& triangles)
         {
-            for (const auto& index : shape.mesh.indices)
+            const int position_count = static_cast<int>(attrib.vertices.size() / 3);
+            const int normal_count = static_cast<int>(attrib.normals.size() / 3);
+            const int texcoord_count = static_cast<int>(attrib.texcoords.size() / 2);
+            for (const auto& index : triangles)
             {
-                Model::Vertex vertex{};
-                // specify the position of the vertex (and color if provided)
-                if (index.vertex_index >= 0)
+                // an index past the attributes read so far is either invalid or points forward in the
+                // file, which cannot be resolved without keeping the faces around
+                if (index.vertex_index >= position_count || index.normal_index >= normal_count || index.texcoord_index >= texcoord_count)
                 {
-                    vertex.a_position = {
-                        attrib.vertices[3 * index.vertex_index + 0], // x
-                        attrib.vertices[3 * index.vertex_index + 1], // y
-                        attrib.vertices[3 * index.vertex_index + 2]  // z
-                    };
-
-                    vertex.a_color = {
-                        attrib.colors[index.vertex_index + 0], // r
-                        attrib.colors[index.vertex_index + 1], // g
-                        attrib.colors[index.vertex_index + 2] // b
-                    };
+                    throw std::runtime_error("Face index out of range");
                 }
 
-                // specify the normal of the vertex
-                if (index.normal_index >= 0)
+                // the weld table and the vertex list are grown here rather than by the welder, so that the old
+                // and the new buffer are accounted for while both exist
+                const size_t table_usage = welder.IsFull() ? welder.GetMemoryUsage() : 0;
+                allocate(2 * table_usage, "weld table");
+
+                Model::Vertex vertex = MakeVertex(attrib, index);
+                if (!counts.has_colors) { vertex.a_color = glm::vec3{1.0f}; } // tinyobj's default color
+                const uint32_t next = static_cast<uint32_t>(dmesh.vertices.size());
+                const uint32_t found = welder.FindOrInsert(VertexWelder::Hash(vertex), next, [&](uint32_t other)
                 {
-                    vertex.a_normal = {
-                        attrib.normals[3 * index.normal_index + 0],
-                        attrib.normals[3 * index.normal_index + 1], 
-                        attrib.normals[3 * index.normal_index + 2] 
-                    };
-                }
+                    return dmesh.vertices[other] == vertex;
+                });
+                used -= table_usage;
 
-                // specify the texture coordinates of the vertex
-                if (index.texcoord_index >= 0)
+                if (found != VertexWelder::INSERTED)
                 {
-                    vertex.a_tex_coords = {
-                        attrib.texcoords[2 * index.texcoord_index + 0],
-                        attrib.texcoords[2 * index.texcoord_index + 1]
-                    };
+                    dmesh.indices.push_back(found);
+                    continue;
                 }
 
-                // check if this vertex already exists
-                if (unique_vertices.count(vertex) == 0)
+                if (dmesh.vertices.size() == dmesh.vertices.capacity())
                 {
-                    unique_vertices[vertex] = static_cast<uint32_t>(dmesh.vertices.size());
-                    dmesh.vertices.push_back(vertex);
+                    const size_t capacity = dmesh.vertices.capacity();
+                    allocate(sizeof(Model::Vertex) * (capacity + capacity / 2), "vertices");
+                    dmesh.vertices.reserve(capacity + capacity / 2);
+                    used -= sizeof(Model::Vertex) * capacity;
                 }
-
-                // add the index to the indices list
-                dmesh.indices.push_back(unique_vertices[vertex]);
+                dmesh.vertices.push_back(vertex);
+                dmesh.indices.push_back(next);
             }
+        };
+
+        if (!ObjParser::ParseStreaming(path, attrib, counts.has_colors, weld_window, window_size))
+        {
+            throw std::runtime_error("Failed to stream model file: " + path);
         }
+
+        DDEBUG("Streamed %s using at most %zu bytes", path.c_str(), peak);
+        dmesh.ComputeBounds();
     }
 } // namespace DORY
\ No newline at end of file
@@ -2,7 +2,7 @@
 #define DORY_OBJECT_LOADER_INCL
 
 #include "renderer/model.h"
-#include <tiny_obj_loader.h>
+#include "loaders/obj_parser.h"
 #include <string>
 
 namespace DORY
@@ -10,7 +10,61 @@ namespace DORY
     class ObjectLoader
     {
         public:
-            static void Load(Model::Mesh& dmesh, const std::string& path);
+            /**
+             * @brief load a mesh from an .obj file. by default the deduplicated mesh is cached next to the
+             * source file in the binary .dmesh format (see MeshCache), and later loads of an unchanged
+             * file read the cache instead of parsing the text again
+             * @param dmesh the mesh to fill
+             * @param path path to the .obj file
+             * @param use_cache whether to read and write the .dmesh cache
+             * @param memory_limit (optional) if not 0, the .obj file is parsed with LoadObjStreaming() and
+             * loading fails rather than use more than this many bytes
+             */
+            static void Load(Model::Mesh& dmesh, const std::string& path, bool use_cache = true, size_t memory_limit = 0);
+
+            /**
+             * @brief parse an .obj file and deduplicate its vertices, bypassing the .dmesh cache
+             * @param dmesh the mesh to fill
+             * @param path path to the .obj file
+             * @param parallel whether to parse with the multi-threaded ObjParser. when false, or when the
+             * file has faces with more than four vertices, tinyobjloader is used on the calling thread.
+             * the parallel path also welds the vertices of large meshes on several threads. both give the same mesh
+             */
+            static void LoadObj(Model::Mesh& dmesh, const std::string& path, bool parallel = true);
+
+            /**
+             * @brief parse an .obj file and deduplicate its vertices with bounded memory, for files that are
+             * too large to load with LoadObj(). the file is read twice through a fixed-size window: once to
+             * count its records and size every buffer up front, and once to parse it, welding the vertices of
+             * each window into the mesh as soon as it has been read. neither the file, nor tinyobj's shapes,
+             * nor the list of all face corners is ever held in memory, only the attribute arrays the faces
+             * index into, the output and the weld table. the mesh is the same as the one LoadObj() gives
+             * @param dmesh the mesh to fill
+             * @param path path to the .obj file
+             * @param memory_limit (optional) largest number of bytes the load may use, 0 for no limit
+             * @param window_size (optional) number of bytes to read from the file at a time
+             * @throws std::runtime_error if the file cannot be read, has faces with more than four vertices
+             * or faces referencing attributes defined after them, or if the limit would be exceeded
+             */
+            static void LoadObjStreaming(   Model::Mesh& dmesh,
+                                            const std::string& path,
+                                            size_t memory_limit = 0,
+                                            size_t window_size = ObjParser::DEFAULT_WINDOW_SIZE);
+
+        private:
+            /**
+             * @brief meshes with fewer corners than this are welded on the calling thread
+             */
+            static constexpr size_t MIN_PARALLEL_WELD_CORNERS = 1 << 16;
+
+            /**
+             * @brief deduplicate the vertices referenced by a list of triangle corners
+             * @param dmesh the mesh to fill
+             * @param attrib the attribute arrays the corners index into
+             * @param indices three corners per triangle
+             * @param parallel whether large meshes may be welded on several threads
+             */
+            static void BuildMesh(Model::Mesh& dmesh, const tinyobj::attrib_t& attrib, const std::vector<tinyobj::index_t>& indices, bool parallel);
     }; // class ObjectLoader
 } // namespace DORY
 
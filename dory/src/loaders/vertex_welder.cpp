@@ -0,0 +1,54 @@
+#include "loaders/vertex_welder.h"
+#include "math/hash.h"
+
+#include <cstring>
+
+namespace DORY
+{
+    VertexWelder::VertexWelder(size_t expected_count)
+    {
+        size_t capacity = 16;
+        while (capacity * 3 < expected_count * 4) { capacity *= 2; }
+        m_slots.assign(capacity, Slot{INSERTED, 0});
+        m_mask = capacity - 1;
+    }
+
+    uint64_t VertexWelder::Hash(const Model::Vertex& vertex)
+    {
+        float key[sizeof(Model::Vertex) / sizeof(float)];
+        memcpy(key, &vertex, sizeof(key));
+        for (float& value : key)
+        {
+            // turns -0.0 into 0.0 and leaves everything else alone
+            if (value == 0.0f) { value = 0.0f; }
+        }
+        return HashBytes(key, sizeof(key));
+    }
+
+    uint32_t VertexWelder::Weld(const Model::Vertex& vertex, std::vector<Model::Vertex>& vertices)
+    {
+        const uint32_t index = static_cast<uint32_t>(vertices.size());
+        const uint32_t found = FindOrInsert(Hash(vertex), index, [&](uint32_t other) { return vertices[other] == vertex; });
+        if (found != INSERTED) { return found; }
+
+        vertices.push_back(vertex);
+        return index;
+    }
+
+    void VertexWelder::Rehash(size_t capacity)
+    {
+        std::vector<Slot> slots(capacity, Slot{INSERTED, 0});
+        const size_t mask = capacity - 1;
+        for (const Slot& entry : m_slots)
+        {
+            if (entry.value == INSERTED) { continue; }
+
+            size_t slot = entry.hash & mask;
+            while (slots[slot].value != INSERTED) { slot = (slot + 1) & mask; }
+            slots[slot] = entry;
+        }
+
+        m_slots.swap(slots);
+        m_mask = mask;
+    }
+} // namespace DORY
\ No newline at end of file
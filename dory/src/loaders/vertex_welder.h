@@ -0,0 +1,194 @@
+#ifndef DORY_VERTEX_WELDER_INCL
+#define DORY_VERTEX_WELDER_INCL
+
+#include "core/job_system.h"
+#include "renderer/model.h"
+#include "utils/nocopy.h"
+#include "utils/parallel.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace DORY
+{
+    /**
+     * @brief flat open-addressing hash table used to merge identical vertices. each slot holds a 32-bit
+     * value (the index of a vertex stored elsewhere) and 32 bits of its hash, so the table is a single
+     * array of 8-byte slots instead of one heap node per vertex, and the key itself is never copied. a
+     * lookup walks the probe sequence once and either finds the matching value or inserts the new one in
+     * the empty slot it stopped at.
+     */
+    class VertexWelder : public NoCopy
+    {
+        public:
+            /**
+             * @brief returned by FindOrInsert() when a value was inserted
+             */
+            static constexpr uint32_t INSERTED = UINT32_MAX;
+
+            /**
+             * @brief create an empty table
+             * @param expected_count (optional) number of distinct values to size the table for
+             */
+            explicit VertexWelder(size_t expected_count = 0);
+
+            /**
+             * @brief hash a vertex. -0.0 and 0.0 compare equal, so they are hashed the same
+             * @param vertex the vertex to hash
+             * @return uint64_t
+             */
+            static uint64_t Hash(const Model::Vertex& vertex);
+
+            /**
+             * @brief look up the value with the given hash for which equal(value) is true, or insert value
+             * if there is none
+             * @tparam Equal callable taking a stored value and returning whether it matches the key
+             * @param hash hash of the key
+             * @param value value to insert if the key is not found. must not be INSERTED
+             * @param equal compares the key with the key of a stored value
+             * @return uint32_t the stored value, or INSERTED if value was inserted
+             */
+            template<typename Equal>
+            uint32_t FindOrInsert(uint64_t hash, uint32_t value, const Equal& equal);
+
+            /**
+             * @brief find a vertex in a vertex list, appending it if it is not there yet
+             * @param vertex the vertex to weld
+             * @param vertices the vertex list, which has to contain exactly the vertices welded so far
+             * @return uint32_t index of the vertex in the list
+             */
+            uint32_t Weld(const Model::Vertex& vertex, std::vector<Model::Vertex>& vertices);
+
+            /**
+             * @brief build an indexed mesh from a list of unindexed corners, merging identical vertices. the
+             * corners are hashed in parallel and then split into shards by hash, so that each shard can be
+             * welded on its own thread; identical vertices always land in the same shard. the vertices come
+             * out in the order of their first occurrence, exactly as if they had been welded one by one
+             * @tparam GetVertex callable taking a corner index and returning its Model::Vertex. it is called
+             * from several threads at once
+             * @param corner_count number of corners
+             * @param get_vertex builds the vertex of a corner
+             * @param dmesh the mesh to fill
+             * @param thread_count (optional) number of threads. 0 uses one per hardware thread
+             */
+            template<typename GetVertex>
+            static void WeldParallel(size_t corner_count, const GetVertex& get_vertex, Model::Mesh& dmesh, uint32_t thread_count = 0);
+
+            /**
+             * @brief get the number of values in the table
+             * @return size_t
+             */
+            size_t GetCount() const { return m_count; }
+
+            /**
+             * @brief check whether the next insertion makes the table grow
+             * @return true if the table doubles in size on the next call to FindOrInsert() or Weld()
+             */
+            bool IsFull() const { return (m_count + 1) * 4 > m_slots.size() * 3; }
+
+            /**
+             * @brief get the number of bytes the table uses
+             * @return size_t
+             */
+            size_t GetMemoryUsage() const { return m_slots.size() * sizeof(Slot); }
+
+        private: // methods
+            /**
+             * @brief move all values into a table with the given number of slots
+             * @param capacity new number of slots, a power of two
+             */
+            void Rehash(size_t capacity);
+
+        private: // members
+            struct Slot
+            {
+                uint32_t value; // stored value, INSERTED marks an empty slot
+                uint32_t hash; // upper 32 bits of the hash of the key
+            };
+
+            std::vector<Slot> m_slots{}; // the table, its size is a power of two
+            size_t m_mask = 0; // number of slots - 1
+            size_t m_count = 0; // number of values in the table
+    }; // class VertexWelder
+
+    template<typename Equal>
+    uint32_t VertexWelder::FindOrInsert(uint64_t hash, uint32_t value, const Equal& equal)
+    {
+        // keep the load factor below 3/4 so that probe sequences stay short
+        if (IsFull()) { Rehash(m_slots.size() * 2); }
+
+        const uint32_t tag = static_cast<uint32_t>(hash >> 32);
+        size_t slot = tag & m_mask;
+        while (true)
+        {
+            Slot& entry = m_slots[slot];
+            if (entry.value == INSERTED)
+            {
+                entry.value = value;
+                entry.hash = tag;
+                m_count++;
+                return INSERTED;
+            }
+            if (entry.hash == tag && equal(entry.value)) { return entry.value; }
+            slot = (slot + 1) & m_mask;
+        }
+    }
+
+    template<typename GetVertex>
+    void VertexWelder::WeldParallel(size_t corner_count, const GetVertex& get_vertex, Model::Mesh& dmesh, uint32_t thread_count)
+    {
+        thread_count = Utils::GetThreadCount(thread_count);
+        JobSystem& jobs = JobSystem::Get();
+
+        std::vector<uint64_t> hashes(corner_count);
+        jobs.ParallelFor(corner_count, (corner_count + thread_count - 1) / thread_count, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++) { hashes[i] = Hash(get_vertex(i)); }
+        });
+
+        // each shard points every corner it owns at the first corner with the same vertex. the table
+        // uses the upper bits of the hash, the shard is picked from the lower ones
+        dmesh.indices.resize(corner_count);
+        jobs.RunParallel(thread_count, [&](size_t shard)
+        {
+            VertexWelder welder(corner_count / thread_count / 4);
+            for (size_t i = 0; i < corner_count; i++)
+            {
+                if (hashes[i] % thread_count != shard) { continue; }
+
+                const Model::Vertex vertex = get_vertex(i);
+                const uint32_t first = welder.FindOrInsert(hashes[i], static_cast<uint32_t>(i), [&](uint32_t other)
+                {
+                    return get_vertex(other) == vertex;
+                });
+                dmesh.indices[i] = first == INSERTED ? static_cast<uint32_t>(i) : first;
+            }
+        });
+        hashes = std::vector<uint64_t>{};
+
+        // number the vertices in order of first occurrence. a corner always points at an earlier corner,
+        // whose entry has already been replaced by its vertex index
+        std::vector<uint32_t> first_corners;
+        for (size_t i = 0; i < corner_count; i++)
+        {
+            const uint32_t first = dmesh.indices[i];
+            if (first == i)
+            {
+                dmesh.indices[i] = static_cast<uint32_t>(first_corners.size());
+                first_corners.push_back(static_cast<uint32_t>(i));
+            }
+            else
+            {
+                dmesh.indices[i] = dmesh.indices[first];
+            }
+        }
+
+        dmesh.vertices.resize(first_corners.size());
+        jobs.ParallelFor(first_corners.size(), (first_corners.size() + thread_count - 1) / thread_count, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++) { dmesh.vertices[i] = get_vertex(first_corners[i]); }
+        });
+    }
+} // namespace DORY
+
+#endif // DORY_VERTEX_WELDER_INCL
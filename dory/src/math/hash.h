@@ -1,6 +1,8 @@
 #ifndef DORY_HASH_INCL
 #define DORY_HASH_INCL
 
+#include <cstdint>
+#include <cstring>
 #include <functional>
 
 namespace DORY
@@ -12,6 +14,52 @@ namespace DORY
         seed ^= std::hash<T>{}(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
         (HashCombine(seed, rest), ...);
     };
+
+    /**
+     * @brief finalizer that spreads every input bit over all 64 output bits
+     * https://zimbry.blogspot.com/2011/09/better-bit-mixing-improving-on.html (mix 13)
+     */
+    inline uint64_t Mix64(uint64_t x)
+    {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        x ^= x >> 31;
+        return x;
+    }
+
+    /**
+     * @brief 64-bit hash of a block of memory. the data is consumed 8 bytes at a time, which makes it
+     * much cheaper than combining per-member std::hash values for small fixed-size keys
+     * @param data pointer to the first byte
+     * @param size number of bytes to hash
+     * @param seed (optional) starting value, to get independent hashes of the same data
+     * @return uint64_t
+     */
+    inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        uint64_t hash = seed ^ (size * 0x9e3779b97f4a7c15ull);
+
+        while (size >= 8)
+        {
+            uint64_t word;
+            memcpy(&word, bytes, 8);
+            hash = (hash ^ Mix64(word)) * 0x9e3779b97f4a7c15ull;
+            bytes += 8;
+            size -= 8;
+        }
+
+        if (size > 0)
+        {
+            uint64_t word = 0;
+            memcpy(&word, bytes, size);
+            hash = (hash ^ Mix64(word)) * 0x9e3779b97f4a7c15ull;
+        }
+
+        return Mix64(hash);
+    }
 } // namespace DORY
 
 #endif // DORY_HASH_INCL
\ No newline at end of file
@@ -1,8 +1,10 @@
 #include "math/transforms.h"
 
+#include <glm/gtc/constants.hpp>
+
 namespace DORY
 {
-    glm::mat4 TransformObject::Matrix()
+    glm::mat4 TransformObject::Matrix() const
     {
         const float c3 = glm::cos(rotation.x);
         const float s3 = glm::sin(rotation.x);
@@ -39,7 +41,7 @@ namespace DORY
         };
     }
 
-        glm::mat4 TransformObject::NormalMatrix()
+        glm::mat4 TransformObject::NormalMatrix() const
     {
         const float c3 = glm::cos(rotation.x);
         const float s3 = glm::sin(rotation.x);
@@ -69,4 +71,17 @@ namespace DORY
             },
         };
     }
+
+    TransformObject TransformObject::Interpolate(const TransformObject& from, const TransformObject& to, float alpha)
+    {
+        // take each angle the shorter way around, so that one wrapping between the two steps (e.g. the yaw
+        // of the camera controller) does not spin the object
+        const glm::vec3 turn = glm::mod(to.rotation - from.rotation + glm::pi<float>(), glm::two_pi<float>()) - glm::pi<float>();
+
+        TransformObject transform{};
+        transform.translation = glm::mix(from.translation, to.translation, alpha);
+        transform.scale = glm::mix(from.scale, to.scale, alpha);
+        transform.rotation = from.rotation + alpha * turn;
+        return transform;
+    }
 } // namespace DORY
\ No newline at end of file
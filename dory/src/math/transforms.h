@@ -24,14 +24,23 @@ namespace DORY
          * https://en.wikipedia.org/wiki/Euler_angles#Rotation_matrix
          * @return glm::mat4 translation * rotation.y * rotation.x * rotation.z * scale
          */
-        glm::mat4 Matrix();
+        glm::mat4 Matrix() const;
 
         /**
          * @brief compute the normal matrix for the object. this is used for lighting
          * when the object is transformed/scaled.
          * @return glm::mat4 
          */
-        glm::mat4 NormalMatrix();
+        glm::mat4 NormalMatrix() const;
+
+        /**
+         * @brief interpolate between two transforms, e.g. those of the last two simulation steps
+         * @param from the transform at alpha 0
+         * @param to the transform at alpha 1
+         * @param alpha how far to go from one to the other
+         * @return TransformObject
+         */
+        static TransformObject Interpolate(const TransformObject& from, const TransformObject& to, float alpha);
     }; // struct TransformObject
 } // namespace DORY
 
@@ -27,8 +27,8 @@ namespace DORY
         glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
         glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE); // resizing will be handled differently with vulkan
 
-        m_window = glfwCreateWindow(m_width, m_height, m_title, NULL, NULL);
-        DINFO("Window created. Width: %d, Height: %d, Title: %s", m_width, m_height, m_title);
+        m_window = glfwCreateWindow(m_width.load(), m_height.load(), m_title, NULL, NULL);
+        DINFO("Window created. Width: %d, Height: %d, Title: %s", m_width.load(), m_height.load(), m_title);
         glfwSetWindowUserPointer(m_window, this);
 
         SetGLFWCallbacks();
@@ -39,6 +39,16 @@ namespace DORY
         return glfwWindowShouldClose(m_window);
     }
 
+    int Window::GetRefreshRate() const
+    {
+        GLFWmonitor* monitor = glfwGetWindowMonitor(m_window);
+        if (monitor == nullptr) { monitor = glfwGetPrimaryMonitor(); }
+        if (monitor == nullptr) { return 0; }
+
+        const GLFWvidmode* mode = glfwGetVideoMode(monitor);
+        return mode != nullptr ? mode->refreshRate : 0;
+    }
+
     void Window::CreateWindowSurface(VkInstance instance, VkSurfaceKHR *surface)
     {
         if (glfwCreateWindowSurface(instance, m_window, NULL, surface) != VK_SUCCESS)
@@ -53,9 +63,10 @@ namespace DORY
 			{
 				// https://www.glfw.org/docs/3.3/group__window.html#gad91b8b047a0c4c6033c38853864c34f8
 				auto _window = reinterpret_cast<Window*>(glfwGetWindowUserPointer(window));
-				_window->m_framebuffer_resized = true;
+                // the render thread reads these, the size is stored before the flag it checks
                 _window->m_width = width;
                 _window->m_height = height;
+				_window->m_framebuffer_resized = true;
 
 				// declare an instance of window resize event
 				WindowResizeEvent event(width, height);
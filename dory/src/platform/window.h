@@ -10,6 +10,7 @@
 #endif
 #include <GLFW/glfw3.h>
 
+#include <atomic>
 #include <functional>
 
 namespace DORY
@@ -42,14 +43,14 @@ namespace DORY
              * @brief return the Vulkan Extent (width and height) of the window.
              * @return VkExtent2D 
              */
-            VkExtent2D GetExtent() const { return {static_cast<uint32_t>(m_width), static_cast<uint32_t>(m_height)}; }
+            VkExtent2D GetExtent() const { return {static_cast<uint32_t>(m_width.load()), static_cast<uint32_t>(m_height.load())}; }
 
             /**
              * @brief check if the window has been resized
              * @return true 
              * @return false 
              */
-            bool WindowResized() { return m_framebuffer_resized; }
+            bool WindowResized() { return m_framebuffer_resized.load(); }
 
             /**
              * @brief once the window resize event is handled, set the flag to false.
@@ -62,6 +63,13 @@ namespace DORY
              */
             GLFWwindow* GetWindow() const { return m_window; }
 
+            /**
+             * @brief get the refresh rate of the monitor showing the window, the primary monitor unless the
+             * window is full screen. call from the main thread
+             * @return int refresh rate in Hz, 0 if unknown
+             */
+            int GetRefreshRate() const;
+
             /**
              * @brief determine whether the window should close or not
              * @return true
@@ -91,11 +99,11 @@ namespace DORY
 
         private: // members
             GLFWwindow *m_window; // pointer to the application's window
-            unsigned int m_width; // window width
-            unsigned int m_height; // window height
+            std::atomic<unsigned int> m_width; // window width, set on the main thread and read by the render thread
+            std::atomic<unsigned int> m_height; // window height
             const char* m_title; // window title
             std::function<void(Event&)> m_callback; // callback function for events
-            bool m_framebuffer_resized = false; // flag to indicate whether the framebuffer has been resized
+            std::atomic<bool> m_framebuffer_resized{false}; // flag to indicate whether the framebuffer has been resized
     }; // class Window
 } // namespace DORY
 
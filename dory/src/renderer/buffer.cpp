@@ -1,6 +1,9 @@
 #include "core/core.h"
 #include "renderer/buffer.h"
 
+#include <algorithm>
+#include <stdexcept>
+
 namespace DORY
 {
     VkDeviceSize Buffer::GetAlignment(VkDeviceSize instance_size, VkDeviceSize min_offset_alignment)
@@ -17,29 +20,78 @@ namespace DORY
         {
             m_alignment_size = GetAlignment(instance_size, min_offset_alignment);
             m_buffer_size = m_alignment_size * instance_count;
-            device.CreateBuffer(m_buffer_size, usage_flags, memory_property_flags, m_buffer, m_memory);
+            device.CreateBuffer(m_buffer_size, usage_flags, memory_property_flags, m_buffer, m_allocation);
         }
 
     Buffer::~Buffer()
     {
         Unmap();
-        vkDestroyBuffer(m_device.GetDevice(), m_buffer, nullptr);
-        vkFreeMemory(m_device.GetDevice(), m_memory, nullptr);
+
+        Destroy(m_device, m_buffer, m_allocation);
     }
 
-    VkResult Buffer::Map(VkDeviceSize size, VkDeviceSize offset)
+    void Buffer::Destroy(Device& device, VkBuffer buffer, const MemoryAllocation& allocation)
     {
-        DASSERT_MSG(m_buffer && m_memory, "Cannot map buffer before it has been created");
-        return vkMapMemory(m_device.GetDevice(), m_memory, offset, size, 0, &m_mapped);
+        // frames in flight may still read the buffer
+        device.GetDeletionQueue().Push([&device, buffer, allocation]() mutable
+        {
+            vkDestroyBuffer(device.GetDevice(), buffer, nullptr);
+            device.GetAllocator().Free(allocation);
+        });
     }
 
-    void Buffer::Unmap() 
+    bool Buffer::Relocate(VkCommandBuffer command_buffer)
     {
-        if (m_mapped) 
+        const VkBufferUsageFlags copy_usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        MemoryAllocator& allocator = m_device.GetAllocator();
+        if ((m_usage_flags & copy_usage) != copy_usage || m_mapped != nullptr || !allocator.CanReallocate(m_allocation)) { return false; }
+
+        VkBufferCreateInfo buffer_info{};
+        buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        buffer_info.size = m_buffer_size;
+        buffer_info.usage = m_usage_flags;
+        buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkBuffer buffer;
+        if (vkCreateBuffer(m_device.GetDevice(), &buffer_info, nullptr, &buffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create buffer!");
+        }
+
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(m_device.GetDevice(), buffer, &requirements);
+        MemoryAllocation allocation{};
+        if (!allocator.Reallocate(m_allocation, requirements, allocation))
         {
-            vkUnmapMemory(m_device.GetDevice(), m_memory);
-            m_mapped = nullptr;
+            vkDestroyBuffer(m_device.GetDevice(), buffer, nullptr);
+            return false;
         }
+        vkBindBufferMemory(m_device.GetDevice(), buffer, allocation.memory, allocation.offset);
+
+        VkBufferCopy copy_region{};
+        copy_region.size = m_buffer_size;
+        vkCmdCopyBuffer(command_buffer, m_buffer, buffer, 1, &copy_region);
+
+        // the old buffer is the source of the copy, and frames in flight may still read it
+        Destroy(m_device, m_buffer, m_allocation);
+        m_buffer = buffer;
+        m_allocation = allocation;
+        return true;
+    }
+
+    VkResult Buffer::Map(VkDeviceSize size, VkDeviceSize offset)
+    {
+        DASSERT_MSG(m_buffer && m_allocation.memory, "Cannot map buffer before it has been created");
+        if (m_allocation.mapped == nullptr) { return VK_ERROR_MEMORY_MAP_FAILED; }
+
+        m_mapped = static_cast<char*>(m_allocation.mapped) + offset;
+        return VK_SUCCESS;
+    }
+
+    void Buffer::Unmap() 
+    {
+        // the memory block stays mapped as long as it is allocated
+        m_mapped = nullptr;
     }
 
     void Buffer::WriteToBuffer(void *data, VkDeviceSize size, VkDeviceSize offset)
@@ -58,23 +110,36 @@ namespace DORY
         }
     }
 
-    VkResult Buffer::Flush(VkDeviceSize size, VkDeviceSize offset) 
+    VkMappedMemoryRange Buffer::GetMappedRange(VkDeviceSize size, VkDeviceSize offset) const
     {
+        // the buffer shares its memory with others, so the range is moved to where the buffer starts and
+        // widened to whole atoms, which the allocator keeps from overlapping other allocations
+        const VkDeviceSize atom = m_device.GetAllocator().GetNonCoherentAtomSize();
+        const VkDeviceSize end = size == VK_WHOLE_SIZE ? m_allocation.size : std::min(offset + size, m_allocation.size);
+        const VkDeviceSize first = (m_allocation.offset + offset) / atom * atom;
+        const VkDeviceSize last = std::min((m_allocation.offset + end + atom - 1) / atom * atom, m_allocation.offset + m_allocation.size);
+
         VkMappedMemoryRange mapped_range = {};
         mapped_range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mapped_range.memory = m_memory;
-        mapped_range.offset = offset;
-        mapped_range.size = size;
+        mapped_range.memory = m_allocation.memory;
+        mapped_range.offset = first;
+        mapped_range.size = last - first;
+        return mapped_range;
+    }
+
+    VkResult Buffer::Flush(VkDeviceSize size, VkDeviceSize offset) 
+    {
+        if (m_device.GetAllocator().IsCoherent(m_allocation)) { return VK_SUCCESS; }
+
+        const VkMappedMemoryRange mapped_range = GetMappedRange(size, offset);
         return vkFlushMappedMemoryRanges(m_device.GetDevice(), 1, &mapped_range);
     }
 
     VkResult Buffer::Invalidate(VkDeviceSize size, VkDeviceSize offset)
     {
-        VkMappedMemoryRange mapped_range = {};
-        mapped_range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mapped_range.memory = m_memory;
-        mapped_range.offset = offset;
-        mapped_range.size = size;
+        if (m_device.GetAllocator().IsCoherent(m_allocation)) { return VK_SUCCESS; }
+
+        const VkMappedMemoryRange mapped_range = GetMappedRange(size, offset);
         return vkInvalidateMappedMemoryRanges(m_device.GetDevice(), 1, &mapped_range);
     }
 
@@ -34,6 +34,7 @@ namespace DORY
             
             /**
              * @brief map a memory range of this buffer. If successful, mapped points to the specified buffer range.
+             * host visible memory stays mapped by the allocator, so this only fails for memory that is not.
              * @param size (optional) size of the memory range to map. default value maps the whole buffer.
              * @param offset (optional) byte offset from beginning
              * @return VkResult 
@@ -104,6 +105,16 @@ namespace DORY
              * @return VkResult
              */
             VkResult InvalidateIndex(int index);
+
+            /**
+             * @brief move the buffer to a fuller memory block of the allocator, see MemoryAllocator::Reallocate().
+             * the contents are copied by the given command buffer, and GetBuffer() returns the new buffer
+             * right away, so this is only for buffers whose users look the handle up each time they record.
+             * the old buffer is destroyed through the deletion queue. needs transfer source and destination usage
+             * @param command_buffer command buffer to record the copy into, outside of a render pass
+             * @return true if the buffer was moved
+             */
+            bool Relocate(VkCommandBuffer command_buffer);
             
             VkBuffer GetBuffer() const { return m_buffer; }
             void* GetMappedMemory() const { return m_mapped; }
@@ -115,6 +126,16 @@ namespace DORY
             VkDeviceSize GetBufferSize() const { return m_buffer_size; }
             
         private: // methods
+            /**
+             * @brief turn a range of the buffer into a range of its memory that can be flushed or invalidated
+             */
+            VkMappedMemoryRange GetMappedRange(VkDeviceSize size, VkDeviceSize offset) const;
+
+            /**
+             * @brief queue the destruction of a buffer and the release of its memory on the deletion queue
+             */
+            static void Destroy(Device& device, VkBuffer buffer, const MemoryAllocation& allocation);
+
             /**
              * @brief returns the minimum instance size required to be compatible with the device's min_offset_alignment
              * @param instance_size the size of an instance
@@ -127,7 +148,7 @@ namespace DORY
             Device& m_device; // the device to create the buffer on
             void* m_mapped = nullptr; // pointer to the mapped memory range
             VkBuffer m_buffer = VK_NULL_HANDLE;
-            VkDeviceMemory m_memory = VK_NULL_HANDLE;
+            MemoryAllocation m_allocation{}; // the range of device memory the buffer is bound to
             
             VkDeviceSize m_buffer_size; // size of the buffer in bytes
             uint32_t m_instance_count; // number of instances in the buffer
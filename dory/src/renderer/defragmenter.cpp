@@ -0,0 +1,148 @@
+#include "core/logger.h"
+#include "renderer/defragmenter.h"
+#include "renderer/frame_timeline.h"
+#include "renderer/geometry_arena.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <utility>
+
+namespace DORY
+{
+    Defragmenter::Defragmenter(Device& device, UploadContext& upload_context)
+        : m_device(device), m_upload_context(upload_context)
+    {
+    }
+
+    void Defragmenter::Register(const std::shared_ptr<Model>& model)
+    {
+        assert(model != nullptr && "Cannot register a null model");
+        m_models.push_back(model);
+    }
+
+    void Defragmenter::SetBudget(VkDeviceSize bytes, float milliseconds)
+    {
+        m_byte_budget = bytes;
+        m_time_budget = milliseconds;
+    }
+
+    void Defragmenter::Update(VkCommandBuffer command_buffer, uint64_t frame_number)
+    {
+        GeometryArena& arena = m_device.GetGeometryArena();
+
+        // the old ranges of the last moves are freed by the deletion queue once the frame that moved them
+        // has finished, which leaves the pages they emptied ready to be released
+        if (m_release_pending && m_device.GetFrameTimeline().IsFrameComplete(m_release_frame))
+        {
+            const VkDeviceSize reserved = arena.GetStats().reserved_bytes;
+            const uint32_t released = arena.ReleaseEmptyPages();
+            m_stats.released_pages += released;
+            m_stats.reclaimed_bytes += reserved - arena.GetStats().reserved_bytes;
+            m_release_pending = false;
+        }
+        if (m_byte_budget == 0) { return; }
+
+        const auto start = std::chrono::steady_clock::now();
+        auto out_of_time = [&]()
+        {
+            return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() >= m_time_budget;
+        };
+
+        m_models.erase(std::remove_if(m_models.begin(), m_models.end(), [](const std::weak_ptr<Model>& model) { return model.expired(); }), m_models.end());
+
+        // pages with uploads in flight must keep their buffers, and pages that models move in or out of
+        // this frame are not moved as well, so that the copies never depend on each other
+        const uint32_t page_count = arena.GetPageCount();
+        std::vector<bool> busy(page_count, false);
+        for (const std::weak_ptr<Model>& entry : m_models)
+        {
+            std::shared_ptr<Model> model = entry.lock();
+            if (model->IsResident() && !m_upload_context.IsFinished(model->GetUploadBatch())) { busy[model->GetGeometryPage()] = true; }
+        }
+
+        // the sparsest pages are emptied first, they are the quickest to release
+        std::vector<std::pair<float, uint32_t>> sparse_pages;
+        for (uint32_t page = 0; page < page_count; page++)
+        {
+            if (!arena.IsPageLive(page)) { continue; }
+            const float usage = arena.GetPageUsage(page);
+            if (usage > 0.0f && usage < MAX_SPARSE_PAGE_USAGE) { sparse_pages.emplace_back(usage, page); }
+        }
+        std::sort(sparse_pages.begin(), sparse_pages.end());
+
+        // a page that models moved into this frame is not emptied in the same frame, its new ranges are
+        // only readable after the barrier below
+        std::vector<bool> filled(page_count, false);
+        VkDeviceSize copied = 0;
+        bool done = false;
+        for (size_t i = 0; i < sparse_pages.size() && !done; i++)
+        {
+            const uint32_t page = sparse_pages[i].second;
+            if (filled[page]) { continue; }
+            for (const std::weak_ptr<Model>& entry : m_models)
+            {
+                if (out_of_time())
+                {
+                    done = true;
+                    break;
+                }
+
+                std::shared_ptr<Model> model = entry.lock();
+                if (!IsMovable(model) || model->GetGeometryPage() != page) { continue; }
+
+                const VkDeviceSize size = arena.GetAllocationSize(model->GetGeometry());
+                if (copied > 0 && copied + size > m_byte_budget)
+                {
+                    done = true;
+                    break;
+                }
+
+                GeometryArena::Allocation moved{};
+                if (!arena.Reallocate(model->GetGeometry(), moved)) { continue; }
+                busy[page] = true;
+                busy[moved.page] = true;
+                filled[moved.page] = true;
+                model->MoveGeometry(command_buffer, moved, frame_number);
+                copied += size;
+                m_stats.model_moves++;
+            }
+        }
+
+        // then the page buffers, out of sparse memory blocks
+        for (uint32_t page = 0; page < page_count && !done && !out_of_time(); page++)
+        {
+            if (!arena.IsPageLive(page) || busy[page]) { continue; }
+            const VkDeviceSize max_bytes = copied == 0 ? VK_WHOLE_SIZE : m_byte_budget - copied;
+            const VkDeviceSize buffer_bytes = arena.RelocateBuffers(command_buffer, page, max_bytes);
+            if (buffer_bytes == 0) { continue; }
+            copied += buffer_bytes;
+            m_stats.buffer_moves++;
+            done = copied >= m_byte_budget;
+        }
+
+        if (copied == 0) { return; }
+        m_stats.moved_bytes += copied;
+        m_release_pending = true;
+        m_release_frame = frame_number;
+
+        // the draws of this frame read the new ranges, and later moves may copy from them
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(command_buffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0,
+                             1, &barrier,
+                             0, nullptr,
+                             0, nullptr);
+        DTRACE("Defragmented %llu bytes in frame %llu", static_cast<unsigned long long>(copied), static_cast<unsigned long long>(frame_number));
+    }
+
+    bool Defragmenter::IsMovable(const std::shared_ptr<Model>& model) const
+    {
+        return model != nullptr && model->IsResident() && m_upload_context.IsFinished(model->GetUploadBatch());
+    }
+} // namespace DORY
\ No newline at end of file
@@ -0,0 +1,109 @@
+#ifndef DORY_DEFRAGMENTER_INCL
+#define DORY_DEFRAGMENTER_INCL
+
+#include "renderer/device.h"
+#include "renderer/model.h"
+#include "renderer/upload_context.h"
+#include "utils/nocopy.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace DORY
+{
+    /**
+     * @brief compacts device memory a little every frame. models are moved out of the sparsely used pages
+     * of the geometry arena into fuller ones, so that the pages empty and can be released, and the page
+     * buffers are moved out of sparsely used memory blocks of the allocator, so that the blocks empty and
+     * are freed. the copies are recorded into the frame's command buffer before its render pass, and the
+     * frame draws from the new ranges right away; the old ranges go through the deletion queue. each
+     * Update() stops once it has used up its byte or time budget, so defragmenting never stalls a frame.
+     */
+    class Defragmenter : public NoCopy
+    {
+        public:
+            /**
+             * @brief default number of bytes copied per frame
+             */
+            static constexpr VkDeviceSize DEFAULT_BYTE_BUDGET = VkDeviceSize{4} << 20;
+
+            /**
+             * @brief default milliseconds of CPU time spent per frame
+             */
+            static constexpr float DEFAULT_TIME_BUDGET = 0.25f;
+
+            /**
+             * @brief pages with a smaller fraction of their bytes in use are emptied
+             */
+            static constexpr float MAX_SPARSE_PAGE_USAGE = 0.5f;
+
+            /**
+             * @brief counters since the defragmenter was created
+             */
+            struct Stats
+            {
+                uint64_t model_moves = 0; // number of times a model was moved to another page
+                uint64_t buffer_moves = 0; // number of times a page buffer was moved to another memory block
+                uint64_t moved_bytes = 0; // number of bytes copied
+                uint32_t released_pages = 0; // number of pages emptied by moves and released
+                VkDeviceSize reclaimed_bytes = 0; // bytes of the released pages. blocks freed by buffer moves show in MemoryAllocator::GetStats()
+            };
+
+            /**
+             * @brief create a defragmenter without models
+             * @param device the device the models are on
+             * @param upload_context context the models are uploaded with, pages are only touched once the device is done with their uploads
+             */
+            Defragmenter(Device& device, UploadContext& upload_context);
+
+            /**
+             * @brief let a model be moved. the defragmenter does not keep it alive. every model in the
+             * geometry arena that is uploaded asynchronously must be registered, or its page may move
+             * while its upload is in flight
+             * @param model the model
+             */
+            void Register(const std::shared_ptr<Model>& model);
+
+            /**
+             * @brief set how much work a single Update() may do. a move larger than the byte budget is
+             * only made by an Update() that copies nothing else
+             * @param bytes number of bytes copied per frame, 0 stops defragmenting
+             * @param milliseconds CPU time spent per frame
+             */
+            void SetBudget(VkDeviceSize bytes, float milliseconds);
+
+            /**
+             * @brief record the moves of this frame and release what the moves of earlier frames emptied.
+             * call once per frame between Renderer::BeginFrame() and the render pass, from the thread that
+             * submits to the graphics queue
+             * @param command_buffer the command buffer of the frame
+             * @param frame_number the frame, see Renderer::GetFrameNumber()
+             */
+            void Update(VkCommandBuffer command_buffer, uint64_t frame_number);
+
+            /**
+             * @brief get the counters
+             * @return const Stats&
+             */
+            const Stats& GetStats() const { return m_stats; }
+
+        private: // methods
+            /**
+             * @brief check whether a model may be moved: resident, finished uploading and not destroyed
+             */
+            bool IsMovable(const std::shared_ptr<Model>& model) const;
+
+        private: // members
+            Device& m_device; // the device the models are on
+            UploadContext& m_upload_context; // uploads the models
+            std::vector<std::weak_ptr<Model>> m_models{}; // the registered models, expired once their last user released them
+            VkDeviceSize m_byte_budget = DEFAULT_BYTE_BUDGET; // see SetBudget()
+            float m_time_budget = DEFAULT_TIME_BUDGET; // see SetBudget()
+            uint64_t m_release_frame = 0; // frame of the last moves, their old ranges have been freed once it has finished
+            bool m_release_pending = false; // whether moves were made since the empty pages were last released
+            Stats m_stats{}; // see GetStats()
+    }; // class Defragmenter
+} // namespace DORY
+
+#endif // DORY_DEFRAGMENTER_INCL
\ No newline at end of file
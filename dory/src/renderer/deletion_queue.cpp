@@ -0,0 +1,58 @@
+#include "renderer/deletion_queue.h"
+
+namespace DORY
+{
+    DeletionQueue::~DeletionQueue()
+    {
+        Flush();
+    }
+
+    void DeletionQueue::Push(std::function<void()> destroy)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_entries.push_back({m_frame, std::move(destroy)});
+    }
+
+    void DeletionQueue::SetFrame(uint64_t frame_number)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_frame = frame_number;
+    }
+
+    void DeletionQueue::Collect(uint64_t completed_frame)
+    {
+        // the destructions run outside of the lock, since destroying an object may queue others, e.g. a
+        // page of the geometry arena destroying its buffers
+        std::deque<Entry> ready;
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            while (!m_entries.empty() && m_entries.front().frame <= completed_frame)
+            {
+                ready.push_back(std::move(m_entries.front()));
+                m_entries.pop_front();
+            }
+        }
+        for (Entry& entry : ready) { entry.destroy(); }
+    }
+
+    void DeletionQueue::Flush()
+    {
+        // destroying an object may queue others, so keep going until nothing is left
+        while (true)
+        {
+            std::deque<Entry> ready;
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                if (m_entries.empty()) { return; }
+                ready.swap(m_entries);
+            }
+            for (Entry& entry : ready) { entry.destroy(); }
+        }
+    }
+
+    size_t DeletionQueue::GetPendingCount() const
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_entries.size();
+    }
+} // namespace DORY
\ No newline at end of file
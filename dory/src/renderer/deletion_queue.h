@@ -0,0 +1,73 @@
+#ifndef DORY_DELETION_QUEUE_INCL
+#define DORY_DELETION_QUEUE_INCL
+
+#include "utils/nocopy.h"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace DORY
+{
+    /**
+     * @brief destroys Vulkan objects once the device is done with them, instead of waiting for the device
+     * to go idle. every destruction is tagged with the last frame that was begun when it was pushed, since
+     * that frame may still read the object, and runs once the device's FrameTimeline shows that frame has
+     * finished. objects that are never drawn are destroyed a few frames late, which is harmless. thread safe.
+     */
+    class DeletionQueue : public NoCopy
+    {
+        public:
+            /**
+             * @brief destroy everything still queued. the device must be idle
+             */
+            ~DeletionQueue();
+
+            /**
+             * @brief queue the destruction of objects that frames in flight may use
+             * @param destroy destroys the objects, called from the thread that calls Collect()
+             */
+            void Push(std::function<void()> destroy);
+
+            /**
+             * @brief set the frame that is being recorded, which objects pushed from now on are tagged with
+             * @param frame_number the frame, see Renderer::GetFrameNumber()
+             */
+            void SetFrame(uint64_t frame_number);
+
+            /**
+             * @brief destroy the objects tagged with a frame that has finished on the device
+             * @param completed_frame every frame up to and including this one has finished
+             */
+            void Collect(uint64_t completed_frame);
+
+            /**
+             * @brief destroy everything that is queued. the device must be idle
+             */
+            void Flush();
+
+            /**
+             * @brief get the number of destructions waiting for their frame
+             * @return size_t
+             */
+            size_t GetPendingCount() const;
+
+        private: // types
+            /**
+             * @brief a queued destruction
+             */
+            struct Entry
+            {
+                uint64_t frame = 0; // frame that may still use the objects
+                std::function<void()> destroy{}; // destroys the objects
+            };
+
+        private: // members
+            std::deque<Entry> m_entries{}; // queued destructions, in frame order
+            uint64_t m_frame = 0; // see SetFrame()
+            mutable std::mutex m_mutex{}; // guards m_entries and m_frame
+    }; // class DeletionQueue
+} // namespace DORY
+
+#endif // DORY_DELETION_QUEUE_INCL
\ No newline at end of file
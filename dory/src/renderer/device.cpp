@@ -1,6 +1,9 @@
 #include "renderer/device.h"
+#include "renderer/frame_timeline.h"
+#include "renderer/geometry_arena.h"
 
 // std headers
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -62,10 +65,20 @@ namespace DORY {
         PickPhysicalDevice();
         CreateLogicalDevice();
         CreateCommandPool();
+        m_allocator = std::make_unique<MemoryAllocator>(m_physical_device, m_device);
+        m_frame_timeline = std::make_unique<FrameTimeline>(*this);
+        m_geometry_arena = std::make_unique<GeometryArena>(*this);
     }
 
     Device::~Device()
     {
+        // the queued destructions may free ranges of the arena, and destroying the arena queues more
+        vkDeviceWaitIdle(m_device);
+        m_deletion_queue.Flush();
+        m_geometry_arena.reset();
+        m_deletion_queue.Flush();
+        m_frame_timeline.reset();
+        m_allocator.reset();
         vkDestroyCommandPool(m_device, m_command_pool, nullptr);
         vkDestroyDevice(m_device, nullptr);
 
@@ -91,7 +104,7 @@ namespace DORY {
         app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         app_info.pEngineName = "No Engine";
         app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        app_info.apiVersion = VK_API_VERSION_1_0;
+        app_info.apiVersion = VK_API_VERSION_1_2; // for timeline semaphores, see FrameTimeline
 
         VkInstanceCreateInfo create_info = {};
         create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -123,6 +136,7 @@ namespace DORY {
         {
             throw std::runtime_error("Failed to create instance!");
         }
+        m_has_properties_2 = std::find_if(extensions.begin(), extensions.end(), [](const char* name) { return std::strcmp(name, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0; }) != extensions.end();
 
         HasGflwRequiredInstanceExtensions();
     }
@@ -163,6 +177,7 @@ namespace DORY {
 
         std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
         std::set<uint32_t> unique_queue_families = {indices._graphics_family, indices._present_family};
+        if (indices._transfer_family_has_value) { unique_queue_families.insert(indices._transfer_family); }
 
         float queuePriority = 1.0f;
         for (uint32_t queue_family : unique_queue_families)
@@ -178,15 +193,25 @@ namespace DORY {
         VkPhysicalDeviceFeatures device_features = {};
         device_features.samplerAnisotropy = VK_TRUE;
 
+        VkPhysicalDeviceVulkan12Features vulkan_12_features = {};
+        vulkan_12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        vulkan_12_features.timelineSemaphore = VK_TRUE;
+
         VkDeviceCreateInfo create_info = {};
         create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        create_info.pNext = &vulkan_12_features;
 
         create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
         create_info.pQueueCreateInfos = queue_create_infos.data();
 
+        // the memory budget is optional, GetMemoryBudget() estimates it without the extension
+        std::vector<const char*> extensions = m_device_extensions;
+        const bool memory_budget = m_has_properties_2 && IsDeviceExtensionAvailable(m_physical_device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        if (memory_budget) { extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME); }
+
         create_info.pEnabledFeatures = &device_features;
-        create_info.enabledExtensionCount = static_cast<uint32_t>(m_device_extensions.size());
-        create_info.ppEnabledExtensionNames = m_device_extensions.data();
+        create_info.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+        create_info.ppEnabledExtensionNames = extensions.data();
 
         // might not really be necessary anymore because device specific validation layers
         // have been deprecated
@@ -205,8 +230,19 @@ namespace DORY {
             throw std::runtime_error("Failed to create logical device!");
         }
 
+        if (memory_budget)
+        {
+            m_get_memory_properties_2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+        }
+
         vkGetDeviceQueue(m_device, indices._graphics_family, 0, &m_graphics_queue);
         vkGetDeviceQueue(m_device, indices._present_family, 0, &m_present_queue);
+
+        m_transfer_queue = m_graphics_queue;
+        if (indices._transfer_family_has_value)
+        {
+            vkGetDeviceQueue(m_device, indices._transfer_family, 0, &m_transfer_queue);
+        }
     }
 
     void Device::CreateCommandPool()
@@ -241,7 +277,20 @@ namespace DORY {
         VkPhysicalDeviceFeatures supported_features;
         vkGetPhysicalDeviceFeatures(device, &supported_features);
 
-        return indices.IsComplete() && extensions_supported && swap_chain_adequate && supported_features.samplerAnisotropy;
+        // frames are synchronized with a timeline semaphore, which needs Vulkan 1.2
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(device, &properties);
+        VkPhysicalDeviceVulkan12Features vulkan_12_features = {};
+        vulkan_12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        if (properties.apiVersion >= VK_API_VERSION_1_2)
+        {
+            VkPhysicalDeviceFeatures2 features_2 = {};
+            features_2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features_2.pNext = &vulkan_12_features;
+            vkGetPhysicalDeviceFeatures2(device, &features_2);
+        }
+
+        return indices.IsComplete() && extensions_supported && swap_chain_adequate && supported_features.samplerAnisotropy && vulkan_12_features.timelineSemaphore;
     }
 
     void Device::PopulateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &create_info)
@@ -318,6 +367,12 @@ namespace DORY {
         #ifdef __APPLE__
             extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
             extensions.push_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
+        #else
+            // optional, needed to query the memory budget
+            if (IsInstanceExtensionAvailable(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME))
+            {
+                extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+            }
         #endif
 
         return extensions;
@@ -371,6 +426,66 @@ namespace DORY {
         return requiredExtensions.empty();
     }
 
+    bool Device::IsInstanceExtensionAvailable(const char* name)
+    {
+        uint32_t extension_count = 0;
+        vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, nullptr);
+        std::vector<VkExtensionProperties> extensions(extension_count);
+        vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, extensions.data());
+
+        for (const auto &extension : extensions)
+        {
+            if (std::strcmp(extension.extensionName, name) == 0) { return true; }
+        }
+        return false;
+    }
+
+    bool Device::IsDeviceExtensionAvailable(VkPhysicalDevice device, const char* name)
+    {
+        uint32_t extension_count = 0;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, nullptr);
+        std::vector<VkExtensionProperties> extensions(extension_count);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, extensions.data());
+
+        for (const auto &extension : extensions)
+        {
+            if (std::strcmp(extension.extensionName, name) == 0) { return true; }
+        }
+        return false;
+    }
+
+    std::vector<MemoryHeapBudget> Device::GetMemoryBudget()
+    {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties{};
+        budget_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        VkPhysicalDeviceMemoryProperties2KHR properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+        properties.pNext = &budget_properties;
+
+        if (m_get_memory_properties_2 != nullptr) { m_get_memory_properties_2(m_physical_device, &properties); }
+        else { vkGetPhysicalDeviceMemoryProperties(m_physical_device, &properties.memoryProperties); }
+
+        const VkPhysicalDeviceMemoryProperties& memory_properties = properties.memoryProperties;
+        std::vector<MemoryHeapBudget> heaps(memory_properties.memoryHeapCount);
+        for (uint32_t i = 0; i < memory_properties.memoryHeapCount; i++)
+        {
+            heaps[i]._size = memory_properties.memoryHeaps[i].size;
+            heaps[i]._device_local = (memory_properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+            if (m_get_memory_properties_2 != nullptr)
+            {
+                heaps[i]._budget = budget_properties.heapBudget[i];
+                heaps[i]._usage = budget_properties.heapUsage[i];
+            }
+            else
+            {
+                // leave room for other applications and the driver, as the extension would
+                heaps[i]._budget = heaps[i]._size / 10 * 8;
+                heaps[i]._usage = m_allocator->GetHeapUsage(i);
+            }
+        }
+        return heaps;
+    }
+
     QueueFamilyIndices Device::FindQueueFamilies(VkPhysicalDevice device)
     {
         QueueFamilyIndices indices;
@@ -405,6 +520,22 @@ namespace DORY {
             i++;
         }
 
+        // prefer a family that can only transfer, since it maps to the copy engines, over one that can also
+        // compute. graphics families are left out; uploads share the graphics queue then
+        for (uint32_t family = 0; family < queue_family_count; family++)
+        {
+            const VkQueueFlags flags = queue_families[family].queueFlags;
+            if (queue_families[family].queueCount == 0 || !(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT))
+            {
+                continue;
+            }
+            if (!indices._transfer_family_has_value || !(flags & VK_QUEUE_COMPUTE_BIT))
+            {
+                indices._transfer_family = family;
+                indices._transfer_family_has_value = true;
+            }
+        }
+
         return indices;
     }
 
@@ -474,7 +605,7 @@ namespace DORY {
                                 VkBufferUsageFlags usage,
                                 VkMemoryPropertyFlags properties,
                                 VkBuffer &buffer,
-                                VkDeviceMemory &buffer_memory)
+                                MemoryAllocation &buffer_memory)
     {
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -490,17 +621,8 @@ namespace DORY {
         VkMemoryRequirements memRequirements;
         vkGetBufferMemoryRequirements(m_device, buffer, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(m_device, &allocInfo, nullptr, &buffer_memory) != VK_SUCCESS)
-        {
-            throw std::runtime_error("Failed to allocate vertex buffer memory!");
-        }
-
-        vkBindBufferMemory(m_device, buffer, buffer_memory, 0);
+        buffer_memory = m_allocator->Allocate(memRequirements, properties, MemoryAllocator::ResourceType::Linear);
+        vkBindBufferMemory(m_device, buffer, buffer_memory.memory, buffer_memory.offset);
     }
 
     VkCommandBuffer Device::BeginSingleTimeCommands()
@@ -537,13 +659,13 @@ namespace DORY {
         vkFreeCommandBuffers(m_device, m_command_pool, 1, &command_buffer);
     }
 
-    void Device::CopyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size)
+    void Device::CopyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size, VkDeviceSize dst_offset)
     {
         VkCommandBuffer command_buffer = BeginSingleTimeCommands();
 
         VkBufferCopy copy_region{};
         copy_region.srcOffset = 0;  // Optional
-        copy_region.dstOffset = 0;  // Optional
+        copy_region.dstOffset = dst_offset;
         copy_region.size = size;
         vkCmdCopyBuffer(command_buffer, src_buffer, dst_buffer, 1, &copy_region);
 
@@ -579,7 +701,7 @@ namespace DORY {
     void Device::CreateImageWithInfo(   const VkImageCreateInfo &image_info,
                                         VkMemoryPropertyFlags properties,
                                         VkImage &image,
-                                        VkDeviceMemory &image_memory)
+                                        MemoryAllocation &image_memory)
     {
         if (vkCreateImage(m_device, &image_info, nullptr, &image) != VK_SUCCESS)
         {
@@ -589,17 +711,10 @@ namespace DORY {
         VkMemoryRequirements mem_requirements;
         vkGetImageMemoryRequirements(m_device, image, &mem_requirements);
 
-        VkMemoryAllocateInfo alloc_info{};
-        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        alloc_info.allocationSize = mem_requirements.size;
-        alloc_info.memoryTypeIndex = FindMemoryType(mem_requirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(m_device, &alloc_info, nullptr, &image_memory) != VK_SUCCESS)
-        {
-            throw std::runtime_error("Failed to allocate image memory!");
-        }
+        const MemoryAllocator::ResourceType type = image_info.tiling == VK_IMAGE_TILING_LINEAR ? MemoryAllocator::ResourceType::Linear : MemoryAllocator::ResourceType::Optimal;
+        image_memory = m_allocator->Allocate(mem_requirements, properties, type);
 
-        if (vkBindImageMemory(m_device, image, image_memory, 0) != VK_SUCCESS)
+        if (vkBindImageMemory(m_device, image, image_memory.memory, image_memory.offset) != VK_SUCCESS)
         {
             throw std::runtime_error("Failed to bind image memory!");
         }
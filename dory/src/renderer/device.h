@@ -2,13 +2,19 @@
 #define DORY_DEVICE_INCL
 
 #include "platform/window.h"
+#include "renderer/deletion_queue.h"
+#include "renderer/memory_allocator.h"
 #include "utils/nocopy.h"
 
+#include <memory>
 #include <vector>
 #include <string>
 
 namespace DORY
 {
+    class FrameTimeline;
+    class GeometryArena;
+
     /**
      * @brief struct containing info about swap chain supported capabilities, formats, and present modes
      */
@@ -19,17 +25,34 @@ namespace DORY
         std::vector<VkPresentModeKHR> _present_modes;
     };
 
+    /**
+     * @brief how much of a memory heap the application may use and how much it does. with
+     * VK_EXT_memory_budget both come from the driver and include other processes; without it the budget
+     * is a fixed share of the heap and the usage only counts what the device's allocator took
+     */
+    struct MemoryHeapBudget
+    {
+        VkDeviceSize _size = 0; // size of the heap
+        VkDeviceSize _budget = 0; // bytes the application can allocate from the heap without trouble
+        VkDeviceSize _usage = 0; // bytes the application has allocated from the heap
+        bool _device_local = false; // whether the heap is device local memory
+    };
+
     /**
      * @brief a struct for bundling together queue families.  _graphics_family and _present_family are hold
      * the indices of the queue families that support graphics and presentation respectively which have been
-     * selected by ::Device::FindQueueFamilies()
+     * selected by ::Device::FindQueueFamilies(). _transfer_family holds a family that supports transfers but
+     * not graphics, if the device has one; such queues are usually backed by DMA engines that copy while
+     * the graphics queue renders
      */
     struct QueueFamilyIndices
     {
         uint32_t _graphics_family;
         uint32_t _present_family;
+        uint32_t _transfer_family;
         bool _graphics_family_has_value = false;
         bool _present_family_has_value = false;
+        bool _transfer_family_has_value = false;
         bool IsComplete() { return _graphics_family_has_value && _present_family_has_value; }
     };
 
@@ -99,6 +122,36 @@ namespace DORY
              */
             VkQueue GetPresentQueue() { return m_present_queue; }
 
+            /**
+             * @brief get the queue uploads are submitted to. this is the graphics queue unless the device
+             * has a dedicated transfer queue family, see HasDedicatedTransferQueue()
+             * @return VkQueue 
+             */
+            VkQueue GetTransferQueue() { return m_transfer_queue; }
+
+            /**
+             * @brief check whether GetTransferQueue() belongs to a different queue family than the graphics
+             * queue, in which case buffers written on it have to be handed over to the graphics queue family
+             * @return true 
+             * @return false 
+             */
+            bool HasDedicatedTransferQueue() { return m_transfer_queue != m_graphics_queue; }
+
+            /**
+             * @brief get the budget and usage of every memory heap, indexed like the heaps of the physical
+             * device. queried anew on each call
+             * @return std::vector<MemoryHeapBudget> 
+             */
+            std::vector<MemoryHeapBudget> GetMemoryBudget();
+
+            /**
+             * @brief check whether GetMemoryBudget() reports the driver's numbers from VK_EXT_memory_budget
+             * rather than estimates
+             * @return true 
+             * @return false 
+             */
+            bool HasMemoryBudgetExtension() { return m_get_memory_properties_2 != nullptr; }
+
             /**
              * @brief get supported swapchain functionality.
              * @return SwapChainSupportDetails 
@@ -122,15 +175,40 @@ namespace DORY
              */
             VkFormat FindSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
+            /**
+             * @brief get the allocator that device memory is taken from
+             * @return MemoryAllocator&
+             */
+            MemoryAllocator& GetAllocator() { return *m_allocator; }
+
+            /**
+             * @brief get the queue that objects possibly used by frames in flight are destroyed through
+             * @return DeletionQueue&
+             */
+            DeletionQueue& GetDeletionQueue() { return m_deletion_queue; }
+
+            /**
+             * @brief get the timeline semaphore counting the frames the device has finished
+             * @return FrameTimeline&
+             */
+            FrameTimeline& GetFrameTimeline() { return *m_frame_timeline; }
+
+            /**
+             * @brief get the arena holding the vertices and indices of every model
+             * @return GeometryArena&
+             */
+            GeometryArena& GetGeometryArena() { return *m_geometry_arena; }
+
             /**
              * @brief create a buffer object
              * @param size size of the buffer to be created
              * @param usage usage of the buffer to be created (e.g. vertex buffer, index buffer, uniform buffer)
              * @param properties properties of the buffer to be created (e.g. host visible, host coherent, device local)
              * @param buffer pointer to where the created buffer will be stored
-             * @param buffer_memory pointer to the created buffer's memory size
+             * @param buffer_memory the range of device memory the buffer is bound to, to be freed with
+             * GetAllocator().Free() after the buffer has been destroyed
              */
-            void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &buffer_memory);
+            void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, MemoryAllocation &buffer_memory);
             VkCommandBuffer BeginSingleTimeCommands();
             void EndSingleTimeCommands(VkCommandBuffer command_buffer);
 
@@ -139,8 +217,9 @@ namespace DORY
              * @param src_buffer source buffer
              * @param dst_buffer destination buffer
              * @param size size of buffer to copy
+             * @param dst_offset (optional) byte offset within the destination buffer
              */
-            void CopyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size);
+            void CopyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size, VkDeviceSize dst_offset = 0);
 
             /**
              * @brief copy buffer to image
@@ -157,9 +236,10 @@ namespace DORY
              * @param image_info image info
              * @param properties properties of the buffer
              * @param image image to copy
-             * @param image_memory image memory object
+             * @param image_memory the range of device memory the image is bound to, to be freed with
+             * GetAllocator().Free() after the image has been destroyed
              */
-            void CreateImageWithInfo(const VkImageCreateInfo &image_info, VkMemoryPropertyFlags properties, VkImage &image, VkDeviceMemory &image_memory);
+            void CreateImageWithInfo(const VkImageCreateInfo &image_info, VkMemoryPropertyFlags properties, VkImage &image, MemoryAllocation &image_memory);
 
             VkPhysicalDeviceProperties m_properties; // physical device properties in device
 
@@ -250,6 +330,23 @@ namespace DORY
              */
             bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
 
+            /**
+             * @brief check whether an optional instance extension is available
+             * @param name name of the extension
+             * @return true 
+             * @return false 
+             */
+            bool IsInstanceExtensionAvailable(const char* name);
+
+            /**
+             * @brief check whether an optional extension is available on a device
+             * @param device device to check
+             * @param name name of the extension
+             * @return true 
+             * @return false 
+             */
+            bool IsDeviceExtensionAvailable(VkPhysicalDevice device, const char* name);
+
             /**
              * @brief find the supported swap chain properties for the current device.
              * @param device 
@@ -268,6 +365,13 @@ namespace DORY
             VkSurfaceKHR m_surface; // surface in device
             VkQueue m_graphics_queue; // graphics queue in device
             VkQueue m_present_queue; // present queue in device
+            VkQueue m_transfer_queue; // transfer queue in device, the graphics queue if there is no dedicated one
+            std::unique_ptr<MemoryAllocator> m_allocator{}; // sub-allocates device memory for buffers and images
+            DeletionQueue m_deletion_queue{}; // destroys objects once the frames that may use them have finished
+            std::unique_ptr<FrameTimeline> m_frame_timeline{}; // counts the frames the device has finished
+            std::unique_ptr<GeometryArena> m_geometry_arena{}; // vertices and indices of every model
+            bool m_has_properties_2 = false; // whether VK_KHR_get_physical_device_properties2 is enabled on the instance
+            PFN_vkGetPhysicalDeviceMemoryProperties2KHR m_get_memory_properties_2 = nullptr; // set if VK_EXT_memory_budget is enabled
 
             /**
              * @brief vector enabling the "useful standard validation"
@@ -0,0 +1,61 @@
+#include "renderer/frame_allocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace DORY
+{
+    FrameAllocator::FrameAllocator(Device& device, uint32_t frame_count, VkDeviceSize frame_size)
+        : m_frame_count(frame_count)
+    {
+        const VkPhysicalDeviceLimits& limits = device.m_properties.limits;
+        m_alignment = std::max<VkDeviceSize>({limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment, 1});
+        m_frame_size = (frame_size + m_alignment - 1) / m_alignment * m_alignment;
+
+        // dynamic offsets are 32 bit
+        if (m_frame_size * m_frame_count > UINT32_MAX)
+        {
+            throw std::runtime_error("Failed to create frame allocator, frame size is too large!");
+        }
+
+        m_buffer = std::make_unique<Buffer>(device,
+                                            m_frame_size,
+                                            m_frame_count,
+                                            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                                            m_alignment);
+        if (m_buffer->Map() != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to map frame allocator!");
+        }
+    }
+
+    void FrameAllocator::Reset(uint32_t frame_index)
+    {
+        m_frame_start = m_frame_size * (frame_index % m_frame_count);
+        m_head = m_frame_start;
+    }
+
+    FrameAllocator::Allocation FrameAllocator::Allocate(VkDeviceSize size)
+    {
+        const VkDeviceSize start = (m_head + m_alignment - 1) / m_alignment * m_alignment;
+        if (start + size > m_frame_start + m_frame_size)
+        {
+            throw std::runtime_error("Failed to allocate frame memory, the frame size is too small!");
+        }
+        m_head = start + size;
+        m_peak_size = std::max(m_peak_size, m_head - m_frame_start);
+
+        Allocation allocation{};
+        allocation.buffer = m_buffer->GetBuffer();
+        allocation.offset = static_cast<uint32_t>(start);
+        allocation.data = static_cast<char*>(m_buffer->GetMappedMemory()) + start;
+        return allocation;
+    }
+
+    void FrameAllocator::Flush()
+    {
+        if (m_head == m_frame_start) { return; }
+        m_buffer->Flush(m_head - m_frame_start, m_frame_start);
+    }
+} // namespace DORY
\ No newline at end of file
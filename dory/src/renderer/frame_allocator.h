@@ -0,0 +1,129 @@
+#ifndef DORY_FRAME_ALLOCATOR_INCL
+#define DORY_FRAME_ALLOCATOR_INCL
+
+#include "renderer/buffer.h"
+#include "renderer/device.h"
+#include "utils/nocopy.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace DORY
+{
+    /**
+     * @brief a persistently mapped host visible buffer for data that is written once per frame, such as
+     * uniforms. the buffer is split into one region per frame in flight, and space is bump allocated from
+     * the region of the current frame; the region is reset as a whole once the fence of the frame that last
+     * used it has been waited on. offsets are aligned for uniform and storage buffer descriptors, so they can
+     * be passed as dynamic offsets to a descriptor set written once with DescriptorInfo().
+     */
+    class FrameAllocator : public NoCopy
+    {
+        public:
+            /**
+             * @brief default capacity of the region of each frame
+             */
+            static constexpr VkDeviceSize DEFAULT_FRAME_SIZE = VkDeviceSize{1} << 20;
+
+            /**
+             * @brief space handed out for one frame
+             */
+            struct Allocation
+            {
+                VkBuffer buffer = VK_NULL_HANDLE; // the buffer the space is in
+                uint32_t offset = 0; // byte offset within the buffer, usable as a dynamic offset
+                void* data = nullptr; // host address of the space
+            };
+
+            /**
+             * @brief create the buffer and map it
+             * @param device the device to create the buffer on
+             * @param frame_count number of frames in flight, each gets its own region
+             * @param frame_size (optional) capacity of each region in bytes
+             */
+            FrameAllocator(Device& device, uint32_t frame_count, VkDeviceSize frame_size = DEFAULT_FRAME_SIZE);
+
+            /**
+             * @brief start allocating from the region of a frame, dropping everything allocated from it
+             * before. the fence of the frame that last used the region must have been waited on
+             * @param frame_index index of the frame in flight
+             */
+            void Reset(uint32_t frame_index);
+
+            /**
+             * @brief take space from the region of the current frame
+             * @param size number of bytes needed
+             * @return Allocation
+             */
+            Allocation Allocate(VkDeviceSize size);
+
+            /**
+             * @brief copy a value into the region of the current frame
+             * @param value the value to copy
+             * @return uint32_t offset of the copy within the buffer, to pass as a dynamic offset
+             */
+            template<typename T>
+            uint32_t Push(const T& value)
+            {
+                Allocation allocation = Allocate(sizeof(T));
+                std::memcpy(allocation.data, &value, sizeof(T));
+                return allocation.offset;
+            }
+
+            /**
+             * @brief make what was written to the current frame visible to the device. must be called
+             * before the frame is submitted
+             */
+            void Flush();
+
+            /**
+             * @brief get the descriptor info for a dynamic uniform or storage buffer binding of this buffer.
+             * the offset of each draw is given as a dynamic offset when binding the set
+             * @param range number of bytes the shader reads from the dynamic offset
+             * @return VkDescriptorBufferInfo
+             */
+            VkDescriptorBufferInfo DescriptorInfo(VkDeviceSize range) const { return {m_buffer->GetBuffer(), 0, range}; }
+
+            /**
+             * @brief get the buffer the space is handed out from
+             * @return VkBuffer
+             */
+            VkBuffer GetBuffer() const { return m_buffer->GetBuffer(); }
+
+            /**
+             * @brief get the alignment of the offsets handed out
+             * @return VkDeviceSize
+             */
+            VkDeviceSize GetAlignment() const { return m_alignment; }
+
+            /**
+             * @brief get the capacity of the region of each frame
+             * @return VkDeviceSize
+             */
+            VkDeviceSize GetFrameSize() const { return m_frame_size; }
+
+            /**
+             * @brief get the number of bytes taken from the region of the current frame, including padding
+             * @return VkDeviceSize
+             */
+            VkDeviceSize GetUsedSize() const { return m_head - m_frame_start; }
+
+            /**
+             * @brief get the most bytes any frame has taken, to size the regions with
+             * @return VkDeviceSize
+             */
+            VkDeviceSize GetPeakSize() const { return m_peak_size; }
+
+        private: // members
+            std::unique_ptr<Buffer> m_buffer{}; // the regions of every frame, mapped for its whole lifetime
+            VkDeviceSize m_alignment = 1; // alignment of the offsets handed out
+            VkDeviceSize m_frame_size = 0; // capacity of each region, a multiple of m_alignment
+            uint32_t m_frame_count = 0; // number of regions
+            VkDeviceSize m_frame_start = 0; // offset of the region of the current frame
+            VkDeviceSize m_head = 0; // offset where the next allocation starts
+            VkDeviceSize m_peak_size = 0; // see GetPeakSize()
+    }; // class FrameAllocator
+} // namespace DORY
+
+#endif // DORY_FRAME_ALLOCATOR_INCL
\ No newline at end of file
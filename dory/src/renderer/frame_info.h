@@ -2,14 +2,28 @@
 #define DORY_FRAME_INFO_INCL
 
 #include "renderer/camera.h"
+#include "renderer/frame_allocator.h"
 #include "renderer/object.h"
+#include "renderer/secondary_command_pools.h"
 
 #include <vulkan/vulkan.h>
 
-#include <unordered_map>
+#include <vector>
 
 namespace DORY
 {
+    /**
+     * @brief the state of the scene the simulation hands to the render thread for one frame. the
+     * application keeps two, filling one while the other is drawn, so neither thread ever sees the other
+     * change it
+     */
+    struct FrameSnapshot
+    {
+        float frame_time = 0.0f; // time since the previous snapshot, in seconds
+        Camera camera{}; // the viewer, with its projection already set
+        std::vector<Object> objects{}; // clones of the application's objects
+    }; // struct FrameSnapshot
+
     /**
      * @brief struct containing information related to a frame passed to the renderer.
      */
@@ -18,9 +32,13 @@ namespace DORY
         int frame_index;
         float frame_time;
         VkCommandBuffer command_buffer;
-        Camera &camera;
-        VkDescriptorSet descriptor_set;
-        std::unordered_map<uint32_t, Object> &objects;
+        const Camera &camera;
+        VkDescriptorSet descriptor_set; // global set, its uniform buffer binding is dynamic
+        const std::vector<Object> &objects; // the objects as they were when the frame's snapshot was taken
+        uint32_t global_ubo_offset; // dynamic offset of this frame's UniformBufferObject in descriptor_set
+        FrameAllocator &frame_allocator; // for any other data the systems write this frame
+        uint64_t frame_number; // see Renderer::GetFrameNumber()
+        SecondaryCommandPools &secondary_pools; // to record the render pass into, it is begun with secondary command buffer contents
 
     }; // struct FrameInfo
 } // namespace DORY
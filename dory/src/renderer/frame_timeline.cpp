@@ -0,0 +1,65 @@
+#include "renderer/frame_timeline.h"
+#include "renderer/device.h"
+
+#include <limits>
+#include <stdexcept>
+
+namespace DORY
+{
+    FrameTimeline::FrameTimeline(Device& device)
+        : m_device{device}
+    {
+        VkSemaphoreTypeCreateInfo type_info{};
+        type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        type_info.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphore_info{};
+        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphore_info.pNext = &type_info;
+        if (vkCreateSemaphore(m_device.GetDevice(), &semaphore_info, nullptr, &m_semaphore) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create frame timeline semaphore!");
+        }
+    }
+
+    FrameTimeline::~FrameTimeline()
+    {
+        vkDestroySemaphore(m_device.GetDevice(), m_semaphore, nullptr);
+    }
+
+    void FrameTimeline::Wait(uint64_t frame_number)
+    {
+        const uint64_t value = GetSignalValue(frame_number);
+        if (value <= m_completed.load(std::memory_order_acquire)) { return; }
+
+        VkSemaphoreWaitInfo wait_info{};
+        wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        wait_info.semaphoreCount = 1;
+        wait_info.pSemaphores = &m_semaphore;
+        wait_info.pValues = &value;
+        if (vkWaitSemaphores(m_device.GetDevice(), &wait_info, std::numeric_limits<uint64_t>::max()) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to wait for frame timeline semaphore!");
+        }
+        SetCompleted(value);
+    }
+
+    uint64_t FrameTimeline::Poll()
+    {
+        uint64_t value = 0;
+        if (vkGetSemaphoreCounterValue(m_device.GetDevice(), m_semaphore, &value) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to read frame timeline semaphore!");
+        }
+        SetCompleted(value);
+        return GetCompletedCount();
+    }
+
+    void FrameTimeline::SetCompleted(uint64_t value)
+    {
+        // Wait() and Poll() may race, and the counter must never appear to go backwards
+        uint64_t completed = m_completed.load(std::memory_order_relaxed);
+        while (completed < value && !m_completed.compare_exchange_weak(completed, value, std::memory_order_release, std::memory_order_relaxed)) {}
+    }
+} // namespace DORY
\ No newline at end of file
@@ -0,0 +1,86 @@
+#ifndef DORY_FRAME_TIMELINE_INCL
+#define DORY_FRAME_TIMELINE_INCL
+
+#include "utils/nocopy.h"
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <cstdint>
+
+namespace DORY
+{
+    class Device;
+
+    /**
+     * @brief a timeline semaphore counting the frames the device has finished. the submission of frame n
+     * signals GetSignalValue(n), so the counter is the number of frames that have finished and waiting for
+     * a frame is a wait for a value. Poll() reads the counter once per frame, after which IsFrameComplete()
+     * is a cheap check that uploads, deletions, readbacks and the like can key off instead of fences of
+     * their own.
+     */
+    class FrameTimeline : public NoCopy
+    {
+        public:
+            /**
+             * @brief create the timeline semaphore, starting at 0
+             * @param device the device to create the semaphore on
+             */
+            FrameTimeline(Device& device);
+
+            ~FrameTimeline();
+
+            /**
+             * @brief get the timeline semaphore, for submissions to signal or wait on
+             * @return VkSemaphore
+             */
+            VkSemaphore GetSemaphore() const { return m_semaphore; }
+
+            /**
+             * @brief get the value the submission of a frame signals
+             * @param frame_number the frame, see Renderer::GetFrameNumber()
+             * @return uint64_t
+             */
+            static uint64_t GetSignalValue(uint64_t frame_number) { return frame_number + 1; }
+
+            /**
+             * @brief wait until the device has finished a frame. the frame must have been submitted
+             * @param frame_number the frame, see Renderer::GetFrameNumber()
+             */
+            void Wait(uint64_t frame_number);
+
+            /**
+             * @brief read the counter of the semaphore, which IsFrameComplete() answers from until the next call
+             * @return uint64_t number of frames that have finished
+             */
+            uint64_t Poll();
+
+            /**
+             * @brief check whether a frame had finished at the last Poll() or Wait(). thread safe
+             * @param frame_number the frame, see Renderer::GetFrameNumber()
+             * @return true
+             * @return false
+             */
+            bool IsFrameComplete(uint64_t frame_number) const { return GetSignalValue(frame_number) <= m_completed.load(std::memory_order_acquire); }
+
+            /**
+             * @brief get the number of frames that had finished at the last Poll() or Wait(). thread safe
+             * @return uint64_t
+             */
+            uint64_t GetCompletedCount() const { return m_completed.load(std::memory_order_acquire); }
+
+        private: // methods
+            /**
+             * @brief raise the cached counter, which other threads may read
+             * @param value a value the semaphore has reached
+             */
+            void SetCompleted(uint64_t value);
+
+        private: // members
+            Device& m_device; // the device the semaphore is on
+            VkSemaphore m_semaphore = VK_NULL_HANDLE; // the timeline semaphore
+            std::atomic<uint64_t> m_completed{0}; // value of the semaphore at the last Poll() or Wait()
+    }; // class FrameTimeline
+} // namespace DORY
+
+#endif // DORY_FRAME_TIMELINE_INCL
\ No newline at end of file
@@ -0,0 +1,196 @@
+#include "core/logger.h"
+#include "renderer/geometry_arena.h"
+
+#include <algorithm>
+
+namespace DORY
+{
+    GeometryArena::GeometryArena(Device& device)
+        : m_device(device)
+    {
+    }
+
+    GeometryArena::Allocation GeometryArena::Allocate(uint32_t vertex_size, uint32_t vertex_count, VkIndexType index_type, uint32_t index_count)
+    {
+        Allocation allocation{};
+        allocation.vertex_count = vertex_count;
+        allocation.index_count = index_count;
+        for (uint32_t page = 0; page < m_pages.size(); page++)
+        {
+            if (m_pages[page] == nullptr) { continue; }
+            if (AllocateFromPage(page, vertex_size, index_type, allocation)) { return allocation; }
+        }
+
+        // a new page always has room, it is made large enough for the model
+        const uint32_t page = CreatePage(vertex_size, vertex_count, index_type, index_count);
+        AllocateFromPage(page, vertex_size, index_type, allocation);
+        return allocation;
+    }
+
+    void GeometryArena::Free(Allocation& allocation)
+    {
+        if (allocation.page == INVALID_PAGE) { return; }
+
+        Page& page = *m_pages[allocation.page];
+        page.vertices->Free(allocation.vertex_node);
+        if (allocation.index_node != TlsfAllocator::INVALID_NODE) { page.indices->Free(allocation.index_node); }
+        allocation = Allocation{};
+    }
+
+    bool GeometryArena::Reallocate(const Allocation& allocation, Allocation& moved)
+    {
+        const Page& source = *m_pages[allocation.page];
+        const float usage = GetPageUsage(allocation.page);
+
+        moved = Allocation{};
+        moved.vertex_count = allocation.vertex_count;
+        moved.index_count = allocation.index_count;
+        for (uint32_t page = 0; page < m_pages.size(); page++)
+        {
+            if (page == allocation.page || m_pages[page] == nullptr || GetPageUsage(page) <= usage) { continue; }
+            if (AllocateFromPage(page, source.vertex_size, source.index_type, moved)) { return true; }
+        }
+        return false;
+    }
+
+    void GeometryArena::Copy(VkCommandBuffer command_buffer, const Allocation& src, const Allocation& dst) const
+    {
+        const Page& src_page = *m_pages[src.page];
+        const Page& dst_page = *m_pages[dst.page];
+
+        VkBufferCopy vertex_region{};
+        vertex_region.srcOffset = static_cast<VkDeviceSize>(src.first_vertex) * src_page.vertex_size;
+        vertex_region.dstOffset = static_cast<VkDeviceSize>(dst.first_vertex) * dst_page.vertex_size;
+        vertex_region.size = static_cast<VkDeviceSize>(src.vertex_count) * src_page.vertex_size;
+        vkCmdCopyBuffer(command_buffer, src_page.vertex_buffer->GetBuffer(), dst_page.vertex_buffer->GetBuffer(), 1, &vertex_region);
+
+        if (src.index_count == 0) { return; }
+        const uint32_t index_size = GetIndexSize(src_page.index_type);
+        VkBufferCopy index_region{};
+        index_region.srcOffset = static_cast<VkDeviceSize>(src.first_index) * index_size;
+        index_region.dstOffset = static_cast<VkDeviceSize>(dst.first_index) * index_size;
+        index_region.size = static_cast<VkDeviceSize>(src.index_count) * index_size;
+        vkCmdCopyBuffer(command_buffer, src_page.index_buffer->GetBuffer(), dst_page.index_buffer->GetBuffer(), 1, &index_region);
+    }
+
+    VkDeviceSize GeometryArena::RelocateBuffers(VkCommandBuffer command_buffer, uint32_t page, VkDeviceSize max_bytes)
+    {
+        VkDeviceSize copied = 0;
+        for (Buffer* buffer : { m_pages[page]->vertex_buffer.get(), m_pages[page]->index_buffer.get() })
+        {
+            if (copied + buffer->GetBufferSize() > max_bytes) { continue; }
+            if (buffer->Relocate(command_buffer)) { copied += buffer->GetBufferSize(); }
+        }
+        return copied;
+    }
+
+    uint32_t GeometryArena::ReleaseEmptyPages()
+    {
+        uint32_t released = 0;
+        for (auto& page : m_pages)
+        {
+            if (page == nullptr || !page->vertices->IsEmpty() || !page->indices->IsEmpty()) { continue; }
+            page.reset();
+            released++;
+        }
+        if (released > 0) { DDEBUG("Released %u empty geometry pages", released); }
+        return released;
+    }
+
+    void GeometryArena::Bind(VkCommandBuffer command_buffer, uint32_t page) const
+    {
+        VkBuffer buffers[] = { m_pages[page]->vertex_buffer->GetBuffer() };
+        VkDeviceSize offsets[] = { 0 };
+        vkCmdBindVertexBuffers(command_buffer, 0, 1, buffers, offsets);
+        vkCmdBindIndexBuffer(command_buffer, m_pages[page]->index_buffer->GetBuffer(), 0, m_pages[page]->index_type);
+    }
+
+    GeometryArena::Stats GeometryArena::GetStats() const
+    {
+        Stats stats{};
+        stats.page_count = 0;
+        for (const auto& page : m_pages)
+        {
+            if (page == nullptr) { continue; }
+            stats.page_count++;
+            stats.allocation_count += page->vertices->GetAllocationCount();
+            stats.vertex_bytes += page->vertices->GetUsedSize() * page->vertex_size;
+            stats.index_bytes += page->indices->GetUsedSize() * GetIndexSize(page->index_type);
+            stats.reserved_bytes += page->vertex_buffer->GetBufferSize() + page->index_buffer->GetBufferSize();
+        }
+        return stats;
+    }
+
+    float GeometryArena::GetPageUsage(uint32_t page) const
+    {
+        const Page& candidate = *m_pages[page];
+        const VkDeviceSize used = candidate.vertices->GetUsedSize() * candidate.vertex_size + candidate.indices->GetUsedSize() * GetIndexSize(candidate.index_type);
+        const VkDeviceSize size = candidate.vertex_buffer->GetBufferSize() + candidate.index_buffer->GetBufferSize();
+        return static_cast<float>(used) / static_cast<float>(size);
+    }
+
+    VkDeviceSize GeometryArena::GetAllocationSize(const Allocation& allocation) const
+    {
+        const Page& page = *m_pages[allocation.page];
+        return static_cast<VkDeviceSize>(allocation.vertex_count) * page.vertex_size + static_cast<VkDeviceSize>(allocation.index_count) * GetIndexSize(page.index_type);
+    }
+
+    uint32_t GeometryArena::CreatePage(uint32_t vertex_size, uint32_t vertex_count, VkIndexType index_type, uint32_t index_count)
+    {
+        const uint32_t index_size = GetIndexSize(index_type);
+        const uint32_t vertex_capacity = static_cast<uint32_t>(std::max<VkDeviceSize>(DEFAULT_VERTEX_PAGE_SIZE / vertex_size, vertex_count));
+        const uint32_t index_capacity = static_cast<uint32_t>(std::max<VkDeviceSize>(DEFAULT_INDEX_PAGE_SIZE / index_size, index_count));
+
+        auto page = std::make_unique<Page>();
+        page->vertex_size = vertex_size;
+        page->index_type = index_type;
+        page->vertex_buffer = std::make_unique<Buffer>( m_device,
+                                                        vertex_size,
+                                                        vertex_capacity,
+                                                        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        page->index_buffer = std::make_unique<Buffer>(  m_device,
+                                                        index_size,
+                                                        index_capacity,
+                                                        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        page->vertices = std::make_unique<TlsfAllocator>(vertex_capacity);
+        page->indices = std::make_unique<TlsfAllocator>(index_capacity);
+
+        // reuse the slot of a released page if there is one
+        uint32_t index = 0;
+        while (index < m_pages.size() && m_pages[index] != nullptr) { index++; }
+        if (index == m_pages.size()) { m_pages.emplace_back(); }
+        m_pages[index] = std::move(page);
+
+        DDEBUG("Created geometry page %u: %u vertices of %u bytes, %u indices of %u bytes", index, vertex_capacity, vertex_size, index_capacity, index_size);
+        return index;
+    }
+
+    bool GeometryArena::AllocateFromPage(uint32_t page, uint32_t vertex_size, VkIndexType index_type, Allocation& allocation)
+    {
+        Page& candidate = *m_pages[page];
+        if (candidate.vertex_size != vertex_size || candidate.index_type != index_type) { return false; }
+
+        // both ranges have to come from the same page, so a page whose vertices fit but whose indices do
+        // not gives its vertex range back
+        TlsfAllocator::Allocation vertex_range{};
+        TlsfAllocator::Allocation index_range{};
+        if (!candidate.vertices->Allocate(allocation.vertex_count, 1, vertex_range)) { return false; }
+        if (allocation.index_count > 0 && !candidate.indices->Allocate(allocation.index_count, 1, index_range))
+        {
+            candidate.vertices->Free(vertex_range.node);
+            return false;
+        }
+
+        allocation.page = page;
+        allocation.first_vertex = static_cast<uint32_t>(vertex_range.offset);
+        allocation.vertex_node = vertex_range.node;
+        if (allocation.index_count > 0)
+        {
+            allocation.first_index = static_cast<uint32_t>(index_range.offset);
+            allocation.index_node = index_range.node;
+        }
+        return true;
+    }
+} // namespace DORY
\ No newline at end of file
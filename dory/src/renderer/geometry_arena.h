@@ -0,0 +1,219 @@
+#ifndef DORY_GEOMETRY_ARENA_INCL
+#define DORY_GEOMETRY_ARENA_INCL
+
+#include "renderer/buffer.h"
+#include "renderer/device.h"
+#include "utils/nocopy.h"
+#include "utils/tlsf_allocator.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace DORY
+{
+    /**
+     * @brief large device local vertex and index buffers that the geometry of every model is placed in,
+     * so that models sharing a vertex layout and index type are drawn with the same buffers bound. the
+     * buffers come in pages, each one vertex buffer and one index buffer for a single vertex size and
+     * index type; ranges are handed out from them with a TlsfAllocator counting vertices and indices, and a
+     * new page is added when none of the matching ones has room. models keep their index values relative
+     * to their first vertex and draw with vertexOffset, so 16 bit indices keep working however large the
+     * page is.
+     */
+    class GeometryArena : public NoCopy
+    {
+        public:
+            /**
+             * @brief bytes of vertices in a page, unless a single model needs more
+             */
+            static constexpr VkDeviceSize DEFAULT_VERTEX_PAGE_SIZE = VkDeviceSize{64} << 20;
+
+            /**
+             * @brief bytes of indices in a page, unless a single model needs more
+             */
+            static constexpr VkDeviceSize DEFAULT_INDEX_PAGE_SIZE = VkDeviceSize{32} << 20;
+
+            /**
+             * @brief returned as the page of an empty allocation
+             */
+            static constexpr uint32_t INVALID_PAGE = UINT32_MAX;
+
+            /**
+             * @brief the vertices and indices of one model
+             */
+            struct Allocation
+            {
+                uint32_t page = INVALID_PAGE; // page holding the ranges
+                uint32_t first_vertex = 0; // first vertex of the model within the page, passed as vertexOffset
+                uint32_t vertex_count = 0;
+                uint32_t first_index = 0; // first index of the model within the page, added to firstIndex
+                uint32_t index_count = 0;
+                uint32_t vertex_node = TlsfAllocator::INVALID_NODE; // vertex range, for Free()
+                uint32_t index_node = TlsfAllocator::INVALID_NODE; // index range, for Free()
+            };
+
+            /**
+             * @brief usage summary over all pages
+             */
+            struct Stats
+            {
+                uint32_t page_count = 0; // number of pages that have not been released
+                uint32_t allocation_count = 0; // number of live allocations
+                VkDeviceSize vertex_bytes = 0; // bytes of vertices in use
+                VkDeviceSize index_bytes = 0; // bytes of indices in use
+                VkDeviceSize reserved_bytes = 0; // bytes of all page buffers
+            };
+
+            /**
+             * @brief create an empty arena. pages are created when they are first needed
+             * @param device the device to create the buffers on
+             */
+            GeometryArena(Device& device);
+
+            /**
+             * @brief take room for the vertices and indices of a model from a page with the given layout
+             * @param vertex_size bytes per vertex
+             * @param vertex_count number of vertices
+             * @param index_type type of the indices
+             * @param index_count number of indices, 0 for models drawn without indices
+             * @return Allocation
+             */
+            Allocation Allocate(uint32_t vertex_size, uint32_t vertex_count, VkIndexType index_type, uint32_t index_count);
+
+            /**
+             * @brief return the ranges of a model to their page
+             * @param allocation the allocation to free, reset afterwards
+             */
+            void Free(Allocation& allocation);
+
+            /**
+             * @brief take ranges for the same vertices and indices as an allocation from another page with
+             * the same layout whose bytes are more used, so that moving models empties the sparse pages.
+             * no page is created, so this fails if none of them has room
+             * @param allocation the allocation to move
+             * @param moved set to the new allocation if there was room
+             * @return true if the allocation can be moved
+             */
+            bool Reallocate(const Allocation& allocation, Allocation& moved);
+
+            /**
+             * @brief record the copy of the vertices and indices of an allocation into the ranges of another
+             * one of the same size, e.g. taken by Reallocate()
+             * @param command_buffer command buffer to record the copies into, outside of a render pass
+             * @param src the allocation to copy from
+             * @param dst the allocation to copy to
+             */
+            void Copy(VkCommandBuffer command_buffer, const Allocation& src, const Allocation& dst) const;
+
+            /**
+             * @brief move the buffers of a page to fuller memory blocks, see Buffer::Relocate(). nothing may
+             * upload into the page while the copies are in flight
+             * @param command_buffer command buffer to record the copies into, outside of a render pass
+             * @param page the page
+             * @param max_bytes only buffers up to this size are moved
+             * @return VkDeviceSize number of bytes copied, 0 if no buffer was moved
+             */
+            VkDeviceSize RelocateBuffers(VkCommandBuffer command_buffer, uint32_t page, VkDeviceSize max_bytes);
+
+            /**
+             * @brief destroy the buffers of the pages that hold no model. the buffers go through the
+             * device's deletion queue, so frames in flight may still read them
+             * @return uint32_t number of pages released
+             */
+            uint32_t ReleaseEmptyPages();
+
+            /**
+             * @brief bind the vertex and index buffer of a page
+             * @param command_buffer command buffer to record the binds into
+             * @param page the page to bind
+             */
+            void Bind(VkCommandBuffer command_buffer, uint32_t page) const;
+
+            /**
+             * @brief get the vertex buffer of a page, to upload vertices into
+             * @param page the page
+             * @return VkBuffer
+             */
+            VkBuffer GetVertexBuffer(uint32_t page) const { return m_pages[page]->vertex_buffer->GetBuffer(); }
+
+            /**
+             * @brief get the index buffer of a page, to upload indices into
+             * @param page the page
+             * @return VkBuffer
+             */
+            VkBuffer GetIndexBuffer(uint32_t page) const { return m_pages[page]->index_buffer->GetBuffer(); }
+
+            /**
+             * @brief get the number of page indices, including those of released pages
+             * @return uint32_t
+             */
+            uint32_t GetPageCount() const { return static_cast<uint32_t>(m_pages.size()); }
+
+            /**
+             * @brief check whether a page index holds a page that has not been released
+             * @param page the page
+             * @return true
+             * @return false
+             */
+            bool IsPageLive(uint32_t page) const { return page < m_pages.size() && m_pages[page] != nullptr; }
+
+            /**
+             * @brief get the fraction of the bytes of a page that are in use
+             * @param page a live page
+             * @return float
+             */
+            float GetPageUsage(uint32_t page) const;
+
+            /**
+             * @brief get the number of bytes an allocation takes in its page
+             * @param allocation the allocation
+             * @return VkDeviceSize
+             */
+            VkDeviceSize GetAllocationSize(const Allocation& allocation) const;
+
+            /**
+             * @brief get the size of the indices of a type
+             * @param index_type the type
+             * @return uint32_t
+             */
+            static uint32_t GetIndexSize(VkIndexType index_type) { return index_type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t); }
+
+            /**
+             * @brief get a usage summary
+             * @return Stats
+             */
+            Stats GetStats() const;
+
+        private: // types
+            /**
+             * @brief one vertex buffer and one index buffer for a single layout
+             */
+            struct Page
+            {
+                uint32_t vertex_size = 0;
+                VkIndexType index_type = VK_INDEX_TYPE_UINT32;
+                std::unique_ptr<Buffer> vertex_buffer{};
+                std::unique_ptr<Buffer> index_buffer{};
+                std::unique_ptr<TlsfAllocator> vertices{}; // ranges of vertex_buffer, counted in vertices
+                std::unique_ptr<TlsfAllocator> indices{}; // ranges of index_buffer, counted in indices
+            };
+
+        private: // methods
+            /**
+             * @brief create a page large enough for at least the given numbers of vertices and indices
+             */
+            uint32_t CreatePage(uint32_t vertex_size, uint32_t vertex_count, VkIndexType index_type, uint32_t index_count);
+
+            /**
+             * @brief take the ranges of an allocation from a page, if the page has the right layout and room
+             */
+            bool AllocateFromPage(uint32_t page, uint32_t vertex_size, VkIndexType index_type, Allocation& allocation);
+
+        private: // members
+            Device& m_device; // the device the buffers are created on
+            std::vector<std::unique_ptr<Page>> m_pages{}; // every page, by index. released pages stay as null entries so indices stay valid
+    }; // class GeometryArena
+} // namespace DORY
+
+#endif // DORY_GEOMETRY_ARENA_INCL
\ No newline at end of file
@@ -0,0 +1,302 @@
+#include "core/logger.h"
+#include "renderer/memory_allocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace DORY
+{
+    MemoryAllocator::MemoryAllocator(VkPhysicalDevice physical_device, VkDevice device)
+        : m_device{device}
+    {
+        vkGetPhysicalDeviceMemoryProperties(physical_device, &m_memory_properties);
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physical_device, &properties);
+        m_non_coherent_atom_size = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+        m_pools.resize(2 * m_memory_properties.memoryTypeCount);
+        for (uint32_t t = 0; t < m_memory_properties.memoryTypeCount; t++)
+        {
+            const VkDeviceSize heap_size = m_memory_properties.memoryHeaps[m_memory_properties.memoryTypes[t].heapIndex].size;
+            for (uint32_t r = 0; r < 2; r++)
+            {
+                m_pools[2 * t + r].memory_type = t;
+                m_pools[2 * t + r].block_size = std::min(DEFAULT_BLOCK_SIZE, heap_size / 8);
+            }
+        }
+    }
+
+    MemoryAllocator::~MemoryAllocator()
+    {
+        for (Pool& pool : m_pools)
+        {
+            for (Block& block : pool.blocks)
+            {
+                if (block.ranges == nullptr) { continue; }
+                if (!block.ranges->IsEmpty())
+                {
+                    DWARN("%u allocations of memory type %u were not freed", block.ranges->GetAllocationCount(), pool.memory_type);
+                }
+                vkFreeMemory(m_device, block.memory, nullptr);
+            }
+        }
+        if (m_dedicated_count > 0) { DWARN("%u dedicated allocations were not freed", m_dedicated_count); }
+    }
+
+    MemoryAllocation MemoryAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceType type)
+    {
+        const uint32_t memory_type = FindMemoryType(requirements.memoryTypeBits, properties);
+        VkDeviceSize size = 0;
+        VkDeviceSize alignment = 1;
+        GetRangeRequirements(memory_type, requirements, size, alignment);
+
+        MemoryAllocation allocation{};
+        allocation.memory_type = memory_type;
+        allocation.pool = 2 * memory_type + static_cast<uint32_t>(type);
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+        Pool& pool = m_pools[allocation.pool];
+
+        if (size > pool.block_size / 2)
+        {
+            allocation.memory = AllocateDeviceMemory(memory_type, size, allocation.mapped);
+            allocation.size = size;
+            m_dedicated_bytes += size;
+            m_dedicated_count++;
+            return allocation;
+        }
+
+        // first fit over the blocks, most allocations land in the oldest blocks which keeps the newer ones
+        // empty enough to be freed
+        TlsfAllocator::Allocation range{};
+        uint32_t block_index = 0;
+        for (; block_index < pool.blocks.size(); block_index++)
+        {
+            Block& block = pool.blocks[block_index];
+            if (block.ranges != nullptr && block.ranges->Allocate(size, alignment, range)) { break; }
+        }
+
+        if (block_index == pool.blocks.size())
+        {
+            // reuse the slot of a freed block if there is one
+            block_index = 0;
+            while (block_index < pool.blocks.size() && pool.blocks[block_index].ranges != nullptr) { block_index++; }
+            if (block_index == pool.blocks.size()) { pool.blocks.emplace_back(); }
+
+            Block& block = pool.blocks[block_index];
+            block.memory = AllocateDeviceMemory(memory_type, pool.block_size, block.mapped);
+            block.ranges = std::make_unique<TlsfAllocator>(pool.block_size);
+            if (!block.ranges->Allocate(size, alignment, range))
+            {
+                // the alignment makes the range too large for a block, memory of its own is always aligned
+                FreeDeviceMemory(memory_type, pool.block_size, block.memory, block.mapped != nullptr);
+                block = Block{};
+                allocation.memory = AllocateDeviceMemory(memory_type, size, allocation.mapped);
+                allocation.size = size;
+                m_dedicated_bytes += size;
+                m_dedicated_count++;
+                return allocation;
+            }
+            DDEBUG("Allocated a %llu MB block of memory type %u", static_cast<unsigned long long>(pool.block_size >> 20), memory_type);
+        }
+
+        const Block& block = pool.blocks[block_index];
+        allocation.memory = block.memory;
+        allocation.offset = range.offset;
+        allocation.size = range.size;
+        allocation.mapped = block.mapped != nullptr ? static_cast<char*>(block.mapped) + range.offset : nullptr;
+        allocation.block = block_index;
+        allocation.node = range.node;
+        return allocation;
+    }
+
+    void MemoryAllocator::Free(MemoryAllocation& allocation)
+    {
+        if (allocation.memory == VK_NULL_HANDLE) { return; }
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (allocation.node == TlsfAllocator::INVALID_NODE)
+        {
+            FreeDeviceMemory(allocation.memory_type, allocation.size, allocation.memory, allocation.mapped != nullptr);
+            m_dedicated_bytes -= allocation.size;
+            m_dedicated_count--;
+            allocation = MemoryAllocation{};
+            return;
+        }
+
+        Pool& pool = m_pools[allocation.pool];
+        Block& block = pool.blocks[allocation.block];
+        block.ranges->Free(allocation.node);
+
+        // keep one empty block around, so that a resource that is recreated over and over does not
+        // allocate and free a block each time
+        if (block.ranges->IsEmpty() && GetLiveBlockCount(pool) > 1)
+        {
+            FreeDeviceMemory(pool.memory_type, pool.block_size, block.memory, block.mapped != nullptr);
+            block = Block{};
+        }
+        allocation = MemoryAllocation{};
+    }
+
+    bool MemoryAllocator::CanReallocate(const MemoryAllocation& allocation) const
+    {
+        if (allocation.memory == VK_NULL_HANDLE || allocation.node == TlsfAllocator::INVALID_NODE || allocation.mapped != nullptr) { return false; }
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+        const Pool& pool = m_pools[allocation.pool];
+        const VkDeviceSize used = pool.blocks[allocation.block].ranges->GetUsedSize();
+        for (uint32_t b = 0; b < pool.blocks.size(); b++)
+        {
+            const Block& block = pool.blocks[b];
+            if (b == allocation.block || block.ranges == nullptr) { continue; }
+            if (block.ranges->GetUsedSize() > used && block.ranges->GetLargestFreeRange() >= allocation.size) { return true; }
+        }
+        return false;
+    }
+
+    bool MemoryAllocator::Reallocate(const MemoryAllocation& allocation, const VkMemoryRequirements& requirements, MemoryAllocation& moved)
+    {
+        if (allocation.node == TlsfAllocator::INVALID_NODE || !(requirements.memoryTypeBits & (1u << allocation.memory_type))) { return false; }
+
+        VkDeviceSize size = 0;
+        VkDeviceSize alignment = 1;
+        GetRangeRequirements(allocation.memory_type, requirements, size, alignment);
+
+        // only blocks that are fuller than the one the allocation is in are taken, so that moves always
+        // empty the sparse blocks and two blocks never trade allocations back and forth
+        std::lock_guard<std::mutex> lock{m_mutex};
+        Pool& pool = m_pools[allocation.pool];
+        const VkDeviceSize used = pool.blocks[allocation.block].ranges->GetUsedSize();
+        for (uint32_t b = 0; b < pool.blocks.size(); b++)
+        {
+            Block& block = pool.blocks[b];
+            if (b == allocation.block || block.ranges == nullptr || block.ranges->GetUsedSize() <= used) { continue; }
+
+            TlsfAllocator::Allocation range{};
+            if (!block.ranges->Allocate(size, alignment, range)) { continue; }
+
+            moved = MemoryAllocation{};
+            moved.memory = block.memory;
+            moved.offset = range.offset;
+            moved.size = range.size;
+            moved.mapped = block.mapped != nullptr ? static_cast<char*>(block.mapped) + range.offset : nullptr;
+            moved.memory_type = allocation.memory_type;
+            moved.pool = allocation.pool;
+            moved.block = b;
+            moved.node = range.node;
+            return true;
+        }
+        return false;
+    }
+
+    bool MemoryAllocator::IsCoherent(const MemoryAllocation& allocation) const
+    {
+        return (m_memory_properties.memoryTypes[allocation.memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+    }
+
+    uint32_t MemoryAllocator::FindMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties) const
+    {
+        for (uint32_t i = 0; i < m_memory_properties.memoryTypeCount; i++)
+        {
+            if ((type_filter & (1 << i)) && (m_memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
+            {
+                return i;
+            }
+        }
+
+        throw std::runtime_error("Failed to find suitable memory type!");
+    }
+
+    MemoryAllocator::Stats MemoryAllocator::GetStats() const
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        Stats stats{};
+        stats.used_bytes = m_dedicated_bytes;
+        stats.reserved_bytes = m_dedicated_bytes;
+        stats.allocation_count = m_dedicated_count;
+        stats.dedicated_count = m_dedicated_count;
+
+        VkDeviceSize free_bytes = 0;
+        VkDeviceSize largest_free_range = 0;
+        for (const Pool& pool : m_pools)
+        {
+            for (const Block& block : pool.blocks)
+            {
+                if (block.ranges == nullptr) { continue; }
+                stats.used_bytes += block.ranges->GetUsedSize();
+                stats.reserved_bytes += block.ranges->GetSize();
+                stats.allocation_count += block.ranges->GetAllocationCount();
+                stats.block_count++;
+                free_bytes += block.ranges->GetSize() - block.ranges->GetUsedSize();
+                largest_free_range = std::max(largest_free_range, block.ranges->GetLargestFreeRange());
+            }
+        }
+
+        if (free_bytes > 0)
+        {
+            stats.fragmentation = 1.0f - static_cast<float>(largest_free_range) / static_cast<float>(free_bytes);
+        }
+        return stats;
+    }
+
+    VkDeviceSize MemoryAllocator::GetHeapUsage(uint32_t heap) const
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_heap_usage[heap];
+    }
+
+    void MemoryAllocator::GetRangeRequirements(uint32_t memory_type, const VkMemoryRequirements& requirements, VkDeviceSize& size, VkDeviceSize& alignment) const
+    {
+        const VkMemoryPropertyFlags flags = m_memory_properties.memoryTypes[memory_type].propertyFlags;
+
+        // ranges of non-coherent memory are flushed in whole atoms, so they must not share an atom with
+        // another allocation
+        alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+        size = requirements.size;
+        if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+        {
+            alignment = std::max(alignment, m_non_coherent_atom_size);
+            size = (size + m_non_coherent_atom_size - 1) / m_non_coherent_atom_size * m_non_coherent_atom_size;
+        }
+    }
+
+    VkDeviceMemory MemoryAllocator::AllocateDeviceMemory(uint32_t memory_type, VkDeviceSize size, void*& mapped)
+    {
+        VkMemoryAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        alloc_info.allocationSize = size;
+        alloc_info.memoryTypeIndex = memory_type;
+
+        VkDeviceMemory memory;
+        if (vkAllocateMemory(m_device, &alloc_info, nullptr, &memory) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to allocate device memory!");
+        }
+
+        mapped = nullptr;
+        if (m_memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        {
+            if (vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+            {
+                vkFreeMemory(m_device, memory, nullptr);
+                throw std::runtime_error("Failed to map device memory!");
+            }
+        }
+        m_heap_usage[m_memory_properties.memoryTypes[memory_type].heapIndex] += size;
+        return memory;
+    }
+
+    void MemoryAllocator::FreeDeviceMemory(uint32_t memory_type, VkDeviceSize size, VkDeviceMemory memory, bool mapped)
+    {
+        if (mapped) { vkUnmapMemory(m_device, memory); }
+        vkFreeMemory(m_device, memory, nullptr);
+        m_heap_usage[m_memory_properties.memoryTypes[memory_type].heapIndex] -= size;
+    }
+
+    uint32_t MemoryAllocator::GetLiveBlockCount(const Pool& pool)
+    {
+        return static_cast<uint32_t>(std::count_if(pool.blocks.begin(), pool.blocks.end(), [](const Block& block) { return block.ranges != nullptr; }));
+    }
+} // namespace DORY
\ No newline at end of file
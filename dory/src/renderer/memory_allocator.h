@@ -0,0 +1,208 @@
+#ifndef DORY_MEMORY_ALLOCATOR_INCL
+#define DORY_MEMORY_ALLOCATOR_INCL
+
+#include "platform/window.h"
+#include "utils/nocopy.h"
+#include "utils/tlsf_allocator.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace DORY
+{
+    /**
+     * @brief a range of device memory handed out by the MemoryAllocator. resources are bound at offset
+     * within memory, which is shared with other allocations unless the allocation is dedicated
+     */
+    struct MemoryAllocation
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE; // the memory block holding the range
+        VkDeviceSize offset = 0; // first byte of the range within memory
+        VkDeviceSize size = 0; // number of bytes of the range
+        void* mapped = nullptr; // host address of the first byte of the range, if the memory is host visible
+        uint32_t memory_type = 0; // index of the memory type of memory
+        uint32_t pool = 0; // pool the range was taken from
+        uint32_t block = 0; // block of the pool the range was taken from
+        uint32_t node = TlsfAllocator::INVALID_NODE; // range within the block, INVALID_NODE for dedicated allocations
+    };
+
+    /**
+     * @brief sub-allocates device memory, so that buffers and images do not each need their own
+     * vkAllocateMemory() call, of which drivers may only allow a few thousand. memory is allocated in large
+     * blocks for each memory type, and the ranges of a block are managed with a TlsfAllocator. buffers and
+     * optimally tiled images are kept in separate pools, so that neighbouring resources never have to be
+     * padded to bufferImageGranularity. requests larger than half a block get memory of their own. host
+     * visible blocks stay mapped for their whole lifetime. thread safe.
+     */
+    class MemoryAllocator : public NoCopy
+    {
+        public:
+            /**
+             * @brief default size of a memory block, smaller heaps use an eighth of the heap instead
+             */
+            static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = VkDeviceSize{64} << 20;
+
+            /**
+             * @brief kind of resource an allocation is for
+             */
+            enum class ResourceType
+            {
+                Linear, // buffers and linearly tiled images
+                Optimal // optimally tiled images
+            };
+
+            /**
+             * @brief usage summary over all memory types
+             */
+            struct Stats
+            {
+                VkDeviceSize used_bytes = 0; // bytes in allocated ranges, including dedicated allocations
+                VkDeviceSize reserved_bytes = 0; // bytes allocated from the device, including dedicated allocations
+                uint32_t allocation_count = 0; // number of live allocations
+                uint32_t block_count = 0; // number of shared memory blocks
+                uint32_t dedicated_count = 0; // number of dedicated allocations
+                float fragmentation = 0.0f; // 1 - largest free range / free bytes, over the shared blocks
+            };
+
+            /**
+             * @brief create an allocator for a device. nothing is allocated until the first request
+             * @param physical_device the physical device, for its memory types and limits
+             * @param device the logical device to allocate from
+             */
+            MemoryAllocator(VkPhysicalDevice physical_device, VkDevice device);
+
+            /**
+             * @brief free the memory blocks. every allocation must have been freed
+             */
+            ~MemoryAllocator();
+
+            /**
+             * @brief allocate memory for a resource. throws if the device is out of memory
+             * @param requirements the memory requirements of the resource
+             * @param properties properties the memory type needs to have
+             * @param type kind of resource the memory is for
+             * @return MemoryAllocation
+             */
+            MemoryAllocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceType type);
+
+            /**
+             * @brief return an allocation to its block, freeing the block if it is no longer needed
+             * @param allocation the allocation to free, reset afterwards
+             */
+            void Free(MemoryAllocation& allocation);
+
+            /**
+             * @brief check whether Reallocate() may find room for an allocation. false for dedicated
+             * allocations and host visible memory, whose mapped addresses must not change
+             * @param allocation the allocation to check
+             * @return true
+             * @return false
+             */
+            bool CanReallocate(const MemoryAllocation& allocation) const;
+
+            /**
+             * @brief take a new range for a resource that is being moved out of a sparsely used block, from a
+             * block of the same pool that has more bytes in use. nothing is allocated from the device, so
+             * this fails rather than create a block. the old allocation stays valid until it is freed
+             * @param allocation the allocation to move
+             * @param requirements the memory requirements of the resource that will be bound to the new range
+             * @param moved set to the new allocation if there was room
+             * @return true if the allocation can be moved
+             */
+            bool Reallocate(const MemoryAllocation& allocation, const VkMemoryRequirements& requirements, MemoryAllocation& moved);
+
+            /**
+             * @brief check whether the memory type of an allocation needs explicit flushes and invalidations
+             * @param allocation the allocation to check
+             * @return true
+             * @return false
+             */
+            bool IsCoherent(const MemoryAllocation& allocation) const;
+
+            /**
+             * @brief get the alignment of ranges passed to vkFlushMappedMemoryRanges() and
+             * vkInvalidateMappedMemoryRanges()
+             * @return VkDeviceSize
+             */
+            VkDeviceSize GetNonCoherentAtomSize() const { return m_non_coherent_atom_size; }
+
+            /**
+             * @brief find a memory type allowed by a filter that has all the given properties
+             * @param type_filter bit i is set if memory type i is allowed
+             * @param properties properties the memory type needs to have
+             * @return uint32_t
+             */
+            uint32_t FindMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties) const;
+
+            /**
+             * @brief get a usage summary
+             * @return Stats
+             */
+            Stats GetStats() const;
+
+            /**
+             * @brief get the number of bytes allocated from the device in a memory heap, including blocks
+             * that are partly free
+             * @param heap index of the memory heap
+             * @return VkDeviceSize
+             */
+            VkDeviceSize GetHeapUsage(uint32_t heap) const;
+
+        private: // types
+            /**
+             * @brief a memory block shared by many allocations
+             */
+            struct Block
+            {
+                VkDeviceMemory memory = VK_NULL_HANDLE;
+                void* mapped = nullptr; // host address of the block, if the memory type is host visible
+                std::unique_ptr<TlsfAllocator> ranges{}; // null once the block has been freed
+            };
+
+            /**
+             * @brief the blocks of one memory type for one kind of resource
+             */
+            struct Pool
+            {
+                uint32_t memory_type = 0;
+                VkDeviceSize block_size = 0;
+                std::vector<Block> blocks{}; // freed blocks stay as empty entries so block indices stay valid
+            };
+
+        private: // methods
+            /**
+             * @brief get the size and alignment of the range a resource needs in a memory type
+             */
+            void GetRangeRequirements(uint32_t memory_type, const VkMemoryRequirements& requirements, VkDeviceSize& size, VkDeviceSize& alignment) const;
+
+            /**
+             * @brief allocate device memory and map it if it is host visible. throws on failure
+             */
+            VkDeviceMemory AllocateDeviceMemory(uint32_t memory_type, VkDeviceSize size, void*& mapped);
+
+            /**
+             * @brief unmap and free device memory allocated by AllocateDeviceMemory()
+             */
+            void FreeDeviceMemory(uint32_t memory_type, VkDeviceSize size, VkDeviceMemory memory, bool mapped);
+
+            /**
+             * @brief get the number of blocks that have not been freed
+             */
+            static uint32_t GetLiveBlockCount(const Pool& pool);
+
+        private: // members
+            VkDevice m_device;
+            VkPhysicalDeviceMemoryProperties m_memory_properties{};
+            VkDeviceSize m_non_coherent_atom_size = 1;
+
+            mutable std::mutex m_mutex{}; // guards everything below
+            std::vector<Pool> m_pools{}; // pool for memory type t and resource type r at 2 * t + r
+            VkDeviceSize m_dedicated_bytes = 0; // bytes in dedicated allocations
+            uint32_t m_dedicated_count = 0; // number of dedicated allocations
+            VkDeviceSize m_heap_usage[VK_MAX_MEMORY_HEAPS]{}; // bytes allocated from the device, by heap
+    }; // class MemoryAllocator
+} // namespace DORY
+
+#endif // DORY_MEMORY_ALLOCATOR_INCL
\ No newline at end of file
@@ -1,142 +1,346 @@
 #include "core/logger.h"
+#include "geometry/mesh_optimizer.h"
+#include "geometry/mesh_simplifier.h"
+#include "geometry/meshlet_builder.h"
 #include "loaders/object_loader.h"
 #include "renderer/model.h"
 
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
 #include <cassert>
+#include <cmath>
 #include <cstring>
 
 namespace DORY
 {
-    Model::Model(Device &device, const Mesh& mesh)
-        : m_device(device)
+    static_assert(sizeof(Model::CompactVertex) == 20, "CompactVertex should not be padded");
+
+    /**
+     * @brief encode a unit vector with the octahedral mapping, as two snorm16 values
+     */
+    static uint32_t EncodeOctahedral(const glm::vec3& normal)
+    {
+        const float length = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+        if (length == 0.0f) { return glm::packSnorm2x16(glm::vec2{0.0f}); }
+
+        glm::vec2 encoded = glm::vec2{normal.x, normal.y} / length;
+        if (normal.z < 0.0f)
+        {
+            // fold the lower hemisphere over the diagonals of the square
+            const glm::vec2 sign{encoded.x >= 0.0f ? 1.0f : -1.0f, encoded.y >= 0.0f ? 1.0f : -1.0f};
+            encoded = (1.0f - glm::abs(glm::vec2{encoded.y, encoded.x})) * sign;
+        }
+        return glm::packSnorm2x16(encoded);
+    }
+
+    Model::Model(Device &device, const Mesh& mesh, VertexFormat format, UploadContext* upload_context, bool evictable)
+        : m_device(device), m_vertex_format(format), m_evictable(evictable)
     {
-        CreateVertexBuffers(mesh.vertices);
+        m_vertex_count = static_cast<uint32_t>(mesh.vertices.size());
+        assert(m_vertex_count >= 3 && "Model must have at least 3 vertices");
         m_index_count = static_cast<uint32_t>(mesh.indices.size());
         m_has_indices = m_index_count > 0;
+
+        // indices are range checked when the mesh is built, so they all fit in 16 bits if the vertex count
+        // does. 0xFFFF is left unused since it is the primitive restart value
+        m_index_type = m_vertex_count <= UINT16_MAX ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+        m_geometry = m_device.GetGeometryArena().Allocate(GetVertexSize(m_vertex_format), m_vertex_count, m_index_type, m_index_count);
+
+        CreateVertexBuffers(mesh.vertices, upload_context);
         if (m_has_indices)
         {
-            CreateIndexBuffers(mesh.indices);
+            CreateIndexBuffers(mesh.indices, upload_context);
+        }
+
+        m_lods = mesh.lods;
+        if (m_lods.empty()) { m_lods.push_back({0, m_index_count, 0.0f, 0, static_cast<uint32_t>(mesh.meshlets.size())}); }
+        m_meshlets = mesh.meshlets;
+
+        glm::vec3 min = mesh.vertices[0].a_position;
+        glm::vec3 max = mesh.vertices[0].a_position;
+        for (const auto& vertex : mesh.vertices)
+        {
+            min = glm::min(min, vertex.a_position);
+            max = glm::max(max, vertex.a_position);
+        }
+        m_bounding_sphere.center = (min + max) * 0.5f;
+        for (const auto& vertex : mesh.vertices)
+        {
+            m_bounding_sphere.radius = glm::max(m_bounding_sphere.radius, glm::length(vertex.a_position - m_bounding_sphere.center));
         }
     }
 
     Model::~Model()
     {
+        // frames in flight may still draw the model, its range must not be handed out before they finish
+        m_device.GetDeletionQueue().Push([&arena = m_device.GetGeometryArena(), geometry = m_geometry]() mutable { arena.Free(geometry); });
     }
 
     std::unique_ptr<Model> Model::LoadModelFromFile(Device &device, const std::string& path)
+    {
+        return LoadModelFromFile(device, path, LoadOptions{});
+    }
+
+    std::unique_ptr<Model> Model::LoadModelFromFile(Device &device, const std::string& path, const LoadOptions& options, UploadContext* upload_context)
     {
         Mesh mesh{};
-        ObjectLoader::Load(mesh, path);
+        LoadMeshFromFile(mesh, path, options);
+        return std::make_unique<Model>(device, mesh, options.vertex_format, upload_context, options.evictable);
+    }
+
+    void Model::LoadMeshFromFile(Mesh& mesh, const std::string& path, const LoadOptions& options)
+    {
+        ObjectLoader::Load(mesh, path, true, options.memory_limit);
         DINFO("Loaded model from file: %s", path.c_str());
         DINFO("Model has %d vertices and %d indices", mesh.vertices.size(), mesh.indices.size());
-        return std::make_unique<Model>(device, mesh);
+
+        if (options.optimize)
+        {
+            MeshOptimizer::Stats stats = MeshOptimizer::Optimize(mesh);
+            DINFO("Optimized model: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", stats.before.acmr, stats.after.acmr, stats.before.atvr, stats.after.atvr);
+        }
+
+        if (options.lod_count > 1)
+        {
+            MeshSimplifier::BuildLods(mesh, options.lod_count);
+            for (size_t i = 1; i < mesh.lods.size(); i++)
+            {
+                DINFO("LOD %zu: %u triangles, error %.5f", i, mesh.lods[i].index_count / 3, mesh.lods[i].error);
+            }
+        }
+
+        if (options.meshlets)
+        {
+            MeshletBuilder::Stats stats = MeshletBuilder::Build(mesh);
+            DINFO("Built %u meshlets: %.1f vertices and %.1f triangles on average, %u can be back-face culled", stats.meshlet_count, stats.average_vertices, stats.average_triangles, stats.cone_count);
+        }
     }
 
-    void Model::CreateVertexBuffers(const std::vector<Vertex> &vertices)
+    uint32_t Model::GetVertexSize(VertexFormat format)
     {
-        m_vertex_count = static_cast<uint32_t>(vertices.size());
-        assert(m_vertex_count >= 3 && "Model must have at least 3 vertices");
-        VkDeviceSize buffer_size = sizeof(vertices[0]) * m_vertex_count;
-        uint32_t vertex_size = sizeof(vertices[0]);
+        return format == VertexFormat::Standard ? sizeof(Vertex) : sizeof(CompactVertex);
+    }
 
-        // stage the vertex data to the device local memory for faster access
-        // note: this is declared on the stack and will be destroyed when the function returns
-        Buffer staging_buffer(  m_device,
-                                vertex_size, 
-                                m_vertex_count, 
-                                VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    void Model::CreateVertexBuffers(const std::vector<Vertex> &vertices, UploadContext* upload_context)
+    {
+        VkDeviceSize buffer_size = static_cast<VkDeviceSize>(GetVertexSize(m_vertex_format)) * m_vertex_count;
 
-        // take data from host CPU and copy it to the stageing buffer on GPU
-        staging_buffer.Map();
-        staging_buffer.WriteToBuffer((void*)vertices.data());
+        std::vector<CompactVertex> compact_vertices{};
+        const void* vertex_data = vertices.data();
+        if (m_vertex_format != VertexFormat::Standard)
+        {
+            compact_vertices = EncodeCompactVertices(vertices);
+            vertex_data = compact_vertices.data();
+        }
+
+        if (m_evictable)
+        {
+            const uint8_t* bytes = static_cast<const uint8_t*>(vertex_data);
+            m_host_vertices.assign(bytes, bytes + buffer_size);
+        }
+        UploadVertices(vertex_data, upload_context);
+    }
 
-        m_vertex_buffer = std::make_unique<Buffer>( m_device, 
-                                                    vertex_size, 
-                                                    m_vertex_count, 
-                                                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, 
-                                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    std::vector<Model::CompactVertex> Model::EncodeCompactVertices(const std::vector<Vertex> &vertices)
+    {
+        // quantized positions are stored relative to the bounds, flat axes get a unit extent so that
+        // nothing is divided by zero
+        glm::vec3 min = vertices[0].a_position;
+        glm::vec3 max = vertices[0].a_position;
+        for (const auto& vertex : vertices)
+        {
+            min = glm::min(min, vertex.a_position);
+            max = glm::max(max, vertex.a_position);
+        }
+        glm::vec3 extent = max - min;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (extent[axis] <= 0.0f) { extent[axis] = 1.0f; }
+        }
 
-        // copy the data from the staging buffer to the vertex buffer
-        m_device.CopyBuffer(staging_buffer.GetBuffer(), m_vertex_buffer->GetBuffer(), buffer_size);
+        const bool quantized = m_vertex_format == VertexFormat::Quantized;
+        if (quantized)
+        {
+            m_dequantization_matrix = glm::scale(glm::translate(glm::mat4{1.0f}, min), extent);
+        }
+
+        std::vector<CompactVertex> encoded(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            const Vertex& vertex = vertices[i];
+            CompactVertex& out = encoded[i];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                out.a_position[axis] = quantized ? glm::packUnorm1x16((vertex.a_position[axis] - min[axis]) / extent[axis])
+                                                 : glm::packHalf1x16(vertex.a_position[axis]);
+            }
+            out.a_position[3] = quantized ? glm::packUnorm1x16(1.0f) : glm::packHalf1x16(1.0f);
+            out.a_normal = EncodeOctahedral(vertex.a_normal);
+            out.a_color = glm::packUnorm4x8(glm::vec4{vertex.a_color, 1.0f});
+            out.a_tex_coords = glm::packHalf2x16(vertex.a_tex_coords);
+        }
+        return encoded;
     }
 
-    void Model::CreateIndexBuffers(const std::vector<uint32_t> &indices)
+    void Model::CreateIndexBuffers(const std::vector<uint32_t> &indices, UploadContext* upload_context)
     {
-        VkDeviceSize buffer_size = sizeof(indices[0]) * m_index_count;
-        uint32_t index_size = sizeof(indices[0]);
+        std::vector<uint16_t> short_indices{};
+        const void* index_data = indices.data();
+        if (m_index_type == VK_INDEX_TYPE_UINT16)
+        {
+            short_indices.assign(indices.begin(), indices.end());
+            index_data = short_indices.data();
+        }
+        if (m_evictable)
+        {
+            const uint8_t* bytes = static_cast<const uint8_t*>(index_data);
+            m_host_indices.assign(bytes, bytes + static_cast<size_t>(GeometryArena::GetIndexSize(m_index_type)) * m_index_count);
+        }
+        UploadIndices(index_data, upload_context);
+    }
 
-        // stage the index data to the device local memory for faster access
-        Buffer staging_buffer(  m_device,
-                                index_size, 
-                                m_index_count, 
-                                VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    void Model::UploadVertices(const void* data, UploadContext* upload_context)
+    {
+        // stage the vertex data and copy it to the device local memory for faster access
+        const uint32_t vertex_size = GetVertexSize(m_vertex_format);
+        const GeometryArena& arena = m_device.GetGeometryArena();
+        Upload(data, static_cast<VkDeviceSize>(vertex_size) * m_vertex_count, arena.GetVertexBuffer(m_geometry.page), static_cast<VkDeviceSize>(vertex_size) * m_geometry.first_vertex, upload_context);
+    }
 
-        // take data from host CPU and copy it to the stageing buffer on GPU
-        staging_buffer.Map();
-        staging_buffer.WriteToBuffer((void*)indices.data());
+    void Model::UploadIndices(const void* data, UploadContext* upload_context)
+    {
+        // stage the index data and copy it to the device local memory for faster access
+        const uint32_t index_size = GeometryArena::GetIndexSize(m_index_type);
+        const GeometryArena& arena = m_device.GetGeometryArena();
+        Upload(data, static_cast<VkDeviceSize>(index_size) * m_index_count, arena.GetIndexBuffer(m_geometry.page), static_cast<VkDeviceSize>(index_size) * m_geometry.first_index, upload_context);
+    }
+
+    void Model::Evict()
+    {
+        assert(m_evictable && "Only evictable models can be evicted");
+        m_device.GetDeletionQueue().Push([&arena = m_device.GetGeometryArena(), geometry = m_geometry]() mutable { arena.Free(geometry); });
+        m_geometry = GeometryArena::Allocation{};
+    }
 
-        m_index_buffer = std::make_unique<Buffer>(  m_device, 
-                                                    index_size, 
-                                                    m_index_count, 
-                                                    VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, 
-                                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    void Model::MakeResident(UploadContext* upload_context)
+    {
+        if (IsResident()) { return; }
 
-        // copy the data from the staging buffer to the index buffer
-        m_device.CopyBuffer(staging_buffer.GetBuffer(), m_index_buffer->GetBuffer(), buffer_size);
+        m_geometry = m_device.GetGeometryArena().Allocate(GetVertexSize(m_vertex_format), m_vertex_count, m_index_type, m_index_count);
+        UploadVertices(m_host_vertices.data(), upload_context);
+        if (m_has_indices) { UploadIndices(m_host_indices.data(), upload_context); }
     }
 
-    void Model::Bind(VkCommandBuffer command_buffer)
+    void Model::MoveGeometry(VkCommandBuffer command_buffer, GeometryArena::Allocation& destination, uint64_t frame_number)
     {
-        VkBuffer buffers[] = { m_vertex_buffer->GetBuffer() };
-        VkDeviceSize offsets[] = { 0 };
-        vkCmdBindVertexBuffers(command_buffer, 0, 1, buffers, offsets);
+        MarkUsed(frame_number);
+        GeometryArena& arena = m_device.GetGeometryArena();
+        arena.Copy(command_buffer, m_geometry, destination);
 
-        if (m_has_indices)
+        // the old ranges are the source of the copies, and frames in flight may still draw from them
+        m_device.GetDeletionQueue().Push([&arena, geometry = m_geometry]() mutable { arena.Free(geometry); });
+        m_geometry = destination;
+        destination = GeometryArena::Allocation{};
+    }
+
+    VkDeviceSize Model::GetGeometrySize() const
+    {
+        return static_cast<VkDeviceSize>(GetVertexSize(m_vertex_format)) * m_vertex_count + static_cast<VkDeviceSize>(GeometryArena::GetIndexSize(m_index_type)) * m_index_count;
+    }
+
+    void Model::Upload(const void* data, VkDeviceSize size, VkBuffer dst_buffer, VkDeviceSize dst_offset, UploadContext* upload_context)
+    {
+        if (upload_context == nullptr)
         {
-            vkCmdBindIndexBuffer(command_buffer, m_index_buffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
+            // note: the staging buffer is destroyed once the copy has finished
+            Buffer staging_buffer{  m_device,
+                                    size,
+                                    1,
+                                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+            staging_buffer.Map();
+            staging_buffer.WriteToBuffer(const_cast<void*>(data));
+            m_device.CopyBuffer(staging_buffer.GetBuffer(), dst_buffer, size, dst_offset);
+            return;
         }
+
+        // a full staging ring may submit the batch between the vertex and index copies, but batches
+        // finish in order, so the batch of the last copy covers both
+        m_upload_batch = upload_context->CopyBuffer(data, size, dst_buffer, dst_offset);
+    }
+
+    void Model::Bind(VkCommandBuffer command_buffer)
+    {
+        m_device.GetGeometryArena().Bind(command_buffer, m_geometry.page);
+    }
+
+    void Model::Draw(VkCommandBuffer command_buffer, uint32_t lod)
+    {
+        if (m_has_indices) { DrawRange(command_buffer, m_lods[lod].first_index, m_lods[lod].index_count); }
+        else { vkCmdDraw(command_buffer, m_vertex_count, 1, m_geometry.first_vertex, 0); }
     }
 
-    void Model::Draw(VkCommandBuffer command_buffer)
+    void Model::DrawRange(VkCommandBuffer command_buffer, uint32_t first_index, uint32_t index_count)
     {
-        if (m_has_indices) { vkCmdDrawIndexed(command_buffer, m_index_count, 1, 0, 0, 0); }
-        else { vkCmdDraw(command_buffer, m_vertex_count, 1, 0, 0); }
+        // the indices are relative to the first vertex of the model, which vertexOffset moves to its place in the page
+        vkCmdDrawIndexed(command_buffer, index_count, 1, m_geometry.first_index + first_index, static_cast<int32_t>(m_geometry.first_vertex), 0);
     }
 
-    std::vector<VkVertexInputBindingDescription> Model::Vertex::GetBindingDescriptions()
+    void Model::Mesh::ComputeBounds()
+    {
+        bounds = Bounds{};
+        if (vertices.empty()) { return; }
+
+        bounds.min = vertices[0].a_position;
+        bounds.max = vertices[0].a_position;
+        for (const auto& vertex : vertices)
+        {
+            bounds.min = glm::min(bounds.min, vertex.a_position);
+            bounds.max = glm::max(bounds.max, vertex.a_position);
+        }
+    }
+
+    std::vector<VkVertexInputBindingDescription> Model::Vertex::GetBindingDescriptions(VertexFormat format)
     {
         std::vector<VkVertexInputBindingDescription> binding_descriptions(1);
         binding_descriptions[0].binding = 0;
-        binding_descriptions[0].stride = sizeof(Vertex);
+        binding_descriptions[0].stride = GetVertexSize(format);
         binding_descriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
         return binding_descriptions;
     }
 
-    std::vector<VkVertexInputAttributeDescription> Model::Vertex::GetAttributeDescriptions()
+    std::vector<VkVertexInputAttributeDescription> Model::Vertex::GetAttributeDescriptions(VertexFormat format)
     {
         std::vector<VkVertexInputAttributeDescription> attribute_descriptions(4);
-        attribute_descriptions[0].binding = 0;
-        attribute_descriptions[0].location = 0;
-        attribute_descriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attribute_descriptions[0].offset = offsetof(Vertex, a_position);
-
-        attribute_descriptions[1].binding = 0;
-        attribute_descriptions[1].location = 1;
-        attribute_descriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attribute_descriptions[1].offset = offsetof(Vertex, a_color);
-
-        attribute_descriptions[2].binding = 0;
-        attribute_descriptions[2].location = 2;
-        attribute_descriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attribute_descriptions[2].offset = offsetof(Vertex, a_normal);
-
-        attribute_descriptions[3].binding = 0;
-        attribute_descriptions[3].location = 3;
-        attribute_descriptions[3].format = VK_FORMAT_R32G32_SFLOAT;
-        attribute_descriptions[3].offset = offsetof(Vertex, a_tex_coords);
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            attribute_descriptions[i].binding = 0;
+            attribute_descriptions[i].location = i;
+        }
+
+        if (format == VertexFormat::Standard)
+        {
+            attribute_descriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+            attribute_descriptions[0].offset = offsetof(Vertex, a_position);
+            attribute_descriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+            attribute_descriptions[1].offset = offsetof(Vertex, a_color);
+            attribute_descriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
+            attribute_descriptions[2].offset = offsetof(Vertex, a_normal);
+            attribute_descriptions[3].format = VK_FORMAT_R32G32_SFLOAT;
+            attribute_descriptions[3].offset = offsetof(Vertex, a_tex_coords);
+            return attribute_descriptions;
+        }
 
+        // compact formats are read by compact.vert, which decodes the octahedral normal itself
+        attribute_descriptions[0].format = format == VertexFormat::Quantized ? VK_FORMAT_R16G16B16A16_UNORM : VK_FORMAT_R16G16B16A16_SFLOAT;
+        attribute_descriptions[0].offset = offsetof(CompactVertex, a_position);
+        attribute_descriptions[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+        attribute_descriptions[1].offset = offsetof(CompactVertex, a_color);
+        attribute_descriptions[2].format = VK_FORMAT_R16G16_SNORM;
+        attribute_descriptions[2].offset = offsetof(CompactVertex, a_normal);
+        attribute_descriptions[3].format = VK_FORMAT_R16G16_SFLOAT;
+        attribute_descriptions[3].offset = offsetof(CompactVertex, a_tex_coords);
         return attribute_descriptions;
     }
 } // namespace DORY
\ No newline at end of file
@@ -3,6 +3,8 @@
 
 #include "renderer/device.h"
 #include "renderer/buffer.h"
+#include "renderer/geometry_arena.h"
+#include "renderer/upload_context.h"
 #include "utils/nocopy.h"
 
 #define GLM_FORCE_RADIANS
@@ -18,6 +20,18 @@ namespace DORY
     {
         public:
 
+            /**
+             * @brief layout of the vertices of a model in its vertex buffer. meshes are always built with
+             * Vertex, the format only decides how they are encoded when they are uploaded
+             */
+            enum class VertexFormat : uint32_t
+            {
+                Standard = 0, // Vertex as is, 44 bytes
+                Compact, // CompactVertex with a half float position, 20 bytes
+                Quantized, // CompactVertex with a 16 bit position inside the bounds of the mesh, 20 bytes
+                Count
+            };
+
             /**
              * @brief struct describing a vertex and its attributes
              */
@@ -30,17 +44,18 @@ namespace DORY
 
                 /**
                  * @brief get the binding descriptions of the vertex
-                 * 
+                 * @param format (optional) the layout of the vertex buffer
                  * @return std::vector<VkVertexInputBindingDescription> 
                  */
-                static std::vector<VkVertexInputBindingDescription> GetBindingDescriptions();
+                static std::vector<VkVertexInputBindingDescription> GetBindingDescriptions(VertexFormat format = VertexFormat::Standard);
 
                 /**
-                 * @brief get the attribute descriptions of the vertex
-                 * 
+                 * @brief get the attribute descriptions of the vertex. the locations are the same for every
+                 * format, only the formats of the attributes change
+                 * @param format (optional) the layout of the vertex buffer
                  * @return std::vector<VkVertexInputAttributeDescription> 
                  */
-                static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions();
+                static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions(VertexFormat format = VertexFormat::Standard);
 
                 bool operator==(const Vertex &other) const
                 {
@@ -51,13 +66,90 @@ namespace DORY
                 }
             };
 
+            /**
+             * @brief a vertex encoded for VertexFormat::Compact or VertexFormat::Quantized
+             */
+            struct CompactVertex
+            {
+                uint16_t a_position[4]; // half floats, or unorm16 inside the mesh bounds. the 4th component is padding
+                uint32_t a_normal; // octahedral encoding, 2 x snorm16
+                uint32_t a_color; // 4 x unorm8, alpha is always 1
+                uint32_t a_tex_coords; // 2 x half float
+            };
+
+            /**
+             * @brief axis aligned bounding box of a mesh in model space
+             */
+            struct Bounds
+            {
+                glm::vec3 min{0.0f};
+                glm::vec3 max{0.0f};
+            };
+
+            /**
+             * @brief sphere enclosing a mesh in model space
+             */
+            struct BoundingSphere
+            {
+                glm::vec3 center{0.0f};
+                float radius = 0.0f;
+            };
+
             /**
              * @brief the data for a single mesh
              */
             struct Mesh
             {
+                /**
+                 * @brief range of indices holding one level of detail
+                 */
+                struct Lod
+                {
+                    uint32_t first_index = 0; // first index of the level in indices
+                    uint32_t index_count = 0; // number of indices of the level
+                    float error = 0.0f; // how far the level deviates from the full mesh, in model space units
+                    uint32_t first_meshlet = 0; // first meshlet of the level in meshlets
+                    uint32_t meshlet_count = 0; // number of meshlets of the level, 0 if the mesh has none
+                };
+
+                /**
+                 * @brief small cluster of triangles that is culled as a whole. its triangles are a
+                 * contiguous range of indices, so visible neighbours can be drawn with a single call
+                 */
+                struct Meshlet
+                {
+                    uint32_t first_index = 0; // first index of the meshlet in indices
+                    uint32_t triangle_count = 0; // number of triangles in the meshlet
+                    uint32_t vertex_count = 0; // number of distinct vertices the triangles use
+                    glm::vec3 center{0.0f}; // centre of the sphere enclosing the triangles
+                    float radius = 0.0f; // radius of the sphere enclosing the triangles
+                    glm::vec3 cone_axis{0.0f}; // average direction the triangles face
+                    float cone_cutoff = -1.0f; // cosine of the largest angle between cone_axis and a triangle normal. 0 or less if the triangles face every way
+                };
+
                 std::vector<Vertex> vertices{};
                 std::vector<uint32_t> indices{};
+                Bounds bounds{};
+                std::vector<Lod> lods{}; // levels of detail from finest to coarsest. empty if indices hold a single level
+                std::vector<Meshlet> meshlets{}; // meshlets of every level, in index order. empty if none were built
+
+                /**
+                 * @brief recompute the bounds from the vertex positions
+                 */
+                void ComputeBounds();
+            };
+
+            /**
+             * @brief options for loading a model from a file
+             */
+            struct LoadOptions
+            {
+                bool optimize = false; // reorder triangles and vertices for the GPU (see MeshOptimizer)
+                VertexFormat vertex_format = VertexFormat::Standard; // how the vertices are stored on the GPU
+                uint32_t lod_count = 1; // number of levels of detail to build, including the full mesh (see MeshSimplifier)
+                bool meshlets = false; // split every level into meshlets that can be culled on their own (see MeshletBuilder). only for closed meshes, since back-facing meshlets are dropped
+                size_t memory_limit = 0; // if not 0, .obj files are streamed and loading fails rather than use more bytes than this (see ObjectLoader::LoadObjStreaming)
+                bool evictable = false; // keep a host copy of the geometry so that the model can be evicted from device memory (see ResidencyManager)
             };
             
             /**
@@ -65,8 +157,12 @@ namespace DORY
              * 
              * @param device device to create the model on
              * @param data a struct containing the vertices and indices of the model
+             * @param format (optional) how to store the vertices on the GPU
+             * @param upload_context (optional) records the uploads instead of waiting for them. the model
+             * cannot be drawn until the batch returned by GetUploadBatch() has completed
+             * @param evictable (optional) keep a host copy of the geometry, see Evict()
              */
-            Model(Device &device, const Model::Mesh& data);
+            Model(Device &device, const Model::Mesh& data, VertexFormat format = VertexFormat::Standard, UploadContext* upload_context = nullptr, bool evictable = false);
 
             /**
              * @brief destroy the Model object
@@ -77,36 +173,238 @@ namespace DORY
              * @brief load a model from a file
              * @param device device to create the model on
              * @param path path to the model file
+             * @param options how to process the mesh after loading it
+             * @param upload_context (optional) records the uploads instead of waiting for them, see Model()
+             * @return std::unique_ptr<Model> 
+             */
+            static std::unique_ptr<Model> LoadModelFromFile(Device &device, const std::string& path, const LoadOptions& options, UploadContext* upload_context = nullptr);
+
+            /**
+             * @brief load and process a mesh the same way LoadModelFromFile() does, without creating
+             * any GPU resources. safe to call from any thread
+             * @param mesh the mesh to fill
+             * @param path path to the model file
+             * @param options how to process the mesh after loading it
+             */
+            static void LoadMeshFromFile(Mesh& mesh, const std::string& path, const LoadOptions& options);
+
+            /**
+             * @brief load a model from a file with the default options
+             * @param device device to create the model on
+             * @param path path to the model file
              * @return std::unique_ptr<Model> 
              */
             static std::unique_ptr<Model> LoadModelFromFile(Device &device, const std::string& path);
 
+            /**
+             * @brief bind the vertex and index buffers of the arena page holding the model. models on the
+             * same page only need to be bound once, see GetGeometryPage()
+             * @param command_buffer command buffer to record the binds into
+             */
             void Bind(VkCommandBuffer command_buffer);
-            void Draw(VkCommandBuffer command_buffer);
+
+            /**
+             * @brief get the page of the geometry arena holding the vertices and indices of the model
+             * @return uint32_t
+             */
+            uint32_t GetGeometryPage() const { return m_geometry.page; }
+
+            /**
+             * @brief get where the vertices and indices of the model are in the geometry arena
+             * @return const GeometryArena::Allocation&
+             */
+            const GeometryArena::Allocation& GetGeometry() const { return m_geometry; }
+
+            /**
+             * @brief move the vertices and indices of the model to other ranges of the geometry arena, e.g.
+             * taken by GeometryArena::Reallocate(). the copies are recorded into a command buffer that is
+             * submitted before any draw of the model recorded from now on, and the old ranges are freed
+             * through the deletion queue. the upload of the model must have completed
+             * @param command_buffer command buffer to record the copies into, outside of a render pass
+             * @param destination the new ranges, reset afterwards
+             * @param frame_number the frame the copies are recorded in, which the model is marked as used by
+             * so that it is not evicted while they may still write to the new ranges
+             */
+            void MoveGeometry(VkCommandBuffer command_buffer, GeometryArena::Allocation& destination, uint64_t frame_number);
+
+            /**
+             * @brief draw one level of detail of the model
+             * @param command_buffer command buffer to record the draw into
+             * @param lod (optional) the level to draw, 0 is the full mesh
+             */
+            void Draw(VkCommandBuffer command_buffer, uint32_t lod = 0);
+
+            /**
+             * @brief draw a range of indices, e.g. a run of visible meshlets
+             * @param command_buffer command buffer to record the draw into
+             * @param first_index first index to draw, relative to the first index of the model
+             * @param index_count number of indices to draw
+             */
+            void DrawRange(VkCommandBuffer command_buffer, uint32_t first_index, uint32_t index_count);
+
+            /**
+             * @brief get the number of levels of detail
+             * @return uint32_t at least 1
+             */
+            uint32_t GetLodCount() const { return static_cast<uint32_t>(m_lods.size()); }
+
+            /**
+             * @brief get the index range and error of a level of detail
+             * @param lod the level, 0 is the full mesh
+             * @return const Mesh::Lod&
+             */
+            const Mesh::Lod& GetLod(uint32_t lod) const { return m_lods[lod]; }
+
+            /**
+             * @brief get the sphere enclosing the model in model space
+             * @return const BoundingSphere&
+             */
+            const BoundingSphere& GetBoundingSphere() const { return m_bounding_sphere; }
+
+            /**
+             * @brief get the meshlets of every level of detail. the meshlets of a level are given by the
+             * first_meshlet and meshlet_count of GetLod()
+             * @return const std::vector<Mesh::Meshlet>& empty if the model was built without meshlets
+             */
+            const std::vector<Mesh::Meshlet>& GetMeshlets() const { return m_meshlets; }
+
+            /**
+             * @brief get the size in bytes of a single vertex in a given format
+             * @param format the vertex format
+             * @return uint32_t
+             */
+            static uint32_t GetVertexSize(VertexFormat format);
+
+            /**
+             * @brief get the format the vertices are stored in
+             * @return VertexFormat
+             */
+            VertexFormat GetVertexFormat() const { return m_vertex_format; }
+
+            /**
+             * @brief get the matrix that maps the stored vertex positions back to model space. this is the
+             * identity except for VertexFormat::Quantized, and has to be applied before the model matrix
+             * @return const glm::mat4&
+             */
+            const glm::mat4& GetDequantizationMatrix() const { return m_dequantization_matrix; }
+
+            /**
+             * @brief get the upload batch the buffers of the model were recorded in
+             * @return uint64_t 0 if the model was uploaded synchronously
+             */
+            uint64_t GetUploadBatch() const { return m_upload_batch; }
+
+            /**
+             * @brief check whether the model keeps a host copy of its geometry and can be evicted
+             * @return true 
+             * @return false 
+             */
+            bool IsEvictable() const { return m_evictable; }
+
+            /**
+             * @brief check whether the geometry of the model is in device memory. evicted models must not
+             * be bound or drawn
+             * @return true 
+             * @return false 
+             */
+            bool IsResident() const { return m_geometry.page != GeometryArena::INVALID_PAGE; }
+
+            /**
+             * @brief give the range of the model in the geometry arena back, keeping everything else. only
+             * for evictable models. the range is freed through the deletion queue, since frames in flight
+             * may still read or write it
+             */
+            void Evict();
+
+            /**
+             * @brief upload the geometry of an evicted model again from its host copy
+             * @param upload_context context to record the upload in, or nullptr to upload synchronously
+             */
+            void MakeResident(UploadContext* upload_context);
+
+            /**
+             * @brief get the number of bytes the model takes in the geometry arena while it is resident
+             * @return VkDeviceSize
+             */
+            VkDeviceSize GetGeometrySize() const;
+
+            /**
+             * @brief record that the model was wanted for a frame, whether or not it was resident
+             * @param frame_number the frame, see Renderer::GetFrameNumber()
+             */
+            void MarkUsed(uint64_t frame_number) { m_last_used_frame = frame_number; }
+
+            /**
+             * @brief get the last frame passed to MarkUsed()
+             * @return uint64_t
+             */
+            uint64_t GetLastUsedFrame() const { return m_last_used_frame; }
 
         private: // methods
             /**
-             * @brief create the vertex buffer and its memory
+             * @brief upload the vertices into the model's range of the geometry arena
              * 
-             * @param vertices list of vertices to create the buffer from
+             * @param vertices list of vertices to upload
+             * @param upload_context context to record the upload in, or nullptr to upload synchronously
+             */
+            void CreateVertexBuffers(const std::vector<Vertex> &vertices, UploadContext* upload_context);
+
+            /**
+             * @brief encode vertices for VertexFormat::Compact or VertexFormat::Quantized. for the latter
+             * this also sets the dequantization matrix
+             * @param vertices list of vertices to encode
+             * @return std::vector<CompactVertex>
              */
-            void CreateVertexBuffers(const std::vector<Vertex> &vertices);
+            std::vector<CompactVertex> EncodeCompactVertices(const std::vector<Vertex> &vertices);
 
             /**
-             * @brief create the index buffer and its memory
+             * @brief upload the indices into the model's range of the geometry arena, as m_index_type
              * 
-             * @param vertices list of vertices to create the buffer from
+             * @param indices list of indices to upload
+             * @param upload_context context to record the upload in, or nullptr to upload synchronously
+             */
+            void CreateIndexBuffers(const std::vector<uint32_t> &indices, UploadContext* upload_context);
+
+            /**
+             * @brief copy encoded vertices into the model's range of the geometry arena
              */
-            void CreateIndexBuffers(const std::vector<uint32_t> &indices);
+            void UploadVertices(const void* data, UploadContext* upload_context);
+
+            /**
+             * @brief copy encoded indices into the model's range of the geometry arena
+             */
+            void UploadIndices(const void* data, UploadContext* upload_context);
+
+            /**
+             * @brief stage data and copy it into a device buffer
+             * @param data the data to copy
+             * @param size number of bytes to copy
+             * @param dst_buffer the buffer to copy to
+             * @param dst_offset byte offset within dst_buffer
+             * @param upload_context context to record the copy in, or nullptr to copy synchronously through
+             * a temporary staging buffer
+             */
+            void Upload(const void* data, VkDeviceSize size, VkBuffer dst_buffer, VkDeviceSize dst_offset, UploadContext* upload_context);
 
         private: // members
             Device &m_device; // device to create the model on
-            std::unique_ptr<Buffer> m_vertex_buffer; // vertex buffer
+            GeometryArena::Allocation m_geometry{}; // where the vertices and indices are in the geometry arena
             uint32_t m_vertex_count; // number of vertices in the buffer
+            VertexFormat m_vertex_format = VertexFormat::Standard; // layout of the vertex buffer
+            glm::mat4 m_dequantization_matrix{1.0f}; // maps stored positions to model space
 
-            std::unique_ptr<Buffer> m_index_buffer; // index buffer
             uint32_t m_index_count; // number of indices in the buffer
+            VkIndexType m_index_type = VK_INDEX_TYPE_UINT32; // type of the indices in the buffer
             bool m_has_indices = false; // whether the model has index buffer
+            std::vector<Mesh::Lod> m_lods{}; // index ranges of the levels of detail
+            std::vector<Mesh::Meshlet> m_meshlets{}; // meshlets of the levels of detail, kept on the CPU for culling
+            BoundingSphere m_bounding_sphere{}; // sphere enclosing the model in model space
+            uint64_t m_upload_batch = 0; // upload batch of the buffers, 0 if they were uploaded synchronously
+
+            bool m_evictable = false; // see IsEvictable()
+            std::vector<uint8_t> m_host_vertices{}; // encoded vertices, kept by evictable models to restore them
+            std::vector<uint8_t> m_host_indices{}; // encoded indices, kept by evictable models to restore them
+            uint64_t m_last_used_frame = 0; // see MarkUsed()
             
     }; // class Model
 } // namespace DORY
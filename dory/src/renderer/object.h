@@ -32,6 +32,23 @@ namespace DORY
              */
             uint32_t GetObjectId() const { return m_id; }
 
+            /**
+             * @brief copy the object, keeping its id. used for the snapshots of the scene that the render
+             * thread draws while the objects themselves are updated
+             * @param alpha (optional) how far the transform of the copy is from previous_transform to
+             * transform, see FixedTimestep::GetAlpha()
+             * @return Object
+             */
+            Object Clone(float alpha = 1.0f) const
+            {
+                Object object{m_id};
+                object.m_model = m_model;
+                object.m_color = m_color;
+                object.transform = TransformObject::Interpolate(previous_transform, transform, alpha);
+                object.previous_transform = object.transform;
+                return object;
+            }
+
             // for some reason inheriting from NoCopy doesn't work here, so delete the copy constructor and assignment operator
             Object(Object const&) = delete;
             Object& operator=(Object const&) = delete;
@@ -42,6 +59,7 @@ namespace DORY
             std::shared_ptr<Model> m_model{};
             glm::vec3 m_color{};
             TransformObject transform{};
+            TransformObject previous_transform{}; // transform at the previous simulation step, to interpolate from
 
         private: // methods
             // private constructor to ensure objects created with CreateObject() have unqiue ids
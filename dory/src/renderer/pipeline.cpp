@@ -10,9 +10,13 @@ namespace DORY
 
     Pipeline::~Pipeline()
     {
-        vkDestroyShaderModule(m_device.GetDevice(), m_vert_shader_module, nullptr);
-        vkDestroyShaderModule(m_device.GetDevice(), m_frag_shader_module, nullptr);
-        vkDestroyPipeline(m_device.GetDevice(), m_graphics_pipeline, nullptr);
+        // frames in flight may still use the pipeline, so it can be replaced at runtime without a stall
+        m_device.GetDeletionQueue().Push([&device = m_device, vert = m_vert_shader_module, frag = m_frag_shader_module, pipeline = m_graphics_pipeline]()
+        {
+            vkDestroyShaderModule(device.GetDevice(), vert, nullptr);
+            vkDestroyShaderModule(device.GetDevice(), frag, nullptr);
+            vkDestroyPipeline(device.GetDevice(), pipeline, nullptr);
+        });
     }
 
     void Pipeline::Bind(VkCommandBuffer command_buffer)
@@ -1,13 +1,39 @@
 #include "renderer/renderer.h"
+#include "core/job_system.h"
+
+#include <algorithm>
 #include <array>
 
 namespace DORY
 {
-    Renderer::Renderer(Window& window, Device& device)
-        : m_window{window}, m_device{device}
+    namespace
+    {
+        /**
+         * @brief clamp the settings to what the renderer supports
+         */
+        RendererConfig ClampConfig(RendererConfig config)
+        {
+            config.frames_in_flight = std::clamp<uint32_t>(config.frames_in_flight, 1, SwapChain::MAX_FRAMES_IN_FLIGHT);
+            return config;
+        }
+
+        /**
+         * @brief frames in a row that adaptive vsync waits for before switching modes, so that a single
+         * slow frame does not recreate the swap chain
+         */
+        constexpr uint32_t PRESENT_MODE_SWITCH_FRAMES = 30;
+    } // namespace
+
+    Renderer::Renderer(Window& window, Device& device, const RendererConfig& config)
+        : m_window{window}, m_device{device}, m_config{ClampConfig(config)}, m_present_mode{m_config.present_mode}
     {
+        const int refresh_rate = m_window.GetRefreshRate();
+        m_refresh_interval = refresh_rate > 0 ? 1.0f / static_cast<float>(refresh_rate) : 0.0f;
+
         RecreateSwapChain();
         CreateCommandBuffers();
+        m_frame_allocator = std::make_unique<FrameAllocator>(m_device, m_config.frames_in_flight);
+        m_secondary_pools = std::make_unique<SecondaryCommandPools>(m_device, JobSystem::Get().GetThreadCount(), m_config.frames_in_flight);
     }
     
     Renderer::~Renderer()
@@ -17,7 +43,7 @@ namespace DORY
 
     void Renderer::CreateCommandBuffers()
     {
-        m_command_buffer.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+        m_command_buffer.resize(m_config.frames_in_flight);
 
         // initialize the command buffer info struct
         VkCommandBufferAllocateInfo alloc_info{};
@@ -41,26 +67,30 @@ namespace DORY
 
     void Renderer::RecreateSwapChain()
     {
+        // a minimized window has no size. the application waits for events on the main thread meanwhile,
+        // and BeginFrame() tries again
         auto extent = m_window.GetExtent();
-        while (extent.width == 0 || extent.height == 0)
-        {
-            extent = m_window.GetExtent();
-            glfwWaitEvents();
-        }
+        m_swap_chain_outdated = extent.width == 0 || extent.height == 0;
+        if (m_swap_chain_outdated) { return; }
 
-        vkDeviceWaitIdle(m_device.GetDevice());
+        // no need to wait for the device, the old swap chain is destroyed through the deletion queue and
+        // the frames in flight are waited for through the device's FrameTimeline
 
         // if no swap chain, then create a new one
         if (m_swap_chain == nullptr)
         {
-            m_swap_chain = std::make_unique<SwapChain>(m_device, extent);
+            RendererConfig swap_chain_config = m_config;
+            swap_chain_config.present_mode = m_present_mode;
+            m_swap_chain = std::make_unique<SwapChain>(m_device, extent, swap_chain_config);
         }
         else // there is an existing swap chain
         {
             // save the old swap chain
             std::shared_ptr<SwapChain> old_swap_chain = std::move(m_swap_chain);
             // make a new one with new extent
-            m_swap_chain = std::make_unique<SwapChain>(m_device, extent, old_swap_chain);
+            RendererConfig swap_chain_config = m_config;
+            swap_chain_config.present_mode = m_present_mode;
+            m_swap_chain = std::make_unique<SwapChain>(m_device, extent, swap_chain_config, old_swap_chain);
             // check that the formats are the same
             if (!old_swap_chain->CompareFormats(*m_swap_chain.get()))
             {
@@ -71,11 +101,87 @@ namespace DORY
         //CreatePipeline();
     }
 
+    void Renderer::SetConfig(const RendererConfig& config)
+    {
+        std::lock_guard<std::mutex> lock(m_config_mutex);
+        m_pending_config = ClampConfig(config);
+        m_config_changed = true;
+    }
+
+    void Renderer::ApplyConfig()
+    {
+        const uint32_t frames_in_flight = m_config.frames_in_flight;
+        {
+            std::lock_guard<std::mutex> lock(m_config_mutex);
+            m_config = m_pending_config;
+            m_config_changed = false;
+        }
+        m_present_mode = m_config.present_mode;
+        m_present_mode_frames = 0;
+
+        // the per frame resources are replaced, so every frame submitted with them has to finish first.
+        // changing the settings is rare enough to wait. a new image count or present mode only needs a new
+        // swap chain
+        if (m_config.frames_in_flight != frames_in_flight)
+        {
+            if (m_frame_number > 0) { m_device.GetFrameTimeline().Wait(m_frame_number - 1); }
+
+            FreeCommandBuffers();
+            CreateCommandBuffers();
+            m_frame_allocator = std::make_unique<FrameAllocator>(m_device, m_config.frames_in_flight);
+            m_secondary_pools = std::make_unique<SecondaryCommandPools>(m_device, JobSystem::Get().GetThreadCount(), m_config.frames_in_flight);
+            m_current_frame_index = 0;
+            m_resource_generation++;
+        }
+        RecreateSwapChain();
+        DINFO("Renderer: %u frames in flight, %u swap chain images requested", m_config.frames_in_flight, m_config.image_count);
+    }
+
+    void Renderer::UpdatePresentMode()
+    {
+        const auto now = std::chrono::steady_clock::now();
+        const float frame_time = std::chrono::duration<float>(now - m_last_frame_start).count();
+        m_last_frame_start = now;
+        if (!m_config.adaptive_vsync || m_refresh_interval <= 0.0f || m_swap_chain_outdated) { return; }
+
+        // FIFO_RELAXED only tears the frames that miss their refresh. IMMEDIATE would tear all of them and
+        // lift the frame cap, so without FIFO_RELAXED the swap chain stays on FIFO
+        if (!m_swap_chain->IsPresentModeSupported(VK_PRESENT_MODE_FIFO_RELAXED_KHR)) { return; }
+
+        const bool relaxed = m_present_mode != m_config.present_mode;
+        if (!relaxed && m_swap_chain->GetPresentMode() != VK_PRESENT_MODE_FIFO_KHR) { return; }
+
+        // a frame that misses its refresh under FIFO waits for the next one, so a slow stretch shows up as
+        // frames of two refreshes. once relaxed, frames that fit take a single refresh again
+        m_average_frame_time += 0.1f * (std::min(frame_time, 1.0f) - m_average_frame_time);
+        const bool switch_mode = relaxed ? m_average_frame_time < 1.05f * m_refresh_interval : m_average_frame_time > 1.2f * m_refresh_interval;
+        m_present_mode_frames = switch_mode ? m_present_mode_frames + 1 : 0;
+        if (m_present_mode_frames < PRESENT_MODE_SWITCH_FRAMES) { return; }
+
+        m_present_mode_frames = 0;
+        m_present_mode = relaxed ? m_config.present_mode : VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+        RecreateSwapChain();
+    }
+
     VkCommandBuffer Renderer::BeginFrame()
     {
         DASSERT_MSG(!m_frame_in_progress, "Can't begin frame when frame is in progress.");
 
-        auto result = m_swap_chain->AcquireNextImage(&m_current_image_index);
+        if (m_config_changed.load()) { ApplyConfig(); }
+        UpdatePresentMode();
+        if (m_swap_chain_outdated)
+        {
+            RecreateSwapChain();
+            if (m_swap_chain_outdated) { return nullptr; }
+        }
+
+        auto result = m_swap_chain->AcquireNextImage(m_frame_number, &m_current_image_index);
+
+        // AcquireNextImage() waited for the frame that last used this frame's slot, and any frame the
+        // device has finished since can be collected as well
+        const uint64_t completed = m_device.GetFrameTimeline().Poll();
+        if (completed > 0) { m_device.GetDeletionQueue().Collect(completed - 1); }
+
         if (result == VK_ERROR_OUT_OF_DATE_KHR)
         {
             RecreateSwapChain();
@@ -88,6 +194,11 @@ namespace DORY
         }
 
         m_frame_in_progress = true;
+        m_device.GetDeletionQueue().SetFrame(m_frame_number);
+
+        // AcquireNextImage() waited for the frame that last used this slot, so the device is done with its region
+        m_frame_allocator->Reset(m_current_frame_index);
+        m_secondary_pools->Reset(m_current_frame_index);
 
         auto command_buffer = GetCurrentCommandBuffer();
         VkCommandBufferBeginInfo begin_info{};
@@ -104,6 +215,8 @@ namespace DORY
     {
         DASSERT_MSG(m_frame_in_progress, "Can't end frame when a frame is in not progress.");
 
+        m_frame_allocator->Flush();
+
         auto command_buffer = GetCurrentCommandBuffer();
         if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
         {
@@ -122,10 +235,11 @@ namespace DORY
         }
 
         m_frame_in_progress = false;
-        m_current_frame_index = (m_current_frame_index + 1) % SwapChain::MAX_FRAMES_IN_FLIGHT;
+        m_current_frame_index = (m_current_frame_index + 1) % m_config.frames_in_flight;
+        m_frame_number++;
     }
 
-    void Renderer::BeginSwapChainRenderPass(VkCommandBuffer command_buffer)
+    void Renderer::BeginSwapChainRenderPass(VkCommandBuffer command_buffer, VkSubpassContents contents)
     {
         DASSERT_MSG(m_frame_in_progress, "Can't begin render pass when a frame is in not progress.");
         DASSERT_MSG(command_buffer == GetCurrentCommandBuffer(), "Can't begin render pass with invalid command buffer.");
@@ -147,7 +261,14 @@ namespace DORY
         render_pass_info.pClearValues = clear_values.data();
 
         // record the above actions to the command buffer, begin render pass and bind the graphics pipeline
-        vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(command_buffer, &render_pass_info, contents);
+
+        // secondary command buffers set their own viewport and scissor, see SecondaryCommandPools::Begin()
+        if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)
+        {
+            m_secondary_pools->SetRenderPass(render_pass_info.renderPass, render_pass_info.framebuffer, render_pass_info.renderArea.extent);
+            return;
+        }
 
         // specify the viewport and scissor rectangles
         VkViewport viewport{};
@@ -4,10 +4,16 @@
 #include "core/core.h"
 #include "platform/window.h"
 #include "renderer/device.h"
+#include "renderer/frame_allocator.h"
+#include "renderer/frame_timeline.h"
+#include "renderer/renderer_config.h"
+#include "renderer/secondary_command_pools.h"
 #include "renderer/swapchain.h"
 #include "utils/nocopy.h"
 
-
+#include <atomic>
+#include <chrono>
+#include <mutex>
 
 namespace DORY
 {
@@ -20,8 +26,11 @@ namespace DORY
         public:
             /**
              * @brief construct a new Renderer object
+             * @param window the window to render to
+             * @param device the device to render with
+             * @param config (optional) initial settings, see SetConfig()
              */
-            Renderer(Window& window, Device& device);
+            Renderer(Window& window, Device& device, const RendererConfig& config = RendererConfig{});
 
             /**
              * @brief destroy the Renderer object
@@ -69,6 +78,63 @@ namespace DORY
                 return m_current_frame_index;
             }
 
+            /**
+             * @brief get the number of frames submitted so far, which is also the number of the frame
+             * being recorded. unlike the frame index it never wraps around
+             * @return uint64_t
+             */
+            uint64_t GetFrameNumber() const { return m_frame_number; }
+
+            /**
+             * @brief check whether the device had finished a frame when the current one began. thread safe
+             * @param frame_number the frame, see GetFrameNumber()
+             * @return true
+             * @return false
+             */
+            bool IsFrameComplete(uint64_t frame_number) const { return m_device.GetFrameTimeline().IsFrameComplete(frame_number); }
+
+            /**
+             * @brief get the settings the renderer currently runs with
+             * @return const RendererConfig&
+             */
+            const RendererConfig& GetConfig() const { return m_config; }
+
+            /**
+             * @brief change the settings. they are applied by the next BeginFrame(), which waits for the
+             * device and recreates the swap chain, command buffers, frame allocator and secondary command
+             * pools. may be called from any thread. values out of range are clamped
+             * @param config the new settings
+             */
+            void SetConfig(const RendererConfig& config);
+
+            /**
+             * @brief get the present mode the swap chain currently uses, which differs from the one asked for
+             * when the surface does not support it or adaptive vsync has switched from FIFO to FIFO_RELAXED
+             * @return VkPresentModeKHR
+             */
+            VkPresentModeKHR GetPresentMode() const { return m_swap_chain->GetPresentMode(); }
+
+            /**
+             * @brief get a number that changes whenever the per frame resources have been recreated, after
+             * which descriptor sets referring to GetFrameAllocator() must be written again
+             * @return uint32_t
+             */
+            uint32_t GetResourceGeneration() const { return m_resource_generation; }
+
+            /**
+             * @brief get the allocator for data written once per frame. it is reset to the region of the
+             * current frame in BeginFrame() and flushed in EndFrame()
+             * @return FrameAllocator&
+             */
+            FrameAllocator& GetFrameAllocator() { return *m_frame_allocator; }
+
+            /**
+             * @brief get the pools that render passes begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+             * are recorded from. the current frame's pools are reset in BeginFrame()
+             * @return SecondaryCommandPools&
+             */
+            SecondaryCommandPools& GetSecondaryCommandPools() { return *m_secondary_pools; }
+
             /**
              * @brief begin the current frame and command buffer for the current image
              * @return VkCommandBuffer 
@@ -83,8 +149,10 @@ namespace DORY
             /**
              * @brief begin the render pass for the current frame
              * @param command_buffer 
+             * @param contents (optional) VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS to record the render pass
+             * into command buffers from GetSecondaryCommandPools(), which are then the only commands allowed in it
              */
-            void BeginSwapChainRenderPass(VkCommandBuffer command_buffer);
+            void BeginSwapChainRenderPass(VkCommandBuffer command_buffer, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 
             /**
              * @brief end the render pass for the current frame
@@ -107,18 +175,45 @@ namespace DORY
             void FreeCommandBuffers();
 
             /**
-             * @brief recreate the swap chain if the window is resized
+             * @brief recreate the swap chain if the window is resized. while the window is minimized the
+             * swap chain is left as it is and m_swap_chain_outdated is set, so that the render thread never
+             * blocks on window events
              */
             void RecreateSwapChain();
 
+            /**
+             * @brief switch to the settings given to SetConfig() and recreate everything sized by them
+             */
+            void ApplyConfig();
+
+            /**
+             * @brief adaptive vsync. measure the time between frames and, while presenting with FIFO, move to
+             * FIFO_RELAXED once frames take longer than a refresh, and back once they fit. off by default
+             */
+            void UpdatePresentMode();
+
         private: // members
             Window& m_window; // the window to render to
             Device& m_device; // the device to render with
             std::unique_ptr<SwapChain> m_swap_chain; // the renderer's swap chain
             std::vector<VkCommandBuffer> m_command_buffer; // renderer's command buffers
+            std::unique_ptr<FrameAllocator> m_frame_allocator{}; // per frame uniform and dynamic data
+            std::unique_ptr<SecondaryCommandPools> m_secondary_pools{}; // per thread and per frame pools for recording render passes in parallel
             uint32_t m_current_image_index; // index of the current image in the swap chain
+            bool m_swap_chain_outdated = false; // the swap chain could not be recreated yet, see RecreateSwapChain()
             bool m_frame_in_progress = false; // check whether a frame is in progress
             uint32_t m_current_frame_index = 0; // current frame number
+            uint64_t m_frame_number = 0; // see GetFrameNumber()
+            RendererConfig m_config{}; // see GetConfig()
+            RendererConfig m_pending_config{}; // settings given to SetConfig() and not yet applied
+            std::mutex m_config_mutex{}; // guards m_pending_config
+            std::atomic<bool> m_config_changed{false}; // set by SetConfig(), cleared once the settings are applied
+            uint32_t m_resource_generation = 0; // see GetResourceGeneration()
+            VkPresentModeKHR m_present_mode; // mode the swap chain is asked for, the configured one unless adaptive vsync replaced it
+            float m_refresh_interval = 0.0f; // seconds between refreshes of the display, 0 if unknown
+            std::chrono::steady_clock::time_point m_last_frame_start{}; // when BeginFrame() was last called
+            float m_average_frame_time = 0.0f; // moving average of the time between frames, in seconds
+            uint32_t m_present_mode_frames = 0; // consecutive frames that asked adaptive vsync to switch modes
     }; // class Renderer
 } // namespace DORY
 
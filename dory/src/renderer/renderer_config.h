@@ -0,0 +1,29 @@
+#ifndef DORY_RENDERER_CONFIG_INCL
+#define DORY_RENDERER_CONFIG_INCL
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+namespace DORY
+{
+    /**
+     * @brief settings of the renderer that can be changed while the application runs, see
+     * Renderer::SetConfig(). more frames in flight and swap chain images let the CPU get further ahead of
+     * the GPU and absorb stalls, at the cost of latency between input and the image it shows up in.
+     *
+     * the present mode decides how frames reach the display: VK_PRESENT_MODE_FIFO_KHR is strict vsync,
+     * VK_PRESENT_MODE_FIFO_RELAXED_KHR tears only frames that missed their refresh, VK_PRESENT_MODE_MAILBOX_KHR
+     * shows the newest frame at each refresh without tearing, and VK_PRESENT_MODE_IMMEDIATE_KHR is uncapped,
+     * e.g. for benchmarks. a mode the surface does not support falls back along SwapChain::ChooseSwapPresentMode()
+     */
+    struct RendererConfig
+    {
+        uint32_t frames_in_flight = 2; // frames recorded before waiting on the GPU, 1 to SwapChain::MAX_FRAMES_IN_FLIGHT
+        uint32_t image_count = 0; // swap chain images to ask for, 0 for one more than the surface needs. clamped to what the surface supports
+        VkPresentModeKHR present_mode = VK_PRESENT_MODE_MAILBOX_KHR; // present mode to ask for
+        bool adaptive_vsync = false; // while presenting with FIFO, switch to FIFO_RELAXED when frames take longer than a refresh. needs FIFO_RELAXED
+    }; // struct RendererConfig
+} // namespace DORY
+
+#endif // DORY_RENDERER_CONFIG_INCL
\ No newline at end of file
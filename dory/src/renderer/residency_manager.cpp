@@ -0,0 +1,122 @@
+#include "core/logger.h"
+#include "renderer/frame_timeline.h"
+#include "renderer/geometry_arena.h"
+#include "renderer/residency_manager.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace DORY
+{
+    ResidencyManager::ResidencyManager(Device& device, UploadContext& upload_context)
+        : m_device(device), m_upload_context(upload_context)
+    {
+    }
+
+    void ResidencyManager::Register(const std::shared_ptr<Model>& model)
+    {
+        assert(model->IsEvictable() && "Only evictable models can be managed");
+        Entry entry{};
+        entry.model = model;
+        m_entries.push_back(entry);
+    }
+
+    VkDeviceSize ResidencyManager::GetBudget()
+    {
+        if (m_budget != 0) { return m_budget; }
+
+        VkDeviceSize budget = 0;
+        VkDeviceSize usage = 0;
+        for (const MemoryHeapBudget& heap : m_device.GetMemoryBudget())
+        {
+            if (!heap._device_local) { continue; }
+            budget += heap._budget;
+            usage += heap._usage;
+        }
+
+        // only the geometry can be evicted, so everything else is taken off the budget first
+        const VkDeviceSize geometry = m_device.GetGeometryArena().GetStats().reserved_bytes;
+        const VkDeviceSize other = usage > geometry ? usage - geometry : 0;
+        return budget > other ? budget - other : 0;
+    }
+
+    void ResidencyManager::Update(uint64_t frame_number)
+    {
+        m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(), [](const Entry& entry) { return entry.model.expired(); }), m_entries.end());
+
+        // models wanted since their eviction are uploaded again, and handed to the graphics queue right
+        // away so that the next frame can draw them
+        bool restored = false;
+        for (Entry& entry : m_entries)
+        {
+            std::shared_ptr<Model> model = entry.model.lock();
+            if (model->IsResident() || model->GetLastUsedFrame() < entry.evicted_frame) { continue; }
+            model->MakeResident(&m_upload_context);
+            m_stats.restores++;
+            restored = true;
+        }
+        if (restored)
+        {
+            m_upload_context.Submit();
+            m_upload_context.Acquire();
+        }
+
+        // a model can be evicted once the last frame that drew it has finished
+        const FrameTimeline& timeline = m_device.GetFrameTimeline();
+        std::vector<Entry*> candidates;
+        m_stats.budget = GetBudget();
+        m_stats.resident_bytes = 0;
+        m_stats.resident_count = 0;
+        m_stats.evicted_count = 0;
+        for (Entry& entry : m_entries)
+        {
+            std::shared_ptr<Model> model = entry.model.lock();
+            if (!model->IsResident())
+            {
+                m_stats.evicted_count++;
+                continue;
+            }
+
+            m_stats.resident_bytes += model->GetGeometrySize();
+            m_stats.resident_count++;
+            if (timeline.IsFrameComplete(model->GetLastUsedFrame()) && m_upload_context.IsComplete(model->GetUploadBatch()))
+            {
+                candidates.push_back(&entry);
+            }
+        }
+        if (m_stats.resident_bytes <= m_stats.budget)
+        {
+            m_over_budget = false;
+            return;
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [](const Entry* a, const Entry* b)
+        {
+            return a->model.lock()->GetLastUsedFrame() < b->model.lock()->GetLastUsedFrame();
+        });
+        uint32_t evicted = 0;
+        for (size_t i = 0; i < candidates.size() && m_stats.resident_bytes > m_stats.budget; i++)
+        {
+            std::shared_ptr<Model> model = candidates[i]->model.lock();
+            m_stats.resident_bytes -= model->GetGeometrySize();
+            m_stats.resident_count--;
+            m_stats.evicted_count++;
+            model->Evict();
+            candidates[i]->evicted_frame = frame_number;
+            evicted++;
+        }
+        m_stats.evictions += evicted;
+        if (evicted > 0)
+        {
+            m_device.GetGeometryArena().ReleaseEmptyPages();
+            DDEBUG("Evicted %u models, %llu of %llu bytes of geometry resident", evicted, (unsigned long long)m_stats.resident_bytes, (unsigned long long)m_stats.budget);
+        }
+
+        const bool over_budget = m_stats.resident_bytes > m_stats.budget;
+        if (over_budget && !m_over_budget)
+        {
+            DWARN("Models in use need %llu bytes of geometry, over the budget of %llu bytes", (unsigned long long)m_stats.resident_bytes, (unsigned long long)m_stats.budget);
+        }
+        m_over_budget = over_budget;
+    }
+} // namespace DORY
\ No newline at end of file
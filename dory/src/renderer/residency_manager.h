@@ -0,0 +1,96 @@
+#ifndef DORY_RESIDENCY_MANAGER_INCL
+#define DORY_RESIDENCY_MANAGER_INCL
+
+#include "renderer/device.h"
+#include "renderer/model.h"
+#include "renderer/upload_context.h"
+#include "utils/nocopy.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace DORY
+{
+    /**
+     * @brief keeps the geometry of evictable models within a device memory budget. the renderer marks the
+     * models it wants every frame with Model::MarkUsed(), and Update() evicts the least recently used
+     * ones while the resident geometry is over budget, then uploads the evicted models that were wanted
+     * again from their host copies. a model is only evicted once every frame that may have drawn it has
+     * finished, so models wanted by the frames in flight stay resident even over budget.
+     */
+    class ResidencyManager : public NoCopy
+    {
+        public:
+            /**
+             * @brief counters and the state after the last Update()
+             */
+            struct Stats
+            {
+                VkDeviceSize budget = 0; // bytes of geometry allowed to be resident
+                VkDeviceSize resident_bytes = 0; // bytes of geometry of the resident models
+                uint32_t resident_count = 0; // number of resident models
+                uint32_t evicted_count = 0; // number of evicted models
+                uint64_t evictions = 0; // number of times a model was evicted
+                uint64_t restores = 0; // number of times an evicted model was uploaded again
+            };
+
+            /**
+             * @brief create a manager without models
+             * @param device the device the models are on
+             * @param upload_context context to upload restored models with
+             */
+            ResidencyManager(Device& device, UploadContext& upload_context);
+
+            /**
+             * @brief start managing a model. the manager does not keep it alive
+             * @param model an evictable model
+             */
+            void Register(const std::shared_ptr<Model>& model);
+
+            /**
+             * @brief set the number of bytes of model geometry that may be resident
+             * @param budget bytes, or 0 to use what the device memory budget leaves after everything else
+             */
+            void SetBudget(VkDeviceSize budget) { m_budget = budget; }
+
+            /**
+             * @brief get the budget in effect, see SetBudget()
+             * @return VkDeviceSize
+             */
+            VkDeviceSize GetBudget();
+
+            /**
+             * @brief evict and restore models. call once per frame before recording it, from the thread that
+             * submits to the graphics queue. restored models can be drawn by the frame recorded next
+             * @param frame_number the frame about to be recorded, see Renderer::GetFrameNumber()
+             */
+            void Update(uint64_t frame_number);
+
+            /**
+             * @brief get the counters and the state after the last Update()
+             * @return const Stats&
+             */
+            const Stats& GetStats() const { return m_stats; }
+
+        private: // types
+            /**
+             * @brief a managed model
+             */
+            struct Entry
+            {
+                std::weak_ptr<Model> model{}; // the model, expired once its last user released it
+                uint64_t evicted_frame = 0; // frame the model was last evicted in
+            };
+
+        private: // members
+            Device& m_device; // the device the models are on
+            UploadContext& m_upload_context; // uploads restored models
+            VkDeviceSize m_budget = 0; // see SetBudget()
+            std::vector<Entry> m_entries{}; // the managed models
+            bool m_over_budget = false; // whether the last Update() could not get under budget, to warn once
+            Stats m_stats{}; // see GetStats()
+    }; // class ResidencyManager
+} // namespace DORY
+
+#endif // DORY_RESIDENCY_MANAGER_INCL
\ No newline at end of file
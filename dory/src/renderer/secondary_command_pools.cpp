@@ -0,0 +1,98 @@
+#include "renderer/secondary_command_pools.h"
+
+#include <stdexcept>
+
+namespace DORY
+{
+    SecondaryCommandPools::SecondaryCommandPools(Device& device, uint32_t thread_count, uint32_t frame_count)
+        : m_device(device), m_thread_count(thread_count)
+    {
+        VkCommandPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_info.queueFamilyIndex = m_device.FindPhysicalQueueFamilies()._graphics_family;
+        pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+        m_pools.resize(static_cast<size_t>(thread_count) * frame_count);
+        for (Pool& pool : m_pools)
+        {
+            if (vkCreateCommandPool(m_device.GetDevice(), &pool_info, nullptr, &pool.pool) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create secondary command pool!");
+            }
+        }
+    }
+
+    SecondaryCommandPools::~SecondaryCommandPools()
+    {
+        // destroying a pool frees its command buffers
+        for (Pool& pool : m_pools) { vkDestroyCommandPool(m_device.GetDevice(), pool.pool, nullptr); }
+    }
+
+    void SecondaryCommandPools::Reset(uint32_t frame_index)
+    {
+        // resetting a whole pool is cheaper than resetting its buffers one by one, and keeps them allocated
+        m_frame_index = frame_index;
+        for (uint32_t t = 0; t < m_thread_count; t++)
+        {
+            Pool& pool = m_pools[m_frame_index * m_thread_count + t];
+            if (pool.used == 0) { continue; }
+            vkResetCommandPool(m_device.GetDevice(), pool.pool, 0);
+            pool.used = 0;
+        }
+    }
+
+    void SecondaryCommandPools::SetRenderPass(VkRenderPass render_pass, VkFramebuffer framebuffer, VkExtent2D extent)
+    {
+        m_render_pass = render_pass;
+        m_framebuffer = framebuffer;
+        m_extent = extent;
+    }
+
+    VkCommandBuffer SecondaryCommandPools::Begin(uint32_t thread)
+    {
+        Pool& pool = m_pools[m_frame_index * m_thread_count + thread];
+        if (pool.used == pool.command_buffers.size())
+        {
+            VkCommandBufferAllocateInfo alloc_info{};
+            alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            alloc_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            alloc_info.commandPool = pool.pool;
+            alloc_info.commandBufferCount = 1;
+
+            VkCommandBuffer command_buffer;
+            if (vkAllocateCommandBuffers(m_device.GetDevice(), &alloc_info, &command_buffer) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to allocate secondary command buffer!");
+            }
+            pool.command_buffers.push_back(command_buffer);
+        }
+        VkCommandBuffer command_buffer = pool.command_buffers[pool.used++];
+
+        VkCommandBufferInheritanceInfo inheritance_info{};
+        inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance_info.renderPass = m_render_pass;
+        inheritance_info.subpass = 0;
+        inheritance_info.framebuffer = m_framebuffer;
+
+        VkCommandBufferBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        begin_info.pInheritanceInfo = &inheritance_info;
+        if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to begin recording secondary command buffer!");
+        }
+
+        // dynamic state is not inherited from the primary command buffer
+        VkViewport viewport{};
+        viewport.width = static_cast<float>(m_extent.width);
+        viewport.height = static_cast<float>(m_extent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        VkRect2D scissor{};
+        scissor.extent = m_extent;
+        vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+        vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+        return command_buffer;
+    }
+} // namespace DORY
\ No newline at end of file
@@ -0,0 +1,84 @@
+#ifndef DORY_SECONDARY_COMMAND_POOLS_INCL
+#define DORY_SECONDARY_COMMAND_POOLS_INCL
+
+#include "renderer/device.h"
+#include "utils/nocopy.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace DORY
+{
+    /**
+     * @brief secondary command buffers for recording a render pass on several threads. command pools are
+     * not thread safe, so every recording thread has a pool of its own for every frame in flight, and
+     * the buffers of a frame are recycled all at once by resetting its pools once the device is done with
+     * it. thread t may only call Begin() with slot t, and different slots can be used at the same time.
+     */
+    class SecondaryCommandPools : public NoCopy
+    {
+        public:
+            /**
+             * @brief create the command pools
+             * @param device the device to record for
+             * @param thread_count number of recording threads
+             * @param frame_count number of frames in flight
+             */
+            SecondaryCommandPools(Device& device, uint32_t thread_count, uint32_t frame_count);
+
+            /**
+             * @brief destroy the command pools. the device must be done with every frame
+             */
+            ~SecondaryCommandPools();
+
+            /**
+             * @brief recycle the command buffers of a frame. the device must be done with the frame
+             * @param frame_index index of the frame in flight
+             */
+            void Reset(uint32_t frame_index);
+
+            /**
+             * @brief set the render pass that the command buffers begun from now on continue
+             * @param render_pass the render pass
+             * @param framebuffer the framebuffer the render pass writes
+             * @param extent the size of the framebuffer, for the viewport and scissor
+             */
+            void SetRenderPass(VkRenderPass render_pass, VkFramebuffer framebuffer, VkExtent2D extent);
+
+            /**
+             * @brief begin a secondary command buffer that continues the render pass, with the viewport and
+             * scissor set. the caller ends it and executes it from the primary command buffer
+             * @param thread slot of the calling thread, less than GetThreadCount()
+             * @return VkCommandBuffer
+             */
+            VkCommandBuffer Begin(uint32_t thread);
+
+            /**
+             * @brief get the number of recording threads
+             * @return uint32_t
+             */
+            uint32_t GetThreadCount() const { return m_thread_count; }
+
+        private: // types
+            /**
+             * @brief the pool of one thread for one frame
+             */
+            struct Pool
+            {
+                VkCommandPool pool = VK_NULL_HANDLE;
+                std::vector<VkCommandBuffer> command_buffers{}; // every buffer allocated from pool
+                uint32_t used = 0; // number of command_buffers handed out since the last reset
+            };
+
+        private: // members
+            Device& m_device; // the device to record for
+            uint32_t m_thread_count; // see GetThreadCount()
+            std::vector<Pool> m_pools{}; // pool of thread t for frame f at f * m_thread_count + t
+            uint32_t m_frame_index = 0; // frame whose pools are being recorded into
+            VkRenderPass m_render_pass = VK_NULL_HANDLE; // see SetRenderPass()
+            VkFramebuffer m_framebuffer = VK_NULL_HANDLE; // see SetRenderPass()
+            VkExtent2D m_extent{}; // see SetRenderPass()
+    }; // class SecondaryCommandPools
+} // namespace DORY
+
+#endif // DORY_SECONDARY_COMMAND_POOLS_INCL
\ No newline at end of file
@@ -0,0 +1,43 @@
+#include "renderer/staging_ring.h"
+
+#include <stdexcept>
+
+namespace DORY
+{
+    StagingRing::StagingRing(Device& device, VkDeviceSize size)
+        : m_size(size)
+    {
+        m_buffer = std::make_unique<Buffer>(device,
+                                            size,
+                                            1,
+                                            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        if (m_buffer->Map() != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to map staging ring!");
+        }
+    }
+
+    bool StagingRing::Allocate(VkDeviceSize size, Region& region)
+    {
+        if (size > m_size) { return false; }
+
+        // an empty ring starts over at its beginning, so that anything up to its full size fits
+        if (m_head == m_tail) { m_head = m_tail = (m_head + m_size - 1) / m_size * m_size; }
+
+        // a region never wraps around, the space left at the end is skipped instead
+        uint64_t start = (m_head + REGION_ALIGNMENT - 1) & ~(REGION_ALIGNMENT - 1);
+        if (start % m_size + size > m_size) { start += m_size - start % m_size; }
+        if (start + size - m_tail > m_size) { return false; }
+
+        m_head = start + size;
+        region.offset = start % m_size;
+        region.data = static_cast<char*>(m_buffer->GetMappedMemory()) + region.offset;
+        return true;
+    }
+
+    void StagingRing::Release(uint64_t position)
+    {
+        if (position > m_tail) { m_tail = position; }
+    }
+} // namespace DORY
\ No newline at end of file
@@ -0,0 +1,96 @@
+#ifndef DORY_STAGING_RING_INCL
+#define DORY_STAGING_RING_INCL
+
+#include "renderer/buffer.h"
+#include "renderer/device.h"
+#include "utils/nocopy.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace DORY
+{
+    /**
+     * @brief a persistently mapped host visible buffer that upload data is written into before it is
+     * copied to device local buffers. space is handed out front to back and wraps around at the end; it
+     * is released in the same order, once the copies reading it have finished. positions are counted in
+     * bytes since the ring was created, so the owner can release everything before a position without
+     * tracking individual regions.
+     */
+    class StagingRing : public NoCopy
+    {
+        public:
+            /**
+             * @brief default capacity of the ring
+             */
+            static constexpr VkDeviceSize DEFAULT_SIZE = VkDeviceSize{32} << 20;
+
+            /**
+             * @brief alignment of the regions handed out, which keeps the copies on a good path on every device
+             */
+            static constexpr VkDeviceSize REGION_ALIGNMENT = 16;
+
+            /**
+             * @brief space for the data of one copy
+             */
+            struct Region
+            {
+                VkDeviceSize offset = 0; // byte offset of the region within GetBuffer()
+                void* data = nullptr; // host address of the region
+            };
+
+            /**
+             * @brief create the ring buffer
+             * @param device the device to create the buffer on
+             * @param size (optional) capacity of the ring in bytes
+             */
+            StagingRing(Device& device, VkDeviceSize size = DEFAULT_SIZE);
+
+            /**
+             * @brief take space from the ring
+             * @param size number of bytes needed
+             * @param region set to the space on success
+             * @return true if there was enough free space
+             * @return false if space has to be released first, or size is larger than the ring
+             */
+            bool Allocate(VkDeviceSize size, Region& region);
+
+            /**
+             * @brief release everything handed out before a position
+             * @param position a value returned by GetHead() earlier
+             */
+            void Release(uint64_t position);
+
+            /**
+             * @brief get the position right after the last region handed out
+             * @return uint64_t
+             */
+            uint64_t GetHead() const { return m_head; }
+
+            /**
+             * @brief get the staging buffer, the source of the copies
+             * @return VkBuffer
+             */
+            VkBuffer GetBuffer() const { return m_buffer->GetBuffer(); }
+
+            /**
+             * @brief get the capacity of the ring
+             * @return VkDeviceSize
+             */
+            VkDeviceSize GetSize() const { return m_size; }
+
+            /**
+             * @brief get the number of bytes handed out and not released yet, including padding
+             * @return VkDeviceSize
+             */
+            VkDeviceSize GetUsedSize() const { return m_head - m_tail; }
+
+        private: // members
+            std::unique_ptr<Buffer> m_buffer{}; // the ring, mapped for its whole lifetime
+            VkDeviceSize m_size = 0; // capacity of the ring
+            uint64_t m_head = 0; // position where the next region starts
+            uint64_t m_tail = 0; // position of the oldest byte not released yet
+    }; // class StagingRing
+} // namespace DORY
+
+#endif // DORY_STAGING_RING_INCL
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "renderer/swapchain.h"
+#include "renderer/frame_timeline.h"
 
 #include <cstdlib>
 #include <cstring>
@@ -10,17 +11,18 @@
 #include <limits>
 #include <set>
 #include <algorithm>
+#include <utility>
 
 namespace DORY
 {
-    SwapChain::SwapChain(Device &device_ref, VkExtent2D extent)
-        : m_device{device_ref}, m_window_extent{extent} 
+    SwapChain::SwapChain(Device &device_ref, VkExtent2D extent, const RendererConfig& config)
+        : m_device{device_ref}, m_window_extent{extent}, m_frames_in_flight{config.frames_in_flight}, m_requested_image_count{config.image_count}, m_requested_present_mode{config.present_mode}
     {
         Init();
     }
 
-    SwapChain::SwapChain(Device &device_ref, VkExtent2D extent, std::shared_ptr<SwapChain> old_swap_chain)
-        : m_device{device_ref}, m_window_extent{extent}, m_old_swap_chain{old_swap_chain} 
+    SwapChain::SwapChain(Device &device_ref, VkExtent2D extent, const RendererConfig& config, std::shared_ptr<SwapChain> old_swap_chain)
+        : m_device{device_ref}, m_window_extent{extent}, m_frames_in_flight{config.frames_in_flight}, m_requested_image_count{config.image_count}, m_requested_present_mode{config.present_mode}, m_old_swap_chain{old_swap_chain} 
     {
         Init();
         m_old_swap_chain = nullptr; // old swap chain is only used in initialization, so we don't need it anymore
@@ -38,54 +40,68 @@ namespace DORY
 
     SwapChain::~SwapChain()
     {
-        // clean up image views
-        for (auto image_view : m_swap_chain_image_views)
+        // frames in flight may still render to the images and wait on the semaphores, so everything is
+        // destroyed once they have finished rather than after waiting for the device to go idle
+        m_device.GetDeletionQueue().Push([  &device = m_device,
+                                            swap_chain = m_swap_chain,
+                                            image_views = std::move(m_swap_chain_image_views),
+                                            depth_images = std::move(m_depth_images),
+                                            depth_image_views = std::move(m_depth_image_views),
+                                            depth_image_memories = std::move(m_depth_image_memories),
+                                            framebuffers = std::move(m_swap_chain_framebuffers),
+                                            render_pass = m_render_pass,
+                                            render_finished_semaphores = std::move(m_render_finished_semaphores),
+                                            image_available_semaphores = std::move(m_image_available_semaphores)]() mutable
         {
-            vkDestroyImageView(m_device.GetDevice(), image_view, nullptr);
-        }
-        m_swap_chain_image_views.clear();
+            // clean up image views
+            for (auto image_view : image_views)
+            {
+                vkDestroyImageView(device.GetDevice(), image_view, nullptr);
+            }
 
-        // clean up swap chain
-        if (m_swap_chain != nullptr)
-        {
-            vkDestroySwapchainKHR(m_device.GetDevice(), m_swap_chain, nullptr);
-            m_swap_chain = nullptr;
-        }
+            // clean up swap chain
+            if (swap_chain != nullptr)
+            {
+                vkDestroySwapchainKHR(device.GetDevice(), swap_chain, nullptr);
+            }
 
-        // clean up depth resources
-        for (size_t i = 0; i < m_depth_images.size(); i++)
-        {
-            vkDestroyImageView(m_device.GetDevice(), m_depth_image_views[i], nullptr);
-            vkDestroyImage(m_device.GetDevice(), m_depth_images[i], nullptr);
-            vkFreeMemory(m_device.GetDevice(), m_depth_image_memories[i], nullptr);
-        }
+            // clean up depth resources
+            for (size_t i = 0; i < depth_images.size(); i++)
+            {
+                vkDestroyImageView(device.GetDevice(), depth_image_views[i], nullptr);
+                vkDestroyImage(device.GetDevice(), depth_images[i], nullptr);
+                device.GetAllocator().Free(depth_image_memories[i]);
+            }
 
-        // clean up frame buffers
-        for (auto framebuffer : m_swap_chain_framebuffers)
-        {
-            vkDestroyFramebuffer(m_device.GetDevice(), framebuffer, nullptr);
-        }
+            // clean up frame buffers
+            for (auto framebuffer : framebuffers)
+            {
+                vkDestroyFramebuffer(device.GetDevice(), framebuffer, nullptr);
+            }
 
-        // clean up render pass
-        vkDestroyRenderPass(m_device.GetDevice(), m_render_pass, nullptr);
+            // clean up render pass
+            vkDestroyRenderPass(device.GetDevice(), render_pass, nullptr);
 
-        // clean up synchronization objects
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-        {
-            vkDestroySemaphore(m_device.GetDevice(), m_render_finished_semaphores[i], nullptr);
-            vkDestroySemaphore(m_device.GetDevice(), m_image_available_semaphores[i], nullptr);
-            vkDestroyFence(m_device.GetDevice(), m_in_flight_fences[i], nullptr);
-        }
+            // clean up synchronization objects
+            for (auto semaphore : render_finished_semaphores) { vkDestroySemaphore(device.GetDevice(), semaphore, nullptr); }
+            for (auto semaphore : image_available_semaphores) { vkDestroySemaphore(device.GetDevice(), semaphore, nullptr); }
+        });
     }
 
-    VkResult SwapChain::AcquireNextImage(uint32_t *image_index)
+    VkResult SwapChain::AcquireNextImage(uint64_t frame_number, uint32_t *image_index)
     {
-        vkWaitForFences(m_device.GetDevice(), 1, &m_in_flight_fences[m_current_frame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+        // the semaphore of this frame was last waited on by the frame frames_in_flight frames earlier. the
+        // frames in flight may have been submitted through an older swap chain, the timeline covers them too
+        m_frame_number = frame_number;
+        if (m_frame_number >= m_frames_in_flight)
+        {
+            m_device.GetFrameTimeline().Wait(m_frame_number - m_frames_in_flight);
+        }
 
         VkResult result = vkAcquireNextImageKHR(m_device.GetDevice(),
                                                 m_swap_chain,
                                                 std::numeric_limits<uint64_t>::max(),
-                                                m_image_available_semaphores[m_current_frame],  // must be a not signaled semaphore
+                                                m_image_available_semaphores[m_frame_number % m_frames_in_flight],  // must be a not signaled semaphore
                                                 VK_NULL_HANDLE,
                                                 image_index);
 
@@ -94,16 +110,10 @@ namespace DORY
 
     VkResult SwapChain::SubmitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *image_index)
     {
-        if (m_images_in_flight[*image_index] != VK_NULL_HANDLE)
-        {
-            vkWaitForFences(m_device.GetDevice(), 1, &m_images_in_flight[*image_index], VK_TRUE, UINT64_MAX);
-        }
-        m_images_in_flight[*image_index] = m_in_flight_fences[m_current_frame];
-
         VkSubmitInfo submit_info{};
         submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-        VkSemaphore wait_semaphores[] = {m_image_available_semaphores[m_current_frame]};
+        VkSemaphore wait_semaphores[] = {m_image_available_semaphores[m_frame_number % m_frames_in_flight]};
         VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
         submit_info.waitSemaphoreCount = 1;
         submit_info.pWaitSemaphores = wait_semaphores;
@@ -112,12 +122,20 @@ namespace DORY
         submit_info.commandBufferCount = 1;
         submit_info.pCommandBuffers = buffers;
 
-        VkSemaphore signal_semaphores[] = {m_render_finished_semaphores[m_current_frame]};
-        submit_info.signalSemaphoreCount = 1;
+        // the render finished semaphore belongs to the image, since the presentation waiting on it is only
+        // known to be done once the image is acquired again. the value of the binary semaphore is ignored
+        VkSemaphore signal_semaphores[] = {m_render_finished_semaphores[*image_index], m_device.GetFrameTimeline().GetSemaphore()};
+        uint64_t signal_values[] = {0, FrameTimeline::GetSignalValue(m_frame_number)};
+        submit_info.signalSemaphoreCount = 2;
         submit_info.pSignalSemaphores = signal_semaphores;
 
-        vkResetFences(m_device.GetDevice(), 1, &m_in_flight_fences[m_current_frame]);
-        if (vkQueueSubmit(m_device.GetGraphicsQueue(), 1, &submit_info, m_in_flight_fences[m_current_frame]) != VK_SUCCESS)
+        VkTimelineSemaphoreSubmitInfo timeline_info{};
+        timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timeline_info.signalSemaphoreValueCount = 2;
+        timeline_info.pSignalSemaphoreValues = signal_values;
+        submit_info.pNext = &timeline_info;
+
+        if (vkQueueSubmit(m_device.GetGraphicsQueue(), 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
         {
             throw std::runtime_error("Failed to submit draw command buffer!");
         }
@@ -133,11 +151,7 @@ namespace DORY
         present_info.pSwapchains = swap_chains;
         present_info.pImageIndices = image_index;
 
-        auto result = vkQueuePresentKHR(m_device.GetPresentQueue(), &present_info);
-
-        m_current_frame = (m_current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
-
-        return result;
+        return vkQueuePresentKHR(m_device.GetPresentQueue(), &present_info);
     }      
 
     void SwapChain::CreateSwapChain()
@@ -146,12 +160,15 @@ namespace DORY
         SwapChainSupportDetails swap_chain_support = m_device.GetSwapChainSupport();
 
         VkSurfaceFormatKHR surface_format = ChooseSwapSurfaceFormat(swap_chain_support._formats);
+        m_supported_present_modes = swap_chain_support._present_modes;
         VkPresentModeKHR present_mode = ChooseSwapPresentMode(swap_chain_support._present_modes);
         VkExtent2D extent = ChooseSwapExtent(swap_chain_support._capabilities);
 
         // implementation of swap chain provides a minimum number of images necessary to function with minImageCount.
-        // it is recommended to add at least one more image to the image count to prevent latency.
-        uint32_t image_count = swap_chain_support._capabilities.minImageCount + 1;
+        // unless told otherwise, add one more image to the image count so that acquiring rarely waits on the
+        // presentation engine
+        uint32_t image_count = m_requested_image_count == 0 ? swap_chain_support._capabilities.minImageCount + 1 : m_requested_image_count;
+        image_count = std::max(image_count, swap_chain_support._capabilities.minImageCount);
         // also make sure this doesn't exceed the maxImageCount
         if (swap_chain_support._capabilities.maxImageCount > 0 && image_count > swap_chain_support._capabilities.maxImageCount)
         {
@@ -208,6 +225,7 @@ namespace DORY
 
         m_swap_chain_image_format = surface_format.format;
         m_swap_chain_extent = extent;
+        m_present_mode = present_mode;
     }
 
     void SwapChain::CreateImageViews()
@@ -366,26 +384,24 @@ namespace DORY
 
     void SwapChain::CreateSyncObjects()
     {
-        m_image_available_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        m_render_finished_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        m_in_flight_fences.resize(MAX_FRAMES_IN_FLIGHT);
-        m_images_in_flight.resize(GetImageCount(), VK_NULL_HANDLE);
+        m_image_available_semaphores.resize(m_frames_in_flight);
+        m_render_finished_semaphores.resize(GetImageCount());
 
         VkSemaphoreCreateInfo semaphore_info{};
         semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-        VkFenceCreateInfo fence_info{};
-        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            if (vkCreateSemaphore(m_device.GetDevice(), &semaphore_info, nullptr, &m_image_available_semaphores[i]) != VK_SUCCESS ||
-                vkCreateSemaphore(m_device.GetDevice(), &semaphore_info, nullptr, &m_render_finished_semaphores[i]) != VK_SUCCESS ||
-                vkCreateFence(m_device.GetDevice(), &fence_info, nullptr, &m_in_flight_fences[i]) != VK_SUCCESS)
+        for (size_t i = 0; i < m_frames_in_flight; i++) {
+            if (vkCreateSemaphore(m_device.GetDevice(), &semaphore_info, nullptr, &m_image_available_semaphores[i]) != VK_SUCCESS)
             {
                 throw std::runtime_error("Failed to create synchronization objects for a frame!");
             }
         }
+        for (size_t i = 0; i < GetImageCount(); i++) {
+            if (vkCreateSemaphore(m_device.GetDevice(), &semaphore_info, nullptr, &m_render_finished_semaphores[i]) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create synchronization objects for an image!");
+            }
+        }
     }
 
     VkSurfaceFormatKHR SwapChain::ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &available_formats)
@@ -401,25 +417,36 @@ namespace DORY
         return available_formats[0];
     }
 
+    bool SwapChain::IsPresentModeSupported(VkPresentModeKHR present_mode) const
+    {
+        return std::find(m_supported_present_modes.begin(), m_supported_present_modes.end(), present_mode) != m_supported_present_modes.end();
+    }
+
     VkPresentModeKHR SwapChain::ChooseSwapPresentMode(const std::vector<VkPresentModeKHR> &available_present_modes)
     {
-        for (const auto &available_present_mode : available_present_modes)
+        // each mode falls back to the closest one that keeps its promise: the uncapped modes prefer other
+        // modes that do not wait for a refresh, the tear-free ones never fall back to tearing
+        std::vector<VkPresentModeKHR> chain;
+        switch (m_requested_present_mode)
         {
-            if (available_present_mode == VK_PRESENT_MODE_MAILBOX_KHR)
+            case VK_PRESENT_MODE_IMMEDIATE_KHR: chain = {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR}; break;
+            case VK_PRESENT_MODE_MAILBOX_KHR: chain = {VK_PRESENT_MODE_MAILBOX_KHR}; break;
+            case VK_PRESENT_MODE_FIFO_RELAXED_KHR: chain = {VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR}; break;
+            default: break;
+        }
+
+        for (VkPresentModeKHR present_mode : chain)
+        {
+            if (std::find(available_present_modes.begin(), available_present_modes.end(), present_mode) == available_present_modes.end()) { continue; }
+            switch (present_mode)
             {
-                std::cout << "Present mode: Mailbox" << "\n";
-                return available_present_mode;
+                case VK_PRESENT_MODE_IMMEDIATE_KHR: std::cout << "Present mode: Immediate" << "\n"; break;
+                case VK_PRESENT_MODE_MAILBOX_KHR: std::cout << "Present mode: Mailbox" << "\n"; break;
+                default: std::cout << "Present mode: Relaxed V-Sync" << "\n"; break;
             }
+            return present_mode;
         }
 
-        // for (const auto &available_present_mode : available_present_modes)
-        // {
-        //   if (available_present_mode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-        //     std::cout << "Present mode: Immediate" << "\n";
-        //     return available_present_mode;
-        //   }
-        // }
-
         std::cout << "Present mode: V-Sync" << "\n";
         return VK_PRESENT_MODE_FIFO_KHR;
     }
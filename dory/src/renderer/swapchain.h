@@ -2,6 +2,7 @@
 #define DORY_SWAP_CHAIN_INCL
 
 #include "renderer/device.h"
+#include "renderer/renderer_config.h"
 #include "utils/nocopy.h"
 
 #include <vulkan/vulkan.h>
@@ -19,24 +20,29 @@ namespace DORY
     class SwapChain : public NoCopy
     {
         public:
-            // limit at most 2 command buffers sent to device graphics queue at once
-            static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+            // most command buffers ever sent to the device graphics queue at once, the upper limit of
+            // RendererConfig::frames_in_flight. code that needs to know a frame has finished asks the
+            // device's FrameTimeline instead
+            static constexpr int MAX_FRAMES_IN_FLIGHT = 4;
 
             /**
              * @brief create a new swap chain on a given device with a given window size
              * @param device_ref device to create the swap chain on
              * @param window_extent size of window
+             * @param config number of frames in flight and of images to create
              */
-            SwapChain(Device &device_ref, VkExtent2D window_extent);
+            SwapChain(Device &device_ref, VkExtent2D window_extent, const RendererConfig& config);
 
             /**
              * @brief recreate the swap chain with a new window size
              * 
              * @param device_ref device to create the swap chain on
              * @param window_extent size of window
-             * @param old_swap_chain the old swap chain to destroy
+             * @param config number of frames in flight and of images to create
+             * @param old_swap_chain the old swap chain to destroy. frames in flight stay synchronized through
+             * the device's FrameTimeline, so the device does not have to be idle
              */
-            SwapChain(Device &device_ref, VkExtent2D window_extent, std::shared_ptr<SwapChain> old_swap_chain);
+            SwapChain(Device &device_ref, VkExtent2D window_extent, const RendererConfig& config, std::shared_ptr<SwapChain> old_swap_chain);
 
             ~SwapChain();
 
@@ -65,6 +71,26 @@ namespace DORY
              */
             size_t GetImageCount() { return m_swap_chain_images.size(); }
 
+            /**
+             * @brief get the number of frames that may be in flight at once
+             * @return uint32_t
+             */
+            uint32_t GetFramesInFlight() const { return m_frames_in_flight; }
+
+            /**
+             * @brief get the present mode the swap chain was created with, after any fallback
+             * @return VkPresentModeKHR
+             */
+            VkPresentModeKHR GetPresentMode() const { return m_present_mode; }
+
+            /**
+             * @brief check whether the surface supports a present mode
+             * @param present_mode the mode
+             * @return true
+             * @return false
+             */
+            bool IsPresentModeSupported(VkPresentModeKHR present_mode) const;
+
             /**
              * @brief get swap chain image format
              * @return VkFormat 
@@ -116,14 +142,18 @@ namespace DORY
 
             /**
              * @brief get the index of next image in the swap chain.  this is the image that will be 
-             * rendered to next.
+             * rendered to next. first waits for the frame that last used the synchronization objects of
+             * this frame, frames_in_flight frames earlier
+             * @param frame_number the frame that will be rendered, see Renderer::GetFrameNumber()
              * @param image_index the index of the image to get
              * @return VkResult 
              */
-            VkResult AcquireNextImage(uint32_t *image_index);
+            VkResult AcquireNextImage(uint64_t frame_number, uint32_t *image_index);
 
             /**
-             * @brief submit the command buffer for the selected image to the device graphics queue. 
+             * @brief submit the command buffer for the selected image to the device graphics queue. the
+             * submission signals the device's FrameTimeline with the value of the frame given to
+             * AcquireNextImage()
              * @param buffers the command buffer to submit
              * @param image_index the index of the image to submit
              * @return VkResult 
@@ -183,8 +213,9 @@ namespace DORY
             VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &available_formats);
             
             /**
-             * @brief select the presentation mode for the swap buffers.  currently looks for "mailbox" mode
-             * but if this is unavailable, then it will default to FIFO
+             * @brief select the presentation mode for the swap buffers. takes the requested mode if it is
+             * available and otherwise falls back to the closest one: IMMEDIATE to MAILBOX, FIFO_RELAXED and
+             * FIFO, MAILBOX to FIFO, FIFO_RELAXED to IMMEDIATE and FIFO. FIFO is always available
              * @param available_present_modes list (vector) of available presentation modes
              * @return VkPresentModeKHR the chosen presentation mode
              */
@@ -207,22 +238,25 @@ namespace DORY
             VkRenderPass m_render_pass;
 
             std::vector<VkImage> m_depth_images;
-            std::vector<VkDeviceMemory> m_depth_image_memories;
+            std::vector<MemoryAllocation> m_depth_image_memories;
             std::vector<VkImageView> m_depth_image_views;
             std::vector<VkImage> m_swap_chain_images;
             std::vector<VkImageView> m_swap_chain_image_views;
 
             Device &m_device;
             VkExtent2D m_window_extent;
+            uint32_t m_frames_in_flight; // see GetFramesInFlight()
+            uint32_t m_requested_image_count; // see RendererConfig::image_count
+            VkPresentModeKHR m_requested_present_mode; // see RendererConfig::present_mode
+            VkPresentModeKHR m_present_mode; // see GetPresentMode()
+            std::vector<VkPresentModeKHR> m_supported_present_modes; // modes supported by the surface
 
             VkSwapchainKHR m_swap_chain;
             std::shared_ptr<SwapChain> m_old_swap_chain;
 
-            std::vector<VkSemaphore> m_image_available_semaphores; // used to signal that an image is available for rendering
-            std::vector<VkSemaphore> m_render_finished_semaphores; // used to signal that an image has been rendered
-            std::vector<VkFence> m_in_flight_fences;
-            std::vector<VkFence> m_images_in_flight;
-            size_t m_current_frame = 0;
+            std::vector<VkSemaphore> m_image_available_semaphores; // one per frame in flight, signalled when the frame's image is available for rendering
+            std::vector<VkSemaphore> m_render_finished_semaphores; // one per image, signalled when the image has been rendered and can be presented
+            uint64_t m_frame_number = 0; // frame given to AcquireNextImage()
     }; // class SwapChain
 } // namespace DORY
 
@@ -0,0 +1,349 @@
+#include "renderer/upload_context.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace DORY
+{
+    UploadContext::UploadContext(Device& device, VkDeviceSize staging_size)
+        : m_device(device), m_staging_ring(device, staging_size)
+    {
+        QueueFamilyIndices indices = m_device.FindPhysicalQueueFamilies();
+        m_dedicated_transfer = m_device.HasDedicatedTransferQueue();
+        m_graphics_family = indices._graphics_family;
+        m_transfer_family = m_dedicated_transfer ? indices._transfer_family : indices._graphics_family;
+
+        m_command_pool = CreateCommandPool(m_transfer_family);
+        if (m_dedicated_transfer) { m_acquire_command_pool = CreateCommandPool(m_graphics_family); }
+    }
+
+    UploadContext::~UploadContext()
+    {
+        if (m_is_recording)
+        {
+            vkEndCommandBuffer(m_recording.command_buffer);
+            m_free.push_back(std::move(m_recording));
+        }
+
+        // the semaphores of batches that were never acquired are still signalled, and a wait is the only
+        // way to take that back
+        Acquire();
+        for (auto& batch : m_in_flight)
+        {
+            vkWaitForFences(m_device.GetDevice(), 1, &batch.fence, VK_TRUE, UINT64_MAX);
+            if (m_dedicated_transfer) { vkWaitForFences(m_device.GetDevice(), 1, &batch.acquire_fence, VK_TRUE, UINT64_MAX); }
+            m_free.push_back(std::move(batch));
+        }
+        m_in_flight.clear();
+
+        for (auto& batch : m_free)
+        {
+            vkDestroyFence(m_device.GetDevice(), batch.fence, nullptr);
+            if (m_dedicated_transfer)
+            {
+                vkDestroyFence(m_device.GetDevice(), batch.acquire_fence, nullptr);
+                vkDestroySemaphore(m_device.GetDevice(), batch.semaphore, nullptr);
+            }
+        }
+        m_free.clear();
+
+        // destroying the pools frees their command buffers
+        vkDestroyCommandPool(m_device.GetDevice(), m_command_pool, nullptr);
+        if (m_dedicated_transfer) { vkDestroyCommandPool(m_device.GetDevice(), m_acquire_command_pool, nullptr); }
+    }
+
+    uint64_t UploadContext::CopyBuffer(const void* data, VkDeviceSize size, VkBuffer dst_buffer, VkDeviceSize dst_offset)
+    {
+        VkBufferCopy copy_region{};
+        copy_region.dstOffset = dst_offset;
+        copy_region.size = size;
+        VkBuffer src_buffer = VK_NULL_HANDLE;
+        std::unique_ptr<Buffer> staging_buffer{};
+
+        if (size > m_staging_ring.GetSize())
+        {
+            // too large for the ring, so it gets a staging buffer of its own that lives as long as the batch
+            staging_buffer = std::make_unique<Buffer>(  m_device,
+                                                        size,
+                                                        1,
+                                                        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            staging_buffer->Map();
+            staging_buffer->WriteToBuffer(const_cast<void*>(data));
+            src_buffer = staging_buffer->GetBuffer();
+            m_stats.oversized_copies++;
+        }
+        else
+        {
+            // the space of the current batch is only released after it has been submitted, so that is
+            // done first when waiting on the batches in flight is not enough
+            StagingRing::Region region{};
+            while (!m_staging_ring.Allocate(size, region))
+            {
+                if (m_in_flight.empty() || m_in_flight.back().transferred) { Submit(); }
+                WaitForOldest();
+                m_stats.ring_waits++;
+            }
+            memcpy(region.data, data, size);
+            copy_region.srcOffset = region.offset;
+            src_buffer = m_staging_ring.GetBuffer();
+        }
+
+        if (!m_is_recording) { BeginBatch(); }
+        vkCmdCopyBuffer(m_recording.command_buffer, src_buffer, dst_buffer, 1, &copy_region);
+        if (staging_buffer) { m_recording.staging_buffers.push_back(std::move(staging_buffer)); }
+
+        if (m_dedicated_transfer)
+        {
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcQueueFamilyIndex = m_transfer_family;
+            barrier.dstQueueFamilyIndex = m_graphics_family;
+            barrier.buffer = dst_buffer;
+            barrier.offset = dst_offset;
+            barrier.size = size;
+            m_recording.ownership_barriers.push_back(barrier);
+        }
+
+        m_stats.copies++;
+        m_stats.bytes += size;
+        return m_recording.id;
+    }
+
+    void UploadContext::Submit()
+    {
+        if (!m_is_recording) { return; }
+
+        VkSubmitInfo submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &m_recording.command_buffer;
+
+        if (m_dedicated_transfer)
+        {
+            // release the written ranges to the graphics queue family. the matching acquire is recorded
+            // now and submitted later, see SubmitAcquire()
+            std::vector<VkBufferMemoryBarrier>& barriers = m_recording.ownership_barriers;
+            for (auto& barrier : barriers)
+            {
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.dstAccessMask = 0;
+            }
+            vkCmdPipelineBarrier(   m_recording.command_buffer,
+                                    VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                    0,
+                                    0, nullptr,
+                                    static_cast<uint32_t>(barriers.size()), barriers.data(),
+                                    0, nullptr);
+            vkEndCommandBuffer(m_recording.command_buffer);
+
+            for (auto& barrier : barriers)
+            {
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+            }
+            VkCommandBufferBeginInfo begin_info{};
+            begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(m_recording.acquire_command_buffer, &begin_info);
+            vkCmdPipelineBarrier(   m_recording.acquire_command_buffer,
+                                    VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                                    VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                                    0,
+                                    0, nullptr,
+                                    static_cast<uint32_t>(barriers.size()), barriers.data(),
+                                    0, nullptr);
+            vkEndCommandBuffer(m_recording.acquire_command_buffer);
+
+            submit_info.signalSemaphoreCount = 1;
+            submit_info.pSignalSemaphores = &m_recording.semaphore;
+        }
+        else
+        {
+            // make the copies visible to the vertex input stage of later submissions
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+            vkCmdPipelineBarrier(   m_recording.command_buffer,
+                                    VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                    VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                                    0,
+                                    1, &barrier,
+                                    0, nullptr,
+                                    0, nullptr);
+            vkEndCommandBuffer(m_recording.command_buffer);
+        }
+
+        if (vkQueueSubmit(m_device.GetTransferQueue(), 1, &submit_info, m_recording.fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to submit upload batch!");
+        }
+        m_stats.batches++;
+
+        m_recording.ring_end = m_staging_ring.GetHead();
+        m_in_flight.push_back(std::move(m_recording));
+        m_recording = Batch{};
+        m_is_recording = false;
+    }
+
+    uint64_t UploadContext::Poll()
+    {
+        // batches finish in the order they were submitted, so this stops at the first one that has not
+        for (auto& batch : m_in_flight)
+        {
+            if (!batch.transferred)
+            {
+                if (vkGetFenceStatus(m_device.GetDevice(), batch.fence) != VK_SUCCESS) { break; }
+                batch.transferred = true;
+                m_staging_ring.Release(batch.ring_end);
+                batch.staging_buffers.clear();
+            }
+            if (!batch.acquired) { SubmitAcquire(batch); }
+        }
+
+        while (!m_in_flight.empty())
+        {
+            Batch& batch = m_in_flight.front();
+            if (!batch.transferred) { break; }
+            if (m_dedicated_transfer && vkGetFenceStatus(m_device.GetDevice(), batch.acquire_fence) != VK_SUCCESS) { break; }
+            m_finished_batch = batch.id;
+            m_free.push_back(std::move(batch));
+            m_in_flight.pop_front();
+        }
+        return m_completed_batch;
+    }
+
+    void UploadContext::Acquire()
+    {
+        for (auto& batch : m_in_flight)
+        {
+            if (!batch.acquired) { SubmitAcquire(batch); }
+        }
+    }
+
+    void UploadContext::WaitIdle()
+    {
+        Submit();
+        Acquire();
+        if (!m_in_flight.empty())
+        {
+            vkWaitForFences(m_device.GetDevice(), 1, &m_in_flight.back().fence, VK_TRUE, UINT64_MAX);
+            if (m_dedicated_transfer) { vkWaitForFences(m_device.GetDevice(), 1, &m_in_flight.back().acquire_fence, VK_TRUE, UINT64_MAX); }
+        }
+        Poll();
+    }
+
+    void UploadContext::WaitForOldest()
+    {
+        for (auto& batch : m_in_flight)
+        {
+            if (batch.transferred) { continue; }
+            vkWaitForFences(m_device.GetDevice(), 1, &batch.fence, VK_TRUE, UINT64_MAX);
+            break;
+        }
+        Poll();
+    }
+
+    void UploadContext::SubmitAcquire(Batch& batch)
+    {
+        batch.acquired = true;
+        m_completed_batch = batch.id;
+        if (!m_dedicated_transfer) { return; }
+
+        // waiting at the stage of the acquire barrier chains the copies, the semaphore, the acquire and
+        // every later draw together
+        const VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        VkSubmitInfo submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.waitSemaphoreCount = 1;
+        submit_info.pWaitSemaphores = &batch.semaphore;
+        submit_info.pWaitDstStageMask = &wait_stage;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &batch.acquire_command_buffer;
+        if (vkQueueSubmit(m_device.GetGraphicsQueue(), 1, &submit_info, batch.acquire_fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to submit upload acquire!");
+        }
+    }
+
+    void UploadContext::BeginBatch()
+    {
+        if (!m_free.empty())
+        {
+            m_recording = std::move(m_free.back());
+            m_free.pop_back();
+            vkResetFences(m_device.GetDevice(), 1, &m_recording.fence);
+            vkResetCommandBuffer(m_recording.command_buffer, 0);
+            if (m_dedicated_transfer)
+            {
+                vkResetFences(m_device.GetDevice(), 1, &m_recording.acquire_fence);
+                vkResetCommandBuffer(m_recording.acquire_command_buffer, 0);
+            }
+        }
+        else
+        {
+            VkFenceCreateInfo fence_info{};
+            fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            VkSemaphoreCreateInfo semaphore_info{};
+            semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+            m_recording.command_buffer = AllocateCommandBuffer(m_command_pool);
+            if (vkCreateFence(m_device.GetDevice(), &fence_info, nullptr, &m_recording.fence) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create upload fence!");
+            }
+
+            if (m_dedicated_transfer)
+            {
+                m_recording.acquire_command_buffer = AllocateCommandBuffer(m_acquire_command_pool);
+                if (vkCreateFence(m_device.GetDevice(), &fence_info, nullptr, &m_recording.acquire_fence) != VK_SUCCESS ||
+                    vkCreateSemaphore(m_device.GetDevice(), &semaphore_info, nullptr, &m_recording.semaphore) != VK_SUCCESS)
+                {
+                    throw std::runtime_error("Failed to create upload synchronization objects!");
+                }
+            }
+        }
+
+        m_recording.id = m_next_batch++;
+        m_recording.staging_buffers.clear();
+        m_recording.ownership_barriers.clear();
+        m_recording.transferred = false;
+        m_recording.acquired = false;
+
+        VkCommandBufferBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(m_recording.command_buffer, &begin_info);
+        m_is_recording = true;
+    }
+
+    VkCommandPool UploadContext::CreateCommandPool(uint32_t queue_family)
+    {
+        VkCommandPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_info.queueFamilyIndex = queue_family;
+        pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+        VkCommandPool pool;
+        if (vkCreateCommandPool(m_device.GetDevice(), &pool_info, nullptr, &pool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create upload command pool!");
+        }
+        return pool;
+    }
+
+    VkCommandBuffer UploadContext::AllocateCommandBuffer(VkCommandPool pool)
+    {
+        VkCommandBufferAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        alloc_info.commandPool = pool;
+        alloc_info.commandBufferCount = 1;
+
+        VkCommandBuffer command_buffer;
+        vkAllocateCommandBuffers(m_device.GetDevice(), &alloc_info, &command_buffer);
+        return command_buffer;
+    }
+} // namespace DORY
\ No newline at end of file
@@ -0,0 +1,181 @@
+#ifndef DORY_UPLOAD_CONTEXT_INCL
+#define DORY_UPLOAD_CONTEXT_INCL
+
+#include "renderer/buffer.h"
+#include "renderer/device.h"
+#include "renderer/staging_ring.h"
+#include "utils/nocopy.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace DORY
+{
+    /**
+     * @brief records buffer uploads into batches that are submitted without waiting for them. each batch
+     * is one command buffer with its own fence. the data of the copies is written into a StagingRing,
+     * and the ring space of a batch is released once its fence signals, so uploading does not create a
+     * staging buffer per copy. completion is checked with Poll(), so the thread submitting uploads only
+     * blocks on the GPU when the ring is full. all functions must be called from the thread that submits
+     * to the graphics queue.
+     *
+     * when the device has a dedicated transfer queue, the batches are submitted there and copy while the
+     * graphics queue renders. the destination buffers are then owned by the transfer queue family, so each
+     * batch ends by releasing them, and a second command buffer acquires them on the graphics queue after
+     * waiting for the batch's semaphore. Poll() submits the acquire once the copies have finished, so the
+     * graphics queue never waits for them; Acquire() submits it right away for uploads needed in the next
+     * frame. a batch is complete once its buffers belong to the graphics queue family.
+     */
+    class UploadContext : public NoCopy
+    {
+        public:
+            /**
+             * @brief counters since the context was created
+             */
+            struct Stats
+            {
+                uint64_t batches = 0; // number of batches submitted
+                uint64_t copies = 0; // number of copies recorded
+                uint64_t bytes = 0; // number of bytes copied
+                uint64_t ring_waits = 0; // number of times a copy had to wait for ring space
+                uint64_t oversized_copies = 0; // copies larger than the ring, staged through their own buffer
+            };
+
+            /**
+             * @brief create the command pool used for the upload batches and the staging ring
+             * @param device the device to upload to
+             * @param staging_size (optional) capacity of the staging ring in bytes
+             */
+            UploadContext(Device& device, VkDeviceSize staging_size = StagingRing::DEFAULT_SIZE);
+
+            /**
+             * @brief wait for the submitted batches to finish and destroy the context
+             */
+            ~UploadContext();
+
+            /**
+             * @brief copy data into the staging ring and record its copy into a device buffer in the current
+             * batch. when the ring is full, the current batch is submitted and the oldest batch waited for
+             * @param data the data to upload, which can be reused as soon as this returns
+             * @param size number of bytes to copy
+             * @param dst_buffer buffer to copy to
+             * @param dst_offset (optional) byte offset within dst_buffer
+             * @return uint64_t id of the batch the copy was recorded in
+             */
+            uint64_t CopyBuffer(const void* data, VkDeviceSize size, VkBuffer dst_buffer, VkDeviceSize dst_offset = 0);
+
+            /**
+             * @brief submit the current batch, if anything was recorded in it
+             */
+            void Submit();
+
+            /**
+             * @brief release the ring space of the batches whose copies have finished, hand their buffers
+             * over to the graphics queue and recycle the batches that are done with
+             * @return uint64_t id of the newest batch that has completed. batches complete in order
+             */
+            uint64_t Poll();
+
+            /**
+             * @brief hand the buffers of every submitted batch over to the graphics queue now, instead of
+             * once their copies have finished. work submitted to the graphics queue afterwards waits for
+             * the copies at the vertex input stage. the batches are complete when this returns
+             */
+            void Acquire();
+
+            /**
+             * @brief submit the current batch and wait for every submitted batch to finish
+             */
+            void WaitIdle();
+
+            /**
+             * @brief check whether a batch has finished. only valid after Poll()
+             * @param batch id returned by CopyBuffer()
+             * @return true
+             * @return false
+             */
+            bool IsComplete(uint64_t batch) const { return batch <= m_completed_batch; }
+
+            /**
+             * @brief check whether the device is done with a batch, including the acquire on the graphics
+             * queue, so that its buffers can be read by any command without synchronizing with it. only
+             * valid after Poll()
+             * @param batch id returned by CopyBuffer()
+             * @return true
+             * @return false
+             */
+            bool IsFinished(uint64_t batch) const { return batch <= m_finished_batch; }
+
+            /**
+             * @brief get the upload counters
+             * @return Stats
+             */
+            Stats GetStats() const { return m_stats; }
+
+        private: // types
+            /**
+             * @brief uploads submitted together
+             */
+            struct Batch
+            {
+                uint64_t id = 0; // increases by one with every batch
+                VkCommandBuffer command_buffer = VK_NULL_HANDLE; // the recorded copies
+                VkFence fence = VK_NULL_HANDLE; // signalled when the copies have finished
+                uint64_t ring_end = 0; // ring position after the data of the batch
+                std::vector<std::unique_ptr<Buffer>> staging_buffers{}; // sources of the copies that did not fit in the ring
+                std::vector<VkBufferMemoryBarrier> ownership_barriers{}; // the ranges written, handed over to the graphics queue family
+                VkSemaphore semaphore = VK_NULL_HANDLE; // signalled by the copies, waited on by the acquire
+                VkCommandBuffer acquire_command_buffer = VK_NULL_HANDLE; // acquires the ranges on the graphics queue
+                VkFence acquire_fence = VK_NULL_HANDLE; // signalled when the acquire has finished
+                bool transferred = false; // whether the copies have finished
+                bool acquired = false; // whether the acquire has been submitted
+            };
+
+        private: // methods
+            /**
+             * @brief start recording a new batch, reusing the command buffer and fence of a finished one
+             */
+            void BeginBatch();
+
+            /**
+             * @brief wait for the copies of the oldest submitted batch to finish and release its ring space
+             */
+            void WaitForOldest();
+
+            /**
+             * @brief submit the acquire of a batch to the graphics queue and mark the batch complete
+             */
+            void SubmitAcquire(Batch& batch);
+
+            /**
+             * @brief create a command pool for a queue family
+             */
+            VkCommandPool CreateCommandPool(uint32_t queue_family);
+
+            /**
+             * @brief allocate a primary command buffer from a pool
+             */
+            VkCommandBuffer AllocateCommandBuffer(VkCommandPool pool);
+
+        private: // members
+            Device& m_device; // the device to upload to
+            StagingRing m_staging_ring; // holds the data of the copies until their batch has finished
+            bool m_dedicated_transfer = false; // whether uploads go to a transfer queue family of their own
+            uint32_t m_transfer_family = 0; // queue family the copies are submitted to
+            uint32_t m_graphics_family = 0; // queue family the buffers are used on
+            VkCommandPool m_command_pool = VK_NULL_HANDLE; // pool of the batch command buffers, on the transfer family
+            VkCommandPool m_acquire_command_pool = VK_NULL_HANDLE; // pool of the acquire command buffers, on the graphics family
+            Batch m_recording{}; // batch that copies are recorded into
+            bool m_is_recording = false; // whether m_recording has been begun
+            std::deque<Batch> m_in_flight{}; // submitted batches, oldest first
+            std::vector<Batch> m_free{}; // finished batches whose command buffers and synchronization objects can be reused
+            uint64_t m_next_batch = 1; // id of the next batch to begin
+            uint64_t m_completed_batch = 0; // id of the newest complete batch
+            uint64_t m_finished_batch = 0; // id of the newest batch that the device is done with
+            Stats m_stats{}; // upload counters
+    }; // class UploadContext
+} // namespace DORY
+
+#endif // DORY_UPLOAD_CONTEXT_INCL
\ No newline at end of file
@@ -54,8 +54,15 @@ namespace DORY
 
     void PointLightSystem::Render(FrameInfo frame_info)
     {
-        m_pipeline->Bind(frame_info.command_buffer);
-        vkCmdBindDescriptorSets(frame_info.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, 0, 1, &frame_info.descriptor_set, 0, nullptr);
-        vkCmdDraw(frame_info.command_buffer, 6, 1, 0, 0);
+        // the render pass only takes secondary command buffers, this one is recorded on the calling thread
+        VkCommandBuffer command_buffer = frame_info.secondary_pools.Begin(0);
+        m_pipeline->Bind(command_buffer);
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, 0, 1, &frame_info.descriptor_set, 1, &frame_info.global_ubo_offset);
+        vkCmdDraw(command_buffer, 6, 1, 0, 0);
+        if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to record secondary command buffer!");
+        }
+        vkCmdExecuteCommands(frame_info.command_buffer, 1, &command_buffer);
     }
 } // namespace DORY
\ No newline at end of file
@@ -1,4 +1,6 @@
+#include "core/job_system.h"
 #include "renderer/data.h"
+#include "renderer/geometry_arena.h"
 #include "systems/renderer_system.h"
 
 #define GLM_FORCE_RADIANS
@@ -7,7 +9,9 @@
 #include <glm/gtc/constants.hpp>
 
 #include <stdexcept>
+#include <algorithm>
 #include <array>
+#include <cmath>
 
 namespace DORY
 {
@@ -15,7 +19,7 @@ namespace DORY
         : m_device(device)
     {
         CreatePipelineLayout(descriptor_set_layout);
-        CreatePipeline(render_pass);
+        CreatePipelines(render_pass);
     }
     
     RendererSystem::~RendererSystem()
@@ -45,32 +49,262 @@ namespace DORY
         }
     }
 
-    void RendererSystem::CreatePipeline(VkRenderPass render_pass)
+    void RendererSystem::CreatePipelines(VkRenderPass render_pass)
     {
         DASSERT_MSG(m_pipeline_layout != nullptr, "Pipeline layout is null!");
 
-        PipelineConfigInfo pipeline_config{};
-        Pipeline::DefaultConfig(pipeline_config);
-        pipeline_config._render_pass = render_pass;
-        pipeline_config._pipeline_layout = m_pipeline_layout;
-        m_pipeline = std::make_unique<Pipeline>(m_device, pipeline_config, "assets/shaders/shader.vert.spv", "assets/shaders/shader.frag.spv");
+        for (size_t i = 0; i < m_pipelines.size(); i++)
+        {
+            const Model::VertexFormat format = static_cast<Model::VertexFormat>(i);
+
+            PipelineConfigInfo pipeline_config{};
+            Pipeline::DefaultConfig(pipeline_config);
+            pipeline_config._render_pass = render_pass;
+            pipeline_config._pipeline_layout = m_pipeline_layout;
+            pipeline_config.binding_decriptions = Model::Vertex::GetBindingDescriptions(format);
+            pipeline_config.attribute_decriptions = Model::Vertex::GetAttributeDescriptions(format);
+
+            // both compact formats decode their attributes in the same shader
+            const char* vertex_shader = format == Model::VertexFormat::Standard ? "assets/shaders/shader.vert.spv" : "assets/shaders/compact.vert.spv";
+            m_pipelines[i] = std::make_unique<Pipeline>(m_device, pipeline_config, vertex_shader, "assets/shaders/shader.frag.spv");
+        }
     }
 
     void RendererSystem::RenderObjects(FrameInfo frame_info)
     {
-        m_pipeline->Bind(frame_info.command_buffer);
-        vkCmdBindDescriptorSets(frame_info.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, 0, 1, &frame_info.descriptor_set, 0, nullptr);
+        // draw the objects grouped by vertex format and then by geometry page, so that the pipeline and
+        // the arena buffers are only bound when the group changes rather than once per object
+        m_draw_order.clear();
+        for (const Object& object : frame_info.objects)
+        {
+            if (object.m_model == nullptr) { continue; } // still loading
+
+            // an evicted model is brought back by the residency manager for a later frame
+            object.m_model->MarkUsed(frame_info.frame_number);
+            if (!object.m_model->IsResident()) { continue; }
+            m_draw_order.push_back(&object);
+        }
+        std::sort(m_draw_order.begin(), m_draw_order.end(), [](const Object* a, const Object* b)
+        {
+            const Model::VertexFormat format_a = a->m_model->GetVertexFormat();
+            const Model::VertexFormat format_b = b->m_model->GetVertexFormat();
+            if (format_a != format_b) { return format_a < format_b; }
+            return a->m_model->GetGeometryPage() < b->m_model->GetGeometryPage();
+        });
+
+        // the entries of the levels of detail are made here, so that the recording threads only write to
+        // values that already exist and never to the map itself
+        m_draw_lods.resize(m_draw_order.size());
+        for (size_t i = 0; i < m_draw_order.size(); i++)
+        {
+            ObjectLod& entry = m_object_lods[m_draw_order[i]->GetObjectId()];
+            entry.frame = frame_info.frame_number;
+            m_draw_lods[i] = &entry.lod;
+        }
 
-        for (auto& kv : frame_info.objects)
+        // objects that were not drawn this frame have been destroyed, are still loading or are evicted, and
+        // start over from the most detailed level once they are drawn again. erasing them keeps the map from
+        // growing with every object ever drawn, and leaves the entries pointed to above in place
+        for (auto it = m_object_lods.begin(); it != m_object_lods.end();)
         {
-            auto& object = kv.second;
+            if (it->second.frame != frame_info.frame_number) { it = m_object_lods.erase(it); }
+            else { ++it; }
+        }
+
+        // every thread records a contiguous range of the sorted objects, so the grouping holds within each
+        // secondary command buffer. a thread only pays off with enough objects to record
+        SecondaryCommandPools& pools = frame_info.secondary_pools;
+        const size_t object_count = m_draw_order.size();
+        const uint32_t thread_count = static_cast<uint32_t>(std::clamp<size_t>((object_count + MIN_OBJECTS_PER_THREAD - 1) / MIN_OBJECTS_PER_THREAD, 1, pools.GetThreadCount()));
+
+        // the buffers are begun and ended on this thread, since those may throw
+        m_secondary_command_buffers.resize(thread_count);
+        m_thread_stats.assign(thread_count, ClusterStats{});
+        for (uint32_t t = 0; t < thread_count; t++) { m_secondary_command_buffers[t] = pools.Begin(t); }
+        JobSystem::Get().RunParallel(thread_count, [&](size_t t)
+        {
+            RecordObjects(m_secondary_command_buffers[t], frame_info, object_count * t / thread_count, object_count * (t + 1) / thread_count, m_thread_stats[t]);
+        });
+
+        m_cluster_stats = ClusterStats{};
+        for (uint32_t t = 0; t < thread_count; t++)
+        {
+            if (vkEndCommandBuffer(m_secondary_command_buffers[t]) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to record secondary command buffer!");
+            }
+
+            const ClusterStats& stats = m_thread_stats[t];
+            m_cluster_stats.meshlets += stats.meshlets;
+            m_cluster_stats.frustum_culled += stats.frustum_culled;
+            m_cluster_stats.backface_culled += stats.backface_culled;
+            m_cluster_stats.triangles += stats.triangles;
+            m_cluster_stats.draws += stats.draws;
+            m_cluster_stats.buffer_binds += stats.buffer_binds;
+        }
+        vkCmdExecuteCommands(frame_info.command_buffer, thread_count, m_secondary_command_buffers.data());
+    }
+
+    void RendererSystem::RecordObjects(VkCommandBuffer command_buffer, const FrameInfo& frame_info, size_t begin, size_t end, ClusterStats& stats)
+    {
+        // the pipelines share a layout, so the descriptor set stays bound when switching between them
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, 0, 1, &frame_info.descriptor_set, 1, &frame_info.global_ubo_offset);
+
+        const GeometryArena& arena = m_device.GetGeometryArena();
+        Model::VertexFormat bound_format = Model::VertexFormat::Count;
+        uint32_t bound_page = GeometryArena::INVALID_PAGE;
+        for (size_t i = begin; i < end; i++)
+        {
+            const Object* object = m_draw_order[i];
+            const Model::VertexFormat format = object->m_model->GetVertexFormat();
+            if (format != bound_format)
+            {
+                m_pipelines[static_cast<size_t>(format)]->Bind(command_buffer);
+                bound_format = format;
+            }
+
+            const uint32_t page = object->m_model->GetGeometryPage();
+            if (page != bound_page)
+            {
+                arena.Bind(command_buffer, page);
+                bound_page = page;
+                stats.buffer_binds++;
+            }
+
+            const glm::mat4 model_matrix = object->transform.Matrix();
+            const uint32_t lod = SelectLod(*object, model_matrix, frame_info.camera, *m_draw_lods[i]);
+
             PushConstantData3D push{};
-            push.model_matrix = object.transform.Matrix();
-            push.normal_matrix = object.transform.NormalMatrix();
+            push.model_matrix = model_matrix * object->m_model->GetDequantizationMatrix();
+            push.normal_matrix = object->transform.NormalMatrix();
 
-            vkCmdPushConstants(frame_info.command_buffer, m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstantData3D), &push);
-            object.m_model->Bind(frame_info.command_buffer);
-            object.m_model->Draw(frame_info.command_buffer);
+            vkCmdPushConstants(command_buffer, m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstantData3D), &push);
+            DrawModel(command_buffer, *object->m_model, lod, model_matrix, frame_info.camera, stats);
+        }
+    }
+
+    uint32_t RendererSystem::SelectLod(const Object& object, const glm::mat4& model_matrix, const Camera& camera, uint32_t& current)
+    {
+        const Model& model = *object.m_model;
+        if (model.GetLodCount() == 1) { return 0; }
+
+        // the errors are in model space, scale them by the largest axis of the transform
+        const float scale = glm::max(glm::length(glm::vec3(model_matrix[0])), glm::max(glm::length(glm::vec3(model_matrix[1])), glm::length(glm::vec3(model_matrix[2]))));
+        const Model::BoundingSphere& sphere = model.GetBoundingSphere();
+        const glm::vec4 center = camera.GetView() * model_matrix * glm::vec4(sphere.center, 1.0f);
+
+        // size on screen of one unit at the nearest point of the bounding sphere, as a fraction of the
+        // screen height. w is the view depth for a perspective projection and 1 for an orthographic one
+        const glm::mat4& projection = camera.GetProjection();
+        const float depth = center.z - sphere.radius * scale;
+        const float w = glm::max(projection[2][3] * depth + projection[3][3], 1e-4f);
+        const float units_to_screen = 0.5f * glm::abs(projection[1][1]) * scale / w;
+
+        const float threshold = m_lod_threshold * std::exp2(m_lod_bias);
+        auto coarsest_within = [&](float limit)
+        {
+            uint32_t lod = 0;
+            while (lod + 1 < model.GetLodCount() && model.GetLod(lod + 1).error * units_to_screen <= limit) { lod++; }
+            return lod;
+        };
+
+        current = glm::min(current, model.GetLodCount() - 1);
+        if (model.GetLod(current).error * units_to_screen > threshold * (1.0f + m_lod_hysteresis))
+        {
+            current = coarsest_within(threshold);
+        }
+        else
+        {
+            current = glm::max(current, coarsest_within(threshold * (1.0f - m_lod_hysteresis)));
+        }
+        return current;
+    }
+
+    void RendererSystem::DrawModel(VkCommandBuffer command_buffer, Model& model, uint32_t lod, const glm::mat4& model_matrix, const Camera& camera, ClusterStats& stats)
+    {
+        const Model::Mesh::Lod& range = model.GetLod(lod);
+        if (!m_cluster_culling || range.meshlet_count == 0)
+        {
+            model.Draw(command_buffer, lod);
+            stats.triangles += range.index_count / 3;
+            stats.draws++;
+            return;
+        }
+
+        // the frustum planes of the combined matrix are in model space (Gribb and Hartmann), so the
+        // meshlet bounds can be tested as they are, even under non-uniform scaling. the depth range is 0 to 1
+        const glm::mat4& projection = camera.GetProjection();
+        const glm::mat4 view_model = camera.GetView() * model_matrix;
+        const glm::mat4 clip = projection * view_model;
+        const glm::vec4 row0{clip[0][0], clip[1][0], clip[2][0], clip[3][0]};
+        const glm::vec4 row1{clip[0][1], clip[1][1], clip[2][1], clip[3][1]};
+        const glm::vec4 row2{clip[0][2], clip[1][2], clip[2][2], clip[3][2]};
+        const glm::vec4 row3{clip[0][3], clip[1][3], clip[2][3], clip[3][3]};
+        const glm::vec4 planes[6] = {row3 + row0, row3 - row0, row3 + row1, row3 - row1, row2, row3 - row2};
+        float plane_lengths[6];
+        for (int i = 0; i < 6; i++) { plane_lengths[i] = glm::length(glm::vec3(planes[i])); }
+
+        // a triangle faces away from the camera when the camera is behind its plane, which is preserved by
+        // the model matrix, so the test is done in model space too. an orthographic camera looks along
+        // the same direction everywhere
+        const glm::mat4 model_view_inverse = glm::inverse(view_model);
+        const bool perspective = projection[2][3] != 0.0f;
+        const glm::vec3 eye = glm::vec3(model_view_inverse[3]);
+        const glm::vec3 forward = glm::vec3(model_view_inverse * glm::vec4(0.0f, 0.0f, 1.0f, 0.0f));
+
+        const std::vector<Model::Mesh::Meshlet>& meshlets = model.GetMeshlets();
+        uint32_t run_first = 0;
+        uint32_t run_count = 0;
+        for (uint32_t m = range.first_meshlet; m < range.first_meshlet + range.meshlet_count; m++)
+        {
+            const Model::Mesh::Meshlet& meshlet = meshlets[m];
+            stats.meshlets++;
+
+            bool visible = true;
+            for (int i = 0; i < 6 && visible; i++)
+            {
+                visible = glm::dot(glm::vec3(planes[i]), meshlet.center) + planes[i].w >= -meshlet.radius * plane_lengths[i];
+            }
+            if (!visible)
+            {
+                stats.frustum_culled++;
+                continue;
+            }
+
+            // every triangle faces away if the direction to the nearest point of the bounding sphere is
+            // within 90 degrees of every normal in the cone
+            if (meshlet.cone_cutoff > 0.0f)
+            {
+                const glm::vec3 direction = perspective ? meshlet.center - eye : forward;
+                const float margin = perspective ? meshlet.radius : 0.0f;
+                const float along = glm::dot(direction, meshlet.cone_axis);
+                const float across = std::sqrt(glm::max(glm::dot(direction, direction) - along * along, 0.0f));
+                const float sine = std::sqrt(1.0f - meshlet.cone_cutoff * meshlet.cone_cutoff);
+                if (along * meshlet.cone_cutoff - across * sine >= margin)
+                {
+                    stats.backface_culled++;
+                    continue;
+                }
+            }
+
+            stats.triangles += meshlet.triangle_count;
+            if (run_count > 0 && run_first + run_count == meshlet.first_index)
+            {
+                run_count += 3 * meshlet.triangle_count;
+                continue;
+            }
+            if (run_count > 0)
+            {
+                model.DrawRange(command_buffer, run_first, run_count);
+                stats.draws++;
+            }
+            run_first = meshlet.first_index;
+            run_count = 3 * meshlet.triangle_count;
+        }
+        if (run_count > 0)
+        {
+            model.DrawRange(command_buffer, run_first, run_count);
+            stats.draws++;
         }
     }
 } // namespace DORY
\ No newline at end of file
@@ -10,7 +10,9 @@
 #include "renderer/swapchain.h"
 #include "utils/nocopy.h"
 
+#include <array>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace DORY
@@ -22,6 +24,24 @@ namespace DORY
     class RendererSystem : public NoCopy
     {
         public:
+            /**
+             * @brief what RenderObjects() drew in the last frame
+             */
+            struct ClusterStats
+            {
+                uint32_t meshlets = 0; // meshlets that were tested
+                uint32_t frustum_culled = 0; // meshlets outside the view frustum
+                uint32_t backface_culled = 0; // meshlets facing away from the camera
+                uint32_t triangles = 0; // triangles drawn, including models without meshlets
+                uint32_t draws = 0; // draw calls recorded
+                uint32_t buffer_binds = 0; // geometry pages bound
+            };
+
+            /**
+             * @brief fewest objects worth recording on a thread of their own
+             */
+            static constexpr size_t MIN_OBJECTS_PER_THREAD = 256;
+
             /**
              * @brief construct a new renderer system on a given device with a given render pass.
              */
@@ -33,11 +53,45 @@ namespace DORY
             ~RendererSystem();
 
             /**
-             * @brief render the application's objects
-             * @param command_buffer the
+             * @brief render the application's objects. they are recorded on several threads into secondary
+             * command buffers from frame_info.secondary_pools, which the frame's command buffer executes
+             * @param frame_info the frame, whose render pass was begun with secondary command buffer contents
              */
             void RenderObjects(FrameInfo frame_info);
 
+            /**
+             * @brief set the global level of detail bias. every unit doubles the screen space error that
+             * is accepted, so positive values draw coarser levels and negative values finer ones
+             * @param bias the bias, 0 by default
+             */
+            void SetLodBias(float bias) { m_lod_bias = bias; }
+
+            /**
+             * @brief set how far a level of detail may deviate from the full mesh on screen
+             * @param threshold error as a fraction of the screen height
+             */
+            void SetLodThreshold(float threshold) { m_lod_threshold = threshold; }
+
+            /**
+             * @brief set the width of the band around the threshold in which an object keeps its current
+             * level, so that objects near the threshold do not switch back and forth every frame
+             * @param hysteresis fraction of the threshold
+             */
+            void SetLodHysteresis(float hysteresis) { m_lod_hysteresis = hysteresis; }
+
+            /**
+             * @brief enable or disable culling the meshlets of models that have them. when disabled every
+             * model is drawn with a single call per level of detail
+             * @param enabled true by default
+             */
+            void SetClusterCulling(bool enabled) { m_cluster_culling = enabled; }
+
+            /**
+             * @brief get what was drawn in the last frame, for profiling
+             * @return const ClusterStats&
+             */
+            const ClusterStats& GetClusterStats() const { return m_cluster_stats; }
+
         private: // methods    
             /**
              * @brief initialize the layout for the graphcis pipeline that the renderer will use
@@ -45,14 +99,69 @@ namespace DORY
             void CreatePipelineLayout(VkDescriptorSetLayout descriptor_set_layout);
 
             /**
-             * @brief initialize the graphics pipeline that the renderer will use
+             * @brief initialize the graphics pipelines that the renderer will use, one per vertex format
              */
-            void CreatePipeline(VkRenderPass render_pass);
+            void CreatePipelines(VkRenderPass render_pass);
+
+            /**
+             * @brief record a range of m_draw_order. called on several threads at once with distinct ranges
+             * @param command_buffer the secondary command buffer to record into
+             * @param frame_info the frame
+             * @param begin first object of the range
+             * @param end one past the last object of the range
+             * @param stats the thread's counters
+             */
+            void RecordObjects(VkCommandBuffer command_buffer, const FrameInfo& frame_info, size_t begin, size_t end, ClusterStats& stats);
+
+            /**
+             * @brief choose the coarsest level of detail of an object whose error projected onto the screen
+             * stays below the threshold, keeping the current level while it is within the hysteresis band
+             * @param object the object to draw
+             * @param model_matrix the model matrix of the object
+             * @param camera the camera the object is seen through
+             * @param current the level the object was last drawn with, updated to the returned level
+             * @return uint32_t the level to draw
+             */
+            uint32_t SelectLod(const Object& object, const glm::mat4& model_matrix, const Camera& camera, uint32_t& current);
+
+            /**
+             * @brief draw one level of detail of a model. if it has meshlets, the ones outside the view
+             * frustum or facing away from the camera are skipped, and runs of visible meshlets are merged
+             * into a single draw since they are contiguous in the index buffer
+             * @param command_buffer the command buffer to record into, with the model bound
+             * @param model the model to draw
+             * @param lod the level to draw
+             * @param model_matrix the model matrix of the object
+             * @param camera the camera the object is seen through
+             * @param stats the counters to add to
+             */
+            void DrawModel(VkCommandBuffer command_buffer, Model& model, uint32_t lod, const glm::mat4& model_matrix, const Camera& camera, ClusterStats& stats);
+
+        private: // types
+            /**
+             * @brief the level of detail an object was last drawn with
+             */
+            struct ObjectLod
+            {
+                uint32_t lod = 0; // level of detail, see SelectLod()
+                uint64_t frame = 0; // frame the object was last drawn in
+            };
             
         private: // members
             Device& m_device; // the device that the renderer will use
-            std::unique_ptr<Pipeline> m_pipeline; // the renderer's graphics pipeline
+            std::array<std::unique_ptr<Pipeline>, static_cast<size_t>(Model::VertexFormat::Count)> m_pipelines{}; // the renderer's graphics pipelines, indexed by vertex format
             VkPipelineLayout m_pipeline_layout; // the layout/specs for the renderer's graphics pipeline
+
+            std::vector<const Object*> m_draw_order{}; // objects with a model, sorted by vertex format and geometry page. kept to reuse its storage
+            std::unordered_map<uint32_t, ObjectLod> m_object_lods{}; // level of detail of each object drawn in the last frame, by object id
+            std::vector<uint32_t*> m_draw_lods{}; // entry of m_object_lods of each object of m_draw_order
+            std::vector<VkCommandBuffer> m_secondary_command_buffers{}; // one per recording thread, executed in order
+            std::vector<ClusterStats> m_thread_stats{}; // counters of each recording thread, added up into m_cluster_stats
+            float m_lod_bias = 0.0f; // see SetLodBias()
+            float m_lod_threshold = 0.002f; // see SetLodThreshold(), about a pixel at the default window height
+            float m_lod_hysteresis = 0.25f; // see SetLodHysteresis()
+            bool m_cluster_culling = true; // see SetClusterCulling()
+            ClusterStats m_cluster_stats{}; // see GetClusterStats()
     }; // class RendererSystem
 } // namespace DORY
 
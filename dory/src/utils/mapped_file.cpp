@@ -0,0 +1,84 @@
+#include "utils/mapped_file.h"
+
+#if defined(_WIN64)
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace DORY
+{
+#if defined(_WIN64)
+    MappedFile::MappedFile(const std::string& file_path)
+    {
+        HANDLE file = CreateFileA(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) { return; }
+
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+        {
+            CloseHandle(file);
+            return;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr)
+        {
+            CloseHandle(file);
+            return;
+        }
+
+        void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (data == nullptr)
+        {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return;
+        }
+
+        m_file_handle = file;
+        m_mapping_handle = mapping;
+        m_data = static_cast<const char*>(data);
+        m_size = static_cast<size_t>(file_size.QuadPart);
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (m_data != nullptr) { UnmapViewOfFile(m_data); }
+        if (m_mapping_handle != nullptr) { CloseHandle(m_mapping_handle); }
+        if (m_file_handle != nullptr) { CloseHandle(m_file_handle); }
+    }
+#else
+    MappedFile::MappedFile(const std::string& file_path)
+    {
+        int file = open(file_path.c_str(), O_RDONLY);
+        if (file < 0) { return; }
+
+        struct stat file_info;
+        if (fstat(file, &file_info) != 0 || file_info.st_size == 0)
+        {
+            close(file);
+            return;
+        }
+
+        void* data = mmap(nullptr, static_cast<size_t>(file_info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        // the mapping keeps its own reference to the file, so the descriptor is no longer needed
+        close(file);
+        if (data == MAP_FAILED) { return; }
+
+        m_data = static_cast<const char*>(data);
+        m_size = static_cast<size_t>(file_info.st_size);
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (m_data != nullptr)
+        {
+            munmap(const_cast<char*>(m_data), m_size);
+        }
+    }
+#endif
+} // namespace DORY
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef DORY_MAPPED_FILE_INCL
+#define DORY_MAPPED_FILE_INCL
+
+#include "utils/nocopy.h"
+
+#include <cstddef>
+#include <string>
+
+namespace DORY
+{
+    /**
+     * @brief read-only memory mapping of a file. the contents are paged in by the operating system on
+     * demand, so large files can be read without first copying them into a buffer. the mapping is
+     * released when the object is destroyed.
+     */
+    class MappedFile : public NoCopy
+    {
+        public:
+            /**
+             * @brief map the file at the given path. if the file cannot be opened or mapped, IsOpen()
+             * returns false and the object holds no mapping.
+             * @param file_path path to the file to map
+             */
+            MappedFile(const std::string& file_path);
+
+            /**
+             * @brief unmap the file
+             */
+            ~MappedFile();
+
+            /**
+             * @brief check whether the file was mapped successfully
+             * @return true
+             * @return false
+             */
+            bool IsOpen() const { return m_data != nullptr; }
+
+            /**
+             * @brief get a pointer to the first byte of the mapping
+             * @return const char*
+             */
+            const char* GetData() const { return m_data; }
+
+            /**
+             * @brief get the size of the mapping in bytes
+             * @return size_t
+             */
+            size_t GetSize() const { return m_size; }
+
+        private: // members
+            const char* m_data = nullptr; // pointer to the mapped file contents
+            size_t m_size = 0; // size of the mapped file in bytes
+            #if defined(_WIN64)
+                void* m_file_handle = nullptr; // win32 file handle
+                void* m_mapping_handle = nullptr; // win32 file mapping handle
+            #endif
+    }; // class MappedFile
+} // namespace DORY
+
+#endif // DORY_MAPPED_FILE_INCL
\ No newline at end of file
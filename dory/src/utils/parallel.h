@@ -0,0 +1,25 @@
+#ifndef DORY_PARALLEL_INCL
+#define DORY_PARALLEL_INCL
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+
+namespace DORY
+{
+    namespace Utils
+    {
+        /**
+         * @brief resolve a requested number of worker threads. 0 means one per hardware thread
+         * @param thread_count requested number of threads
+         * @return uint32_t at least 1
+         */
+        inline uint32_t GetThreadCount(uint32_t thread_count = 0)
+        {
+            if (thread_count == 0) { thread_count = std::thread::hardware_concurrency(); }
+            return std::max(1u, thread_count);
+        }
+    } // namespace Utils
+} // namespace DORY
+
+#endif // DORY_PARALLEL_INCL
\ No newline at end of file
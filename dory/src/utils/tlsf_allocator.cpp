@@ -0,0 +1,244 @@
+#include "utils/tlsf_allocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace DORY
+{
+    // value must not be 0
+#if defined(_MSC_VER)
+    static inline uint32_t FloorLog2(uint64_t value)
+    {
+        unsigned long index = 0;
+        _BitScanReverse64(&index, value);
+        return static_cast<uint32_t>(index);
+    }
+
+    static inline uint32_t LowestBit(uint64_t value)
+    {
+        unsigned long index = 0;
+        _BitScanForward64(&index, value);
+        return static_cast<uint32_t>(index);
+    }
+#else
+    static inline uint32_t FloorLog2(uint64_t value) { return 63u - static_cast<uint32_t>(__builtin_clzll(value)); }
+    static inline uint32_t LowestBit(uint64_t value) { return static_cast<uint32_t>(__builtin_ctzll(value)); }
+#endif
+
+    TlsfAllocator::TlsfAllocator(uint64_t size)
+        : m_size(size)
+    {
+        m_heads.fill(INVALID_NODE);
+        if (size == 0) { return; }
+
+        const uint32_t node = NewNode();
+        m_nodes[node].offset = 0;
+        m_nodes[node].size = size;
+        InsertFree(node);
+    }
+
+    void TlsfAllocator::Mapping(uint64_t size, uint32_t& fl, uint32_t& sl)
+    {
+        // sizes below SL_COUNT get one list each in the first row, larger sizes are split by their
+        // highest bit and the SL_BITS bits below it
+        if (size < SL_COUNT)
+        {
+            fl = 0;
+            sl = static_cast<uint32_t>(size);
+            return;
+        }
+
+        const uint32_t log2 = FloorLog2(size);
+        sl = static_cast<uint32_t>(size >> (log2 - SL_BITS)) ^ SL_COUNT;
+        fl = log2 - SL_BITS + 1;
+    }
+
+    bool TlsfAllocator::Allocate(uint64_t size, uint64_t alignment, Allocation& allocation)
+    {
+        assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "alignment must be a power of two");
+        size = std::max<uint64_t>(size, 1);
+
+        // any range of this size can hold the allocation wherever the alignment puts it, and rounding up
+        // to the next list boundary means every range in the list found is large enough
+        const uint64_t needed = size + alignment - 1;
+        if (needed > m_size) { return false; }
+        uint64_t search = needed;
+        if (search >= SL_COUNT) { search += (uint64_t{1} << (FloorLog2(search) - SL_BITS)) - 1; }
+
+        uint32_t node = INVALID_NODE;
+        uint32_t fl, sl;
+        Mapping(search, fl, sl);
+        uint32_t sl_map = fl < FL_COUNT ? m_sl_bitmaps[fl] & (~0u << sl) : 0;
+        if (sl_map == 0)
+        {
+            const uint64_t fl_map = fl + 1 < 64 ? m_fl_bitmap & (~uint64_t{0} << (fl + 1)) : 0;
+            if (fl_map != 0)
+            {
+                fl = LowestBit(fl_map);
+                sl_map = m_sl_bitmaps[fl];
+            }
+        }
+        if (sl_map != 0) { node = m_heads[fl * SL_COUNT + LowestBit(sl_map)]; }
+
+        // nothing in the larger lists, but the list the request itself falls in may still hold a range
+        // that fits, e.g. when the whole address space is asked for
+        if (node == INVALID_NODE)
+        {
+            Mapping(needed, fl, sl);
+            for (uint32_t candidate = m_heads[fl * SL_COUNT + sl]; candidate != INVALID_NODE; candidate = m_nodes[candidate].next_free)
+            {
+                if (m_nodes[candidate].size >= needed)
+                {
+                    node = candidate;
+                    break;
+                }
+            }
+            if (node == INVALID_NODE) { return false; }
+        }
+        RemoveFree(node);
+
+        // the padding in front of the aligned offset and the rest after the allocation go back to the
+        // free lists
+        const uint64_t padding = ((m_nodes[node].offset + alignment - 1) & ~(alignment - 1)) - m_nodes[node].offset;
+        if (padding > 0)
+        {
+            const uint32_t aligned = SplitFree(node, m_nodes[node].size - padding);
+            InsertFree(node);
+            node = aligned;
+        }
+        if (m_nodes[node].size > size)
+        {
+            InsertFree(SplitFree(node, m_nodes[node].size - size));
+        }
+
+        m_nodes[node].free = false;
+        m_used_size += m_nodes[node].size;
+        m_allocation_count++;
+
+        allocation.offset = m_nodes[node].offset;
+        allocation.size = m_nodes[node].size;
+        allocation.node = node;
+        return true;
+    }
+
+    void TlsfAllocator::Free(uint32_t node)
+    {
+        assert(node < m_nodes.size() && !m_nodes[node].free && "range is not allocated");
+        m_used_size -= m_nodes[node].size;
+        m_allocation_count--;
+
+        // merge with the free ranges on either side
+        const uint32_t next = m_nodes[node].next_physical;
+        if (next != INVALID_NODE && m_nodes[next].free)
+        {
+            RemoveFree(next);
+            m_nodes[node].size += m_nodes[next].size;
+            m_nodes[node].next_physical = m_nodes[next].next_physical;
+            if (m_nodes[next].next_physical != INVALID_NODE) { m_nodes[m_nodes[next].next_physical].prev_physical = node; }
+            m_unused_nodes.push_back(next);
+        }
+
+        const uint32_t prev = m_nodes[node].prev_physical;
+        if (prev != INVALID_NODE && m_nodes[prev].free)
+        {
+            RemoveFree(prev);
+            m_nodes[prev].size += m_nodes[node].size;
+            m_nodes[prev].next_physical = m_nodes[node].next_physical;
+            if (m_nodes[node].next_physical != INVALID_NODE) { m_nodes[m_nodes[node].next_physical].prev_physical = prev; }
+            m_unused_nodes.push_back(node);
+            node = prev;
+        }
+
+        InsertFree(node);
+    }
+
+    uint64_t TlsfAllocator::GetLargestFreeRange() const
+    {
+        if (m_fl_bitmap == 0) { return 0; }
+
+        // every range in the highest non-empty list is larger than all ranges in lower lists
+        const uint32_t fl = FloorLog2(m_fl_bitmap);
+        const uint32_t sl = FloorLog2(m_sl_bitmaps[fl]);
+        uint64_t largest = 0;
+        for (uint32_t node = m_heads[fl * SL_COUNT + sl]; node != INVALID_NODE; node = m_nodes[node].next_free)
+        {
+            largest = std::max(largest, m_nodes[node].size);
+        }
+        return largest;
+    }
+
+    uint32_t TlsfAllocator::NewNode()
+    {
+        if (!m_unused_nodes.empty())
+        {
+            const uint32_t node = m_unused_nodes.back();
+            m_unused_nodes.pop_back();
+            m_nodes[node] = Node{};
+            return node;
+        }
+
+        m_nodes.emplace_back();
+        return static_cast<uint32_t>(m_nodes.size() - 1);
+    }
+
+    void TlsfAllocator::InsertFree(uint32_t node)
+    {
+        uint32_t fl, sl;
+        Mapping(m_nodes[node].size, fl, sl);
+        uint32_t& head = m_heads[fl * SL_COUNT + sl];
+
+        m_nodes[node].free = true;
+        m_nodes[node].prev_free = INVALID_NODE;
+        m_nodes[node].next_free = head;
+        if (head != INVALID_NODE) { m_nodes[head].prev_free = node; }
+        head = node;
+
+        m_fl_bitmap |= uint64_t{1} << fl;
+        m_sl_bitmaps[fl] |= 1u << sl;
+    }
+
+    void TlsfAllocator::RemoveFree(uint32_t node)
+    {
+        uint32_t fl, sl;
+        Mapping(m_nodes[node].size, fl, sl);
+        uint32_t& head = m_heads[fl * SL_COUNT + sl];
+
+        const uint32_t prev = m_nodes[node].prev_free;
+        const uint32_t next = m_nodes[node].next_free;
+        if (prev != INVALID_NODE) { m_nodes[prev].next_free = next; }
+        if (next != INVALID_NODE) { m_nodes[next].prev_free = prev; }
+        if (head == node) { head = next; }
+
+        if (head == INVALID_NODE)
+        {
+            m_sl_bitmaps[fl] &= ~(1u << sl);
+            if (m_sl_bitmaps[fl] == 0) { m_fl_bitmap &= ~(uint64_t{1} << fl); }
+        }
+
+        m_nodes[node].free = false;
+        m_nodes[node].prev_free = INVALID_NODE;
+        m_nodes[node].next_free = INVALID_NODE;
+    }
+
+    uint32_t TlsfAllocator::SplitFree(uint32_t node, uint64_t size)
+    {
+        // NewNode() may move the nodes, so nothing refers into m_nodes across it
+        const uint32_t split = NewNode();
+        Node& original = m_nodes[node];
+        Node& rest = m_nodes[split];
+
+        rest.offset = original.offset + original.size - size;
+        rest.size = size;
+        rest.prev_physical = node;
+        rest.next_physical = original.next_physical;
+        if (original.next_physical != INVALID_NODE) { m_nodes[original.next_physical].prev_physical = split; }
+
+        original.size -= size;
+        original.next_physical = split;
+        return split;
+    }
+} // namespace DORY
\ No newline at end of file
@@ -0,0 +1,146 @@
+#ifndef DORY_TLSF_ALLOCATOR_INCL
+#define DORY_TLSF_ALLOCATOR_INCL
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace DORY
+{
+    /**
+     * @brief two-level segregated fit allocator (Masmano et al. 2004) handing out ranges of a fixed
+     * address space, e.g. a block of device memory. it never touches the memory itself, so it works for
+     * memory the CPU cannot see. free ranges are kept in lists bucketed first by the power of two of their
+     * size and then by SL_COUNT linear steps within it; two bitmaps find a non-empty list that is large
+     * enough in constant time, and freed ranges are merged with their free neighbours right away.
+     */
+    class TlsfAllocator
+    {
+        public:
+            /**
+             * @brief returned as the node of a failed allocation
+             */
+            static constexpr uint32_t INVALID_NODE = UINT32_MAX;
+
+            /**
+             * @brief an allocated range
+             */
+            struct Allocation
+            {
+                uint64_t offset = 0; // first byte of the range
+                uint64_t size = 0; // number of bytes of the range
+                uint32_t node = INVALID_NODE; // handle to pass to Free()
+            };
+
+            /**
+             * @brief create an allocator with a single free range
+             * @param size number of bytes to manage
+             */
+            explicit TlsfAllocator(uint64_t size);
+
+            /**
+             * @brief allocate an aligned range
+             * @param size number of bytes
+             * @param alignment required alignment of the offset, a power of two
+             * @param allocation set to the allocated range on success
+             * @return true if there was a free range large enough
+             * @return false
+             */
+            bool Allocate(uint64_t size, uint64_t alignment, Allocation& allocation);
+
+            /**
+             * @brief free a range, merging it with its free neighbours
+             * @param node the node of the allocation
+             */
+            void Free(uint32_t node);
+
+            /**
+             * @brief get the number of bytes managed
+             * @return uint64_t
+             */
+            uint64_t GetSize() const { return m_size; }
+
+            /**
+             * @brief get the number of bytes in allocated ranges
+             * @return uint64_t
+             */
+            uint64_t GetUsedSize() const { return m_used_size; }
+
+            /**
+             * @brief get the number of allocated ranges
+             * @return uint32_t
+             */
+            uint32_t GetAllocationCount() const { return m_allocation_count; }
+
+            /**
+             * @brief get the size of the largest free range
+             * @return uint64_t
+             */
+            uint64_t GetLargestFreeRange() const;
+
+            /**
+             * @brief check whether nothing is allocated
+             * @return true
+             * @return false
+             */
+            bool IsEmpty() const { return m_allocation_count == 0; }
+
+        private: // methods
+            /**
+             * @brief find the list a free range of the given size belongs to
+             */
+            static void Mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+
+            /**
+             * @brief get a node that is not in use, growing the node pool if needed
+             */
+            uint32_t NewNode();
+
+            /**
+             * @brief put a free range at the head of its list
+             */
+            void InsertFree(uint32_t node);
+
+            /**
+             * @brief take a free range out of its list
+             */
+            void RemoveFree(uint32_t node);
+
+            /**
+             * @brief split the end off a range as a new free range
+             * @return the node of the new range
+             */
+            uint32_t SplitFree(uint32_t node, uint64_t size);
+
+        private: // members
+            static constexpr uint32_t SL_BITS = 5; // log2 of the number of second level lists
+            static constexpr uint32_t SL_COUNT = 1 << SL_BITS; // second level lists per first level
+            static constexpr uint32_t FL_COUNT = 64 - SL_BITS + 1; // first level lists, enough for any 64 bit size
+
+            /**
+             * @brief a range of the address space. the ranges are linked in address order, and the free
+             * ones also into the list of their size
+             */
+            struct Node
+            {
+                uint64_t offset = 0;
+                uint64_t size = 0;
+                uint32_t prev_physical = INVALID_NODE; // range just before this one
+                uint32_t next_physical = INVALID_NODE; // range just after this one
+                uint32_t prev_free = INVALID_NODE; // previous range in the same free list
+                uint32_t next_free = INVALID_NODE; // next range in the same free list
+                bool free = false;
+            };
+
+            uint64_t m_size = 0; // number of bytes managed
+            uint64_t m_used_size = 0; // bytes in allocated ranges
+            uint32_t m_allocation_count = 0; // number of allocated ranges
+            std::vector<Node> m_nodes{}; // every range, free or not, plus unused nodes
+            std::vector<uint32_t> m_unused_nodes{}; // nodes that can be reused
+            uint64_t m_fl_bitmap = 0; // bit fl is set if any list of that first level is not empty
+            std::array<uint32_t, FL_COUNT> m_sl_bitmaps{}; // bit sl is set if list [fl][sl] is not empty
+            std::array<uint32_t, FL_COUNT * SL_COUNT> m_heads{}; // first range of each free list
+    }; // class TlsfAllocator
+} // namespace DORY
+
+#endif // DORY_TLSF_ALLOCATOR_INCL
\ No newline at end of file
@@ -0,0 +1,140 @@
+#ifndef DORY_WORK_STEALING_DEQUE_INCL
+#define DORY_WORK_STEALING_DEQUE_INCL
+
+#include "utils/nocopy.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace DORY
+{
+    /**
+     * @brief the lock-free deque of Chase and Lev, with the memory orderings of Le et al., "Correct and
+     * Efficient Work-Stealing for Weak Memory Models" (2013). the thread owning the deque pushes and pops
+     * at the bottom, any other thread steals from the top, so the owner works on what it queued last while
+     * thieves take the oldest items. the array doubles when it is full; replaced arrays are kept until the
+     * deque is destroyed, since a thief may still be reading them.
+     * @tparam T a trivially copyable type, usually a pointer
+     */
+    template<typename T>
+    class WorkStealingDeque : public NoCopy
+    {
+        public:
+            /**
+             * @brief create an empty deque
+             * @param capacity (optional) initial number of items, a power of two
+             */
+            explicit WorkStealingDeque(int64_t capacity = 1024)
+            {
+                m_arrays.push_back(std::make_unique<Array>(capacity));
+                m_array.store(m_arrays.back().get(), std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief add an item at the bottom. only the owner may call this
+             * @param item the item
+             */
+            void Push(T item)
+            {
+                const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+                const int64_t top = m_top.load(std::memory_order_acquire);
+                Array* array = m_array.load(std::memory_order_relaxed);
+                if (bottom - top > array->capacity - 1)
+                {
+                    m_arrays.push_back(array->Grow(top, bottom));
+                    array = m_arrays.back().get();
+                    m_array.store(array, std::memory_order_release);
+                }
+                array->Put(bottom, item);
+                m_bottom.store(bottom + 1, std::memory_order_release);
+            }
+
+            /**
+             * @brief take the item at the bottom. only the owner may call this
+             * @param item set to the item
+             * @return true if there was an item
+             */
+            bool Pop(T& item)
+            {
+                const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+                Array* array = m_array.load(std::memory_order_relaxed);
+                m_bottom.store(bottom, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                int64_t top = m_top.load(std::memory_order_relaxed);
+
+                if (top > bottom)
+                {
+                    m_bottom.store(bottom + 1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                item = array->Get(bottom);
+                if (top < bottom) { return true; }
+
+                // the last item, which a thief may be taking at the same time
+                const bool won = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                m_bottom.store(bottom + 1, std::memory_order_relaxed);
+                return won;
+            }
+
+            /**
+             * @brief take the item at the top. any thread may call this
+             * @param item set to the item
+             * @return true if an item was taken. false if the deque was empty or another thread took the item first
+             */
+            bool Steal(T& item)
+            {
+                int64_t top = m_top.load(std::memory_order_acquire);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+                if (top >= bottom) { return false; }
+
+                Array* array = m_array.load(std::memory_order_acquire);
+                item = array->Get(top);
+                return m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief get the number of items, which may be out of date as soon as it is returned
+             * @return int64_t
+             */
+            int64_t GetSize() const
+            {
+                const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+                const int64_t top = m_top.load(std::memory_order_relaxed);
+                return bottom > top ? bottom - top : 0;
+            }
+
+        private: // types
+            /**
+             * @brief circular array of the items
+             */
+            struct Array
+            {
+                int64_t capacity;
+                std::unique_ptr<std::atomic<T>[]> items;
+
+                explicit Array(int64_t capacity_) : capacity(capacity_), items(new std::atomic<T>[capacity_]) {}
+
+                T Get(int64_t i) const { return items[i & (capacity - 1)].load(std::memory_order_relaxed); }
+                void Put(int64_t i, T item) { items[i & (capacity - 1)].store(item, std::memory_order_relaxed); }
+
+                std::unique_ptr<Array> Grow(int64_t top, int64_t bottom) const
+                {
+                    auto array = std::make_unique<Array>(2 * capacity);
+                    for (int64_t i = top; i < bottom; i++) { array->Put(i, Get(i)); }
+                    return array;
+                }
+            };
+
+        private: // members
+            std::atomic<int64_t> m_top{0}; // next item to steal
+            std::atomic<int64_t> m_bottom{0}; // next free slot of the owner
+            std::atomic<Array*> m_array{nullptr}; // the current array
+            std::vector<std::unique_ptr<Array>> m_arrays{}; // every array, only touched by the owner
+    }; // class WorkStealingDeque
+} // namespace DORY
+
+#endif // DORY_WORK_STEALING_DEQUE_INCL
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include "utils/parallel.h"
+#include "utils/worker_pool.h"
+
+namespace DORY
+{
+    WorkerPool::WorkerPool(uint32_t thread_count)
+    {
+        thread_count = Utils::GetThreadCount(thread_count);
+        m_threads.reserve(thread_count);
+        for (uint32_t i = 0; i < thread_count; i++)
+        {
+            m_threads.emplace_back([this]() { WorkerLoop(); });
+        }
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+        for (auto& thread : m_threads) { thread.join(); }
+    }
+
+    void WorkerPool::Submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+        }
+        m_condition.notify_one();
+    }
+
+    void WorkerPool::WorkerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+                if (m_tasks.empty()) { return; }
+
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+        }
+    }
+} // namespace DORY
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef DORY_WORKER_POOL_INCL
+#define DORY_WORKER_POOL_INCL
+
+#include "utils/nocopy.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace DORY
+{
+    /**
+     * @brief a fixed set of background threads that run tasks in the order they are submitted. meant for
+     * long running work such as loading files that must not stall the thread submitting it.
+     */
+    class WorkerPool : public NoCopy
+    {
+        public:
+            /**
+             * @brief start the worker threads
+             * @param thread_count (optional) number of threads. 0 uses one per hardware thread
+             */
+            explicit WorkerPool(uint32_t thread_count = 0);
+
+            /**
+             * @brief finish the tasks that were already submitted and stop the worker threads
+             */
+            ~WorkerPool();
+
+            /**
+             * @brief queue a task to run on one of the worker threads. the task must not throw
+             * @param task the function to run
+             */
+            void Submit(std::function<void()> task);
+
+            /**
+             * @brief get the number of worker threads
+             * @return uint32_t
+             */
+            uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_threads.size()); }
+
+        private: // methods
+            /**
+             * @brief loop run by each worker thread
+             */
+            void WorkerLoop();
+
+        private: // members
+            std::vector<std::thread> m_threads{}; // the worker threads
+            std::deque<std::function<void()>> m_tasks{}; // tasks waiting for a thread
+            std::mutex m_mutex{}; // guards m_tasks and m_stopping
+            std::condition_variable m_condition{}; // signalled when a task is queued or the pool stops
+            bool m_stopping = false; // set when the pool is destroyed
+    }; // class WorkerPool
+} // namespace DORY
+
+#endif // DORY_WORKER_POOL_INCL
\ No newline at end of file
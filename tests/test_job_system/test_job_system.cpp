@@ -0,0 +1,200 @@
+#include "core/job_system.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+// benchmarks the JobSystem: the cost of queueing and running an empty job, how a parallel-for scales with
+// the number of threads, and jobs that spawn and wait for jobs of their own. also checks that every job
+// runs exactly once, that jobs with main thread affinity only run on the main thread and that threads
+// outside of the system only run their own jobs while they wait.
+// usage: test_job_system [job count]
+
+using namespace DORY;
+
+/**
+ * @brief seconds since an earlier time point
+ */
+static double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief queue empty jobs from the main thread and wait for them
+ * @return true if every job ran
+ */
+static bool BenchmarkSpawn(JobSystem& jobs, size_t job_count)
+{
+    std::atomic<size_t> ran{0};
+    JobCounter counter;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < job_count; i++)
+    {
+        jobs.Run([&ran]() { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+    }
+    jobs.Wait(counter);
+    const double seconds = SecondsSince(start);
+
+    printf("    spawn: %8.1f ns per job, %zu jobs\n", seconds * 1e9 / static_cast<double>(job_count), job_count);
+    return ran.load() == job_count;
+}
+
+/**
+ * @brief spawn a binary tree of jobs, each waiting for its two children, to exercise stealing
+ * @return number of leaves run
+ */
+static size_t SpawnTree(JobSystem& jobs, uint32_t depth)
+{
+    if (depth == 0) { return 1; }
+
+    size_t left = 0;
+    size_t right = 0;
+    JobCounter counter;
+    jobs.Run([&]() { left = SpawnTree(jobs, depth - 1); }, &counter);
+    jobs.Run([&]() { right = SpawnTree(jobs, depth - 1); }, &counter);
+    jobs.Wait(counter);
+    return left + right;
+}
+
+/**
+ * @brief some floating point work per item, enough that the loop is bound by the arithmetic
+ */
+static double Work(size_t i)
+{
+    double x = static_cast<double>(i);
+    for (int k = 0; k < 64; k++) { x = std::sqrt(x + k) * 1.0001; }
+    return x;
+}
+
+/**
+ * @brief run a parallel-for over a large array with a given number of threads
+ * @return double the time taken in seconds, or a negative value if the result is wrong
+ */
+static double BenchmarkParallelFor(uint32_t thread_count, const std::vector<double>& expected)
+{
+    JobSystem jobs(thread_count);
+    std::vector<double> results(expected.size());
+
+    const auto start = std::chrono::steady_clock::now();
+    jobs.ParallelFor(results.size(), 4096, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++) { results[i] = Work(i); }
+    });
+    const double seconds = SecondsSince(start);
+    return results == expected ? seconds : -1.0;
+}
+
+/**
+ * @brief queue jobs with main thread affinity from worker jobs
+ * @return true if they all ran on the main thread
+ */
+static bool TestMainThreadAffinity(JobSystem& jobs)
+{
+    const std::thread::id main_thread = std::this_thread::get_id();
+    std::atomic<uint32_t> on_main{0};
+    std::atomic<uint32_t> ran{0};
+    JobCounter counter;
+    jobs.RunParallel(64, [&](size_t)
+    {
+        jobs.Run([&]()
+        {
+            ran.fetch_add(1);
+            if (std::this_thread::get_id() == main_thread) { on_main.fetch_add(1); }
+        }, &counter, JobSystem::Affinity::MainThread);
+    });
+    jobs.Wait(counter);
+    return ran.load() == 64 && on_main.load() == 64;
+}
+
+/**
+ * @brief wait for jobs from a thread outside of the system while a job of another outside thread is queued
+ * @return true if the waiting thread only ran its own jobs
+ */
+static bool TestOutsideWait(JobSystem& jobs)
+{
+    std::thread::id foreign_thread{};
+    JobCounter foreign;
+    std::thread([&]() { jobs.Run([&]() { foreign_thread = std::this_thread::get_id(); }, &foreign); }).join();
+
+    std::thread::id waiting_thread{};
+    std::atomic<uint32_t> ran{0};
+    std::thread waiter([&]()
+    {
+        waiting_thread = std::this_thread::get_id();
+        jobs.RunParallel(16, [&](size_t) { ran.fetch_add(1); });
+    });
+    waiter.join();
+    jobs.Wait(foreign);
+    return ran.load() == 16 && foreign_thread != waiting_thread;
+}
+
+int main(int argc, char** argv)
+{
+    const size_t job_count = argc > 1 ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) : 1000000;
+    const uint32_t hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+    bool success = true;
+
+    {
+        JobSystem jobs;
+        printf("%u threads\n", jobs.GetThreadCount());
+
+        const bool spawned = BenchmarkSpawn(jobs, job_count);
+        printf("    spawn:    %s\n", spawned ? "ok" : "MISSING JOBS");
+
+        const uint32_t depth = 16;
+        const auto start = std::chrono::steady_clock::now();
+        const size_t leaves = SpawnTree(jobs, depth);
+        const double seconds = SecondsSince(start);
+        printf("    tree:  %8.1f ns per job, %zu jobs\n", seconds * 1e9 / static_cast<double>(2 * leaves - 1), 2 * leaves - 1);
+        printf("    tree:     %s\n", leaves == (size_t{1} << depth) ? "ok" : "MISSING JOBS");
+
+        const bool affinity = TestMainThreadAffinity(jobs);
+        printf("    affinity: %s\n", affinity ? "ok" : "RAN OFF THE MAIN THREAD");
+
+        // a system created and destroyed on the main thread must hand the thread back to this one, or its
+        // main thread jobs would never run again
+        {
+            JobSystem nested(2);
+            nested.RunParallel(16, [](size_t) {});
+        }
+        const bool nested = TestMainThreadAffinity(jobs);
+        printf("    nested:   %s\n", nested ? "ok" : "RAN OFF THE MAIN THREAD");
+
+        // with only the main thread, nobody else takes the queued job while the outside thread waits
+        bool outside = false;
+        {
+            JobSystem single(1);
+            outside = TestOutsideWait(single);
+        }
+        printf("    outside:  %s\n", outside ? "ok" : "RAN ANOTHER THREAD'S JOB");
+        success = spawned && leaves == (size_t{1} << depth) && affinity && nested && outside;
+    }
+
+    std::vector<double> expected(1 << 22);
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < expected.size(); i++) { expected[i] = Work(i); }
+    const double serial = SecondsSince(start);
+    printf("parallel-for over %zu items, serial %.3f s\n", expected.size(), serial);
+
+    for (uint32_t thread_count = 1; ; thread_count = std::min(2 * thread_count, hardware_threads))
+    {
+        const double seconds = BenchmarkParallelFor(thread_count, expected);
+        if (seconds < 0.0)
+        {
+            printf("    %2u threads: WRONG RESULT\n", thread_count);
+            success = false;
+        }
+        else
+        {
+            printf("    %2u threads: %8.3f s (%.2fx)\n", thread_count, seconds, serial / seconds);
+        }
+        if (thread_count == hardware_threads) { break; }
+    }
+    return success ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include "core/timer.h"
+#include "loaders/object_loader.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+// benchmarks ObjectLoader::LoadObj() with the multi-threaded ObjParser against the single-threaded
+// tinyobjloader path and against ObjectLoader::LoadObjStreaming(), and checks that all give the same mesh.
+// usage: test_object_loader [synthetic face count]
+
+/**
+ * @brief write a height field of quads to an .obj file. even rows are written as two triangles, odd
+ * rows as a single quad using relative indices, so both the triangle and quad paths are exercised
+ */
+static void WriteSyntheticObj(const std::string& path, size_t face_count)
+{
+    // every pair of rows of cells holds 3 faces per cell
+    const size_t side = static_cast<size_t>(std::sqrt(static_cast<double>(face_count) / 1.5)) + 1;
+    const size_t vertex_count = (side + 1) * (side + 1);
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "failed to create %s\n", path.c_str());
+        exit(1);
+    }
+
+    fprintf(file, "# synthetic height field, %zu x %zu cells\n", side, side);
+    for (size_t z = 0; z <= side; z++)
+    {
+        for (size_t x = 0; x <= side; x++)
+        {
+            const float height = std::sin(x * 0.05f) * std::cos(z * 0.05f);
+            fprintf(file, "v %.6f %.6f %.6f\n", x * 0.01f, height, z * 0.01f);
+        }
+    }
+    for (size_t z = 0; z <= side; z++)
+    {
+        for (size_t x = 0; x <= side; x++)
+        {
+            fprintf(file, "vt %.6f %.6f\n", x / static_cast<float>(side), z / static_cast<float>(side));
+        }
+    }
+    fprintf(file, "vn 0.0 1.0 0.0\n");
+
+    size_t faces = 0;
+    for (size_t z = 0; z < side && faces < face_count; z++)
+    {
+        for (size_t x = 0; x < side && faces < face_count; x++)
+        {
+            // 1-based indices of the cell corners
+            const long long i0 = static_cast<long long>(z * (side + 1) + x + 1);
+            const long long i1 = i0 + 1;
+            const long long i2 = i1 + static_cast<long long>(side + 1);
+            const long long i3 = i0 + static_cast<long long>(side + 1);
+            if (z % 2 == 0)
+            {
+                fprintf(file, "f %lld/%lld/1 %lld/%lld/1 %lld/%lld/1\n", i0, i0, i1, i1, i2, i2);
+                fprintf(file, "f %lld/%lld/1 %lld/%lld/1 %lld/%lld/1\n", i0, i0, i2, i2, i3, i3);
+                faces += 2;
+            }
+            else
+            {
+                const long long base = static_cast<long long>(vertex_count) + 1;
+                fprintf(file, "f %lld/%lld/-1 %lld/%lld/-1 %lld/%lld/-1 %lld/%lld/-1\n",
+                        i0 - base, i0 - base, i1 - base, i1 - base, i2 - base, i2 - base, i3 - base, i3 - base);
+                faces += 1;
+            }
+        }
+    }
+
+    fclose(file);
+}
+
+static bool MeshesMatch(const DORY::Model::Mesh& a, const DORY::Model::Mesh& b)
+{
+    return a.vertices.size() == b.vertices.size() &&
+           a.indices == b.indices &&
+           memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(DORY::Model::Vertex)) == 0;
+}
+
+/**
+ * @brief load a file with every parser and print the best time of each
+ * @param window_size size of the window the streaming loader reads the file through
+ * @return true if all parsers produced the same mesh
+ */
+static bool Benchmark(const std::string& path, int runs, size_t window_size)
+{
+    DORY::Model::Mesh tinyobj_mesh{};
+    DORY::Model::Mesh parallel_mesh{};
+    DORY::Model::Mesh streaming_mesh{};
+    float tinyobj_time = 1e30f;
+    float parallel_time = 1e30f;
+    float streaming_time = 1e30f;
+    DORY::Timer timer;
+
+    for (int i = 0; i < runs; i++)
+    {
+        timer.Reset();
+        DORY::ObjectLoader::LoadObj(tinyobj_mesh, path, false);
+        tinyobj_time = std::fmin(tinyobj_time, timer.GetElapsedTime());
+
+        timer.Reset();
+        DORY::ObjectLoader::LoadObj(parallel_mesh, path, true);
+        parallel_time = std::fmin(parallel_time, timer.GetElapsedTime());
+
+        timer.Reset();
+        DORY::ObjectLoader::LoadObjStreaming(streaming_mesh, path, 0, window_size);
+        streaming_time = std::fmin(streaming_time, timer.GetElapsedTime());
+    }
+
+    const bool match = MeshesMatch(tinyobj_mesh, parallel_mesh) && MeshesMatch(tinyobj_mesh, streaming_mesh);
+    printf("%s\n", path.c_str());
+    printf("    %zu vertices, %zu indices\n", parallel_mesh.vertices.size(), parallel_mesh.indices.size());
+    printf("    tinyobj:  %8.3f s\n", tinyobj_time);
+    printf("    parallel: %8.3f s (%.2fx)\n", parallel_time, tinyobj_time / parallel_time);
+    printf("    streamed: %8.3f s (%.2fx), %zu byte window\n", streaming_time, tinyobj_time / streaming_time, window_size);
+    printf("    output:   %s\n", match ? "identical" : "MISMATCH");
+    return match;
+}
+
+int main(int argc, char** argv)
+{
+    const size_t face_count = argc > 1 ? static_cast<size_t>(strtoull(argv[1], nullptr, 10)) : 10000000;
+
+    // small windows on the small files, so that records are split across many window boundaries
+    bool success = Benchmark("assets/models/stanford_bunny.obj", 10, 4096);
+    success &= Benchmark("assets/models/floor.obj", 10, 16);
+
+    const std::string synthetic_path = (std::filesystem::temp_directory_path() / "dory_synthetic.obj").string();
+    printf("writing %zu faces to %s\n", face_count, synthetic_path.c_str());
+    WriteSyntheticObj(synthetic_path, face_count);
+    success &= Benchmark(synthetic_path, 1, DORY::ObjParser::DEFAULT_WINDOW_SIZE);
+
+    // a limit far below the size of the mesh has to be refused before anything large is allocated
+    bool refused = false;
+    try
+    {
+        DORY::Model::Mesh mesh{};
+        DORY::ObjectLoader::LoadObjStreaming(mesh, synthetic_path, 1 << 20, 1 << 16);
+    }
+    catch (const std::runtime_error& error)
+    {
+        printf("memory limit: %s\n", error.what());
+        refused = true;
+    }
+    success &= refused;
+    std::filesystem::remove(synthetic_path);
+
+    return success ? 0 : 1;
+}